@@ -5,13 +5,33 @@
 #include "keyers.h"
 #include "adapter.h"
 #include "polybuzzer.h"
+#include "radio_output.h"
+#include "hid_keyboard.h"
+#include "usb_audio.h"
 
 // For SAMD21 software reset if needed by other parts of code
 #if defined(ARDUINO_ARCH_SAMD)
 // NVIC_SystemReset() is typically available through Arduino.h / CMSIS includes
 #endif
 
-extern void saveSettingsToEEPROM(uint8_t keyerType, uint16_t ditDuration, uint8_t txNote);
+extern void saveSettingsToEEPROM(uint8_t keyerType, uint32_t ditDurationUs, uint8_t txNote);
+extern void saveTextMemoryToEEPROM(uint8_t slotNumber, const uint8_t* text, uint16_t length,
+                                   uint16_t unitMs);
+extern void saveCallSignToEEPROM(const uint8_t* callSign, uint8_t length);
+extern void saveContestSerialToEEPROM(uint16_t serial);
+extern void saveVolumeToEEPROM(uint8_t volume);
+#ifdef RADIO_PTT_PIN
+extern uint8_t getPttLeadMs();
+extern uint8_t getPttHangSteps();
+extern void savePttTimingToEEPROM(uint8_t leadMs, uint8_t hangSteps);
+#endif
+#ifdef BUTTON_PIN
+extern void stopPlaybackForLiveKeying();
+#endif
+
+// NRPN parameter (CC99 MSB / CC98 LSB) for speed in WPM x 10 via CC6/CC38 data entry
+#define NRPN_SPEED_WPM_X10 0x0001
+#define NRPN_NULL 0x3FFF
 
 VailAdapter::VailAdapter(unsigned int PiezoPin) {
 this->buzzer = new PolyBuzzer(PiezoPin);
@@ -29,9 +49,14 @@ this->capDahPressCount = 0;
 this->radioDitState = false;
 this->radioDahState = false;
 this->keyboardMode = true;
+this->cwKeyboardMode = false;
+this->timestampMode = false;
 this->keyer = NULL;
 this->txNote = DEFAULT_TONE_NOTE;
-this->ditDuration = DEFAULT_ADAPTER_DIT_DURATION_MS;
+this->ditDurationUs = DEFAULT_ADAPTER_DIT_DURATION_MS * 1000UL;
+this->speedMsb = DEFAULT_ADAPTER_DIT_DURATION_MS / 2;
+this->nrpnParameter = NRPN_NULL;
+this->nrpnDataMsb = 0;
 this->txRelays[0] = false; // dit
 this->txRelays[1] = false; // dah
 this->lastPaddlePressed = PADDLE_DIT;
@@ -43,18 +68,64 @@ bool VailAdapter::KeyboardMode() {
 return this->keyboardMode;
 }
 
+bool VailAdapter::TimestampMode() {
+return this->timestampMode;
+}
+
 uint8_t VailAdapter::getCurrentKeyerType() const {
 return getKeyerNumber(this->keyer);
 }
 
 uint16_t VailAdapter::getDitDuration() const {
-return this->ditDuration;
+return (this->ditDurationUs + 500) / 1000;
+}
+
+uint32_t VailAdapter::getDitDurationMicros() const {
+return this->ditDurationUs;
+}
+
+void VailAdapter::setDitDurationMicros(unsigned long durationUs) {
+// Only speeds the settings store can hold, so the speed in use is the one
+// that comes back after a restart
+if (durationUs < SPEED_VALUE_TO_MICROS(1)) durationUs = SPEED_VALUE_TO_MICROS(1);
+if (durationUs > SPEED_VALUE_TO_MICROS(SPEED_VALUE_MAX)) durationUs = SPEED_VALUE_TO_MICROS(SPEED_VALUE_MAX);
+this->ditDurationUs = durationUs;
+// Keep the CC1 MSB in step so a lone CC33 refines the current speed
+uint32_t speedValue = MICROS_TO_SPEED_VALUE(durationUs);
+this->speedMsb = speedValue >> 7;
+if (this->keyer) {
+    this->keyer->SetDitDuration(this->ditDurationUs);
+}
+this->decoder.reset(this->ditDurationUs);
+Serial.print("Dit duration set to: "); Serial.print(this->ditDurationUs); Serial.println("us");
 }
 
 uint8_t VailAdapter::getTxNote() const {
 return this->txNote;
 }
 
+uint8_t VailAdapter::getVolume() const {
+return this->buzzer->volume;
+}
+
+// A short sidetone at the current volume, heard even with the buzzer disabled
+void VailAdapter::PlayVolumeCue() {
+this->CueNote(this->txNote); delay(150);
+this->CueOff();
+}
+
+void VailAdapter::CueTone(unsigned int frequency) {
+this->buzzer->Tone(BUZZER_SLOT_CUE, frequency);
+}
+
+void VailAdapter::CueNote(uint8_t note) {
+this->buzzer->Note(BUZZER_SLOT_CUE, note);
+}
+
+void VailAdapter::CueOff() {
+this->buzzer->NoTone(BUZZER_SLOT_CUE);
+}
+
 void VailAdapter::setRecordingState(RecordingState* state) {
     this->recordingState = state;
 }
@@ -91,6 +162,8 @@ this->dahHoldStartTime = 0;
 
 // Corrected MIDI key event function
 void VailAdapter::midiKey(uint8_t key, bool down) {
+// Capture the edge time before any USB work so it reflects the key event itself
+unsigned long timestamp = this->edgeTimeOrNow();
 uint8_t header;
 uint8_t status_byte;
 uint8_t velocity;
@@ -107,17 +180,42 @@ if (down) { // Note On
 // Construct the MIDI event packet for MIDIUSB library
 midiEventPacket_t event = {header, status_byte, key, velocity};
 MidiUSB.sendMIDI(event);
+if (this->timestampMode) {
+    this->midiTimestamp(key, down, timestamp);
+}
 MidiUSB.flush();
 }
 
+// Element timestamp SysEx: F0 7D 01 <note> <down> <t0> <t1> <t2> <t3> <t4> F7
+// t0..t4 carry the adapter's micros() clock, 7 bits per byte, least significant first.
+// Hosts use the difference between consecutive timestamps to recover exact element
+// timing regardless of USB/OS delivery jitter. See docs/MIDI_INTEGRATION_SPEC.md.
+void VailAdapter::midiTimestamp(uint8_t key, bool down, unsigned long timestamp) {
+uint8_t t[5];
+for (int i = 0; i < 5; i++) {
+    t[i] = (timestamp >> (7 * i)) & 0x7F;
+}
+// USB-MIDI SysEx framing: CIN 0x4 = start/continue (3 bytes), CIN 0x6 = end (2 bytes)
+midiEventPacket_t p1 = {0x04, 0xF0, 0x7D, 0x01};
+midiEventPacket_t p2 = {0x04, key, (uint8_t)(down ? 1 : 0), t[0]};
+midiEventPacket_t p3 = {0x04, t[1], t[2], t[3]};
+midiEventPacket_t p4 = {0x06, t[4], 0xF7, 0x00};
+MidiUSB.sendMIDI(p1);
+MidiUSB.sendMIDI(p2);
+MidiUSB.sendMIDI(p3);
+MidiUSB.sendMIDI(p4);
+}
+
 void VailAdapter::keyboardKey(uint8_t key, bool down) {
+// CW keyboard mode types the decoded text instead; releases still go out
+if (down && this->cwKeyboardMode) return;
 if (down) {
-Keyboard.press(key);
+hidKeyboardPress(key);
 // Track which keys we've pressed
 if (key == DIT_KEYBOARD_KEY) this->ditKeyPressed = true;
 if (key == DAH_KEYBOARD_KEY) this->dahKeyPressed = true;
 } else {
-Keyboard.release(key);
+hidKeyboardRelease(key);
 // Track which keys we've released
 if (key == DIT_KEYBOARD_KEY) this->ditKeyPressed = false;
 if (key == DAH_KEYBOARD_KEY) this->dahKeyPressed = false;
@@ -126,18 +224,9 @@ if (key == DAH_KEYBOARD_KEY) this->dahKeyPressed = false;
 
 void VailAdapter::ReleaseAllKeys() {
 // Release all keyboard keys that might be stuck
+// A single empty report is always sent as a safety measure
 if (this->keyboardMode) {
-if (this->ditKeyPressed) {
-Keyboard.release(DIT_KEYBOARD_KEY);
-this->ditKeyPressed = false;
-}
-if (this->dahKeyPressed) {
-Keyboard.release(DAH_KEYBOARD_KEY);
-this->dahKeyPressed = false;
-}
-// Also send release for both keys as a safety measure
-Keyboard.release(DIT_KEYBOARD_KEY);
-Keyboard.release(DAH_KEYBOARD_KEY);
+hidKeyboardReleaseAll();
 }
 // Release MIDI notes if in MIDI mode
 if (!this->keyboardMode) {
@@ -149,12 +238,43 @@ this->midiKey(2, false);
 this->ditKeyPressed = false;
 this->dahKeyPressed = false;
 this->keyIsPressed = false;
+this->decoder.key(false, micros());
 this->txRelays[0] = false;
 this->txRelays[1] = false;
 Serial.println("All keys released");
 }
 
+void VailAdapter::SetEdgeTime(unsigned long when) {
+this->edgeTime = when;
+this->edgeTimeValid = true;
+}
+
+void VailAdapter::ClearEdgeTime() {
+this->edgeTimeValid = false;
+}
+
+unsigned long VailAdapter::edgeTimeOrNow() const {
+return this->edgeTimeValid ? this->edgeTime : micros();
+}
+
 #ifdef HAS_RADIO_OUTPUT
+#if defined(RADIO_PTT_PIN)
+void VailAdapter::setRadioDit(bool active) {
+pttSequencerKey(RADIO_DIT_PIN, active ? RADIO_ACTIVE_LEVEL : RADIO_INACTIVE_LEVEL, this->edgeTimeOrNow());
+}
+
+void VailAdapter::setRadioDah(bool active) {
+pttSequencerKey(RADIO_DAH_PIN, active ? RADIO_ACTIVE_LEVEL : RADIO_INACTIVE_LEVEL, this->edgeTimeOrNow());
+}
+#elif defined(RADIO_EDGE_TIMER)
+void VailAdapter::setRadioDit(bool active) {
+radioEdgeWriteAt(RADIO_DIT_PIN, active ? RADIO_ACTIVE_LEVEL : RADIO_INACTIVE_LEVEL, this->edgeTimeOrNow());
+}
+
+void VailAdapter::setRadioDah(bool active) {
+radioEdgeWriteAt(RADIO_DAH_PIN, active ? RADIO_ACTIVE_LEVEL : RADIO_INACTIVE_LEVEL, this->edgeTimeOrNow());
+}
+#else
 void VailAdapter::setRadioDit(bool active) {
 digitalWrite(RADIO_DIT_PIN, active ? RADIO_ACTIVE_LEVEL : RADIO_INACTIVE_LEVEL);
 }
@@ -162,6 +282,7 @@ digitalWrite(RADIO_DIT_PIN, active ? RADIO_ACTIVE_LEVEL : RADIO_INACTIVE_LEVEL);
 void VailAdapter::setRadioDah(bool active) {
 digitalWrite(RADIO_DAH_PIN, active ? RADIO_ACTIVE_LEVEL : RADIO_INACTIVE_LEVEL);
 }
+#endif
 #else
 void VailAdapter::setRadioDit(bool active) {(void)active;}
 void VailAdapter::setRadioDah(bool active) {(void)active;}
@@ -177,6 +298,7 @@ void VailAdapter::Tx(int relay, bool closed) {
     if (anyRelayActive && !keyIsPressed) {
         // Start transmission
         keyIsPressed = true;
+        this->decoder.key(true, this->edgeTimeOrNow());
         if (!this->radioModeActive) {
             if (this->keyPressStartTime == 0) {
                 this->keyPressStartTime = millis();
@@ -189,12 +311,12 @@ void VailAdapter::Tx(int relay, bool closed) {
             uint8_t paddle = (relay == 0) ? PADDLE_DIT_FLAG : PADDLE_DAH_FLAG;
             recordKeyEvent(*recordingState, true, paddle);  // Key down
             // During recording: always play sidetone for feedback, even in radio mode
-            this->buzzer->Note(0, this->txNote);
+            this->buzzer->NoteAt(BUZZER_SLOT_SIDETONE, this->txNote, this->edgeTimeOrNow());
             return;  // Skip ALL output (radio, MIDI, keyboard) during recording
         }
 
         if (this->buzzerEnabled && !this->radioModeActive) {
-            this->buzzer->Note(0, this->txNote);
+            this->buzzer->NoteAt(BUZZER_SLOT_SIDETONE, this->txNote, this->edgeTimeOrNow());
         }
 
 #ifdef HAS_RADIO_OUTPUT
@@ -237,6 +359,7 @@ void VailAdapter::Tx(int relay, bool closed) {
     } else if (!anyRelayActive && keyIsPressed) {
         // End transmission
         keyIsPressed = false;
+        this->decoder.key(false, this->edgeTimeOrNow());
         if (!this->radioModeActive) {
             this->keyPressStartTime = 0;
         }
@@ -247,11 +370,11 @@ void VailAdapter::Tx(int relay, bool closed) {
             uint8_t paddle = (relay == 0) ? PADDLE_DIT_FLAG : PADDLE_DAH_FLAG;
             recordKeyEvent(*recordingState, false, paddle);  // Key up
             // During recording: only stop sidetone, don't send MIDI/keyboard/radio output
-            this->buzzer->NoTone(0);
+            this->buzzer->NoToneAt(BUZZER_SLOT_SIDETONE, this->edgeTimeOrNow());
             return;  // Skip normal output during recording
         }
 
-        this->buzzer->NoTone(0);
+        this->buzzer->NoToneAt(BUZZER_SLOT_SIDETONE, this->edgeTimeOrNow());
 
 #ifdef HAS_RADIO_OUTPUT
         if (this->radioModeActive) {
@@ -291,6 +414,7 @@ void VailAdapter::Tx(int relay, bool closed) {
 void VailAdapter::BeginTx() {
 if (!keyIsPressed) {
 keyIsPressed = true;
+this->decoder.key(true, this->edgeTimeOrNow());
 if (!this->radioModeActive) {
 if (this->keyPressStartTime == 0) {
 this->keyPressStartTime = millis();
@@ -304,12 +428,12 @@ if (recordingState != nullptr && recordingState->isRecording) {
     recordKeyEvent(*recordingState, true, PADDLE_DIT_FLAG);  // Key down
     // During recording: always play sidetone for feedback, even in radio mode
     // Don't send MIDI/keyboard/radio output
-    this->buzzer->Note(0, this->txNote);
+    this->buzzer->NoteAt(BUZZER_SLOT_SIDETONE, this->txNote, this->edgeTimeOrNow());
     return;  // Skip normal output during recording
 }
 
 if (this->buzzerEnabled && !this->radioModeActive) {
-    this->buzzer->Note(0, this->txNote);
+    this->buzzer->NoteAt(BUZZER_SLOT_SIDETONE, this->txNote, this->edgeTimeOrNow());
 }
 
 // Handle output based on current mode
@@ -337,6 +461,7 @@ if (!this->radioModeActive) {
 void VailAdapter::EndTx() {
 if (keyIsPressed) {
 keyIsPressed = false;
+this->decoder.key(false, this->edgeTimeOrNow());
 if (!this->radioModeActive) {
 this->keyPressStartTime = 0;
 }
@@ -347,11 +472,11 @@ if (recordingState != nullptr && recordingState->isRecording) {
     // No relay info available, default to DIT paddle
     recordKeyEvent(*recordingState, false, PADDLE_DIT_FLAG);  // Key up
     // During recording: only stop sidetone, don't send MIDI/keyboard/radio output
-    this->buzzer->NoTone(0);
+    this->buzzer->NoToneAt(BUZZER_SLOT_SIDETONE, this->edgeTimeOrNow());
     return;  // Skip normal output during recording
 }
 
-this->buzzer->NoTone(0);
+this->buzzer->NoToneAt(BUZZER_SLOT_SIDETONE, this->edgeTimeOrNow());
 
 // Handle output based on current mode
 #ifdef HAS_RADIO_OUTPUT
@@ -375,6 +500,7 @@ if (!this->radioModeActive) {
 void VailAdapter::BeginTx(int relay) {
 if (!keyIsPressed) {
 keyIsPressed = true;
+this->decoder.key(true, this->edgeTimeOrNow());
 if (!this->radioModeActive) {
 if (this->keyPressStartTime == 0) {
 this->keyPressStartTime = millis();
@@ -389,12 +515,12 @@ if (recordingState != nullptr && recordingState->isRecording) {
     recordKeyEvent(*recordingState, true, paddle);  // Key down
     // During recording: always play sidetone for feedback, even in radio mode
     // Don't send MIDI/keyboard/radio output
-    this->buzzer->Note(0, this->txNote);
+    this->buzzer->NoteAt(BUZZER_SLOT_SIDETONE, this->txNote, this->edgeTimeOrNow());
     return;  // Skip ALL output (radio, MIDI, keyboard) during recording
 }
 
 if (this->buzzerEnabled && !this->radioModeActive) {
-    this->buzzer->Note(0, this->txNote);
+    this->buzzer->NoteAt(BUZZER_SLOT_SIDETONE, this->txNote, this->edgeTimeOrNow());
 }
 
 #ifdef HAS_RADIO_OUTPUT
@@ -449,6 +575,7 @@ if (!this->radioModeActive) {
 void VailAdapter::EndTx(int relay) {
 if (keyIsPressed) {
 keyIsPressed = false;
+this->decoder.key(false, this->edgeTimeOrNow());
 if (!this->radioModeActive) {
 this->keyPressStartTime = 0;
 }
@@ -460,11 +587,11 @@ if (recordingState != nullptr && recordingState->isRecording) {
     uint8_t paddle = (relay == PADDLE_DIT) ? PADDLE_DIT_FLAG : PADDLE_DAH_FLAG;
     recordKeyEvent(*recordingState, false, paddle);  // Key up
     // During recording: only stop sidetone, don't send MIDI/keyboard/radio output
-    this->buzzer->NoTone(0);
+    this->buzzer->NoToneAt(BUZZER_SLOT_SIDETONE, this->edgeTimeOrNow());
     return;  // Skip normal output during recording
 }
 
-this->buzzer->NoTone(0);
+this->buzzer->NoToneAt(BUZZER_SLOT_SIDETONE, this->edgeTimeOrNow());
 
 #ifdef HAS_RADIO_OUTPUT
 if (this->radioModeActive) {
@@ -516,11 +643,11 @@ if (!this->radioModeActive) {
 }
 
 void VailAdapter::DisableBuzzer() {
-this->buzzer->NoTone(0);
-this->buzzer->Note(1, 70); delay(100);
-this->buzzer->Note(1, 65); delay(100);
-this->buzzer->Note(1, 60); delay(100);
-this->buzzer->NoTone(1);
+this->buzzer->NoTone(BUZZER_SLOT_SIDETONE);
+this->buzzer->Note(BUZZER_SLOT_CUE, 70); delay(100);
+this->buzzer->Note(BUZZER_SLOT_CUE, 65); delay(100);
+this->buzzer->Note(BUZZER_SLOT_CUE, 60); delay(100);
+this->buzzer->NoTone(BUZZER_SLOT_CUE);
 this->buzzerEnabled = false;
 Serial.println("Buzzer Disabled");
 }
@@ -537,36 +664,42 @@ ReleaseAllKeys();
 
 setRadioDit(false);
 setRadioDah(false);
+#ifdef RADIO_PTT_PIN
+pttSequencerReset();
+#endif
 radioDitState = false;
 radioDahState = false;
 keyIsPressed = false;
 
 // Restore the keyer's dit duration after releasing
 if (this->keyer) {
-    this->keyer->SetDitDuration(this->ditDuration);
-    Serial.print("Keyer dit duration restored to: "); Serial.println(this->ditDuration);
+    this->keyer->SetDitDuration(this->ditDurationUs);
+    Serial.print("Keyer dit duration restored to: "); Serial.print(this->ditDurationUs); Serial.println("us");
 }
 
 if (this->radioModeActive) {
     Serial.println("Radio Mode Activated (Sidetone Disabled)");
-    this->buzzer->NoTone(0);
-    this->buzzer->Note(1, 60); delay(100);
-    this->buzzer->Note(1, 65); delay(100);
-    this->buzzer->Note(1, 70); delay(100);
-    this->buzzer->NoTone(1);
+    this->buzzer->NoTone(BUZZER_SLOT_SIDETONE);
+    this->buzzer->Note(BUZZER_SLOT_CUE, 60); delay(100);
+    this->buzzer->Note(BUZZER_SLOT_CUE, 65); delay(100);
+    this->buzzer->Note(BUZZER_SLOT_CUE, 70); delay(100);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE);
 } else {
     Serial.println("Radio Mode Deactivated. Resetting controller...");
-    this->buzzer->Note(1, 70); delay(100);
-    this->buzzer->Note(1, 65); delay(100);
-    this->buzzer->Note(1, 60); delay(100);
-    this->buzzer->NoTone(1);
+    this->buzzer->Note(BUZZER_SLOT_CUE, 70); delay(100);
+    this->buzzer->Note(BUZZER_SLOT_CUE, 65); delay(100);
+    this->buzzer->Note(BUZZER_SLOT_CUE, 60); delay(100);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE);
     delay(100);
 
+    // Don't lose settings still waiting in the write-back cache
+    extern void flushSettingsToEEPROM();
+    flushSettingsToEEPROM();
     NVIC_SystemReset();
 }
 #else
 Serial.println("Radio output not configured. Radio mode unavailable.");
-this->buzzer->Tone(1, 100); delay(200); this->buzzer->NoTone(1);
+this->buzzer->Tone(BUZZER_SLOT_CUE, 100); delay(200); this->buzzer->NoTone(BUZZER_SLOT_CUE);
 #endif
 }
 
@@ -587,17 +720,19 @@ ReleaseAllKeys();
 
 setRadioDit(false);
 setRadioDah(false);
+#ifdef RADIO_PTT_PIN
+pttSequencerReset();
+#endif
 radioDitState = false;
 radioDahState = false;
 keyIsPressed = false;
 
 // Restore the keyer's dit duration after releasing
 if (this->keyer) {
-    this->keyer->SetDitDuration(this->ditDuration);
-    Serial.print("Keyer dit duration restored to: "); Serial.println(this->ditDuration);
+    this->keyer->SetDitDuration(this->ditDurationUs);
+    Serial.print("Keyer dit duration restored to: "); Serial.print(this->ditDurationUs); Serial.println("us");
 }
 
-extern void saveSettingsToEEPROM(uint8_t keyerType, uint16_t ditDuration, uint8_t txNote);
 extern void saveRadioKeyerModeToEEPROM(bool radioKeyerMode);
 saveRadioKeyerModeToEEPROM(this->radioKeyerMode);
 
@@ -605,29 +740,29 @@ if (this->radioKeyerMode) {
     Serial.println("Radio Keyer Mode Activated - Keyer output on DIT pin only");
     // Play "RK" in morse: R = .-. K = -.-
     // R: dit-dah-dit
-    this->buzzer->Note(1, this->txNote); delay(60);
-    this->buzzer->NoTone(1); delay(60);
-    this->buzzer->Note(1, this->txNote); delay(180);
-    this->buzzer->NoTone(1); delay(60);
-    this->buzzer->Note(1, this->txNote); delay(60);
-    this->buzzer->NoTone(1); delay(180); // char space
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(60);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE); delay(60);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(180);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE); delay(60);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(60);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE); delay(180); // char space
     // K: dah-dit-dah
-    this->buzzer->Note(1, this->txNote); delay(180);
-    this->buzzer->NoTone(1); delay(60);
-    this->buzzer->Note(1, this->txNote); delay(60);
-    this->buzzer->NoTone(1); delay(60);
-    this->buzzer->Note(1, this->txNote); delay(180);
-    this->buzzer->NoTone(1);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(180);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE); delay(60);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(60);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE); delay(60);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(180);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE);
 } else {
     Serial.println("Radio Keyer Mode Deactivated - Back to normal Radio Mode");
     // Play "R" in morse: R = .-.
     // R: dit-dah-dit
-    this->buzzer->Note(1, this->txNote); delay(60);
-    this->buzzer->NoTone(1); delay(60);
-    this->buzzer->Note(1, this->txNote); delay(180);
-    this->buzzer->NoTone(1); delay(60);
-    this->buzzer->Note(1, this->txNote); delay(60);
-    this->buzzer->NoTone(1);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(60);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE); delay(60);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(180);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE); delay(60);
+    this->buzzer->Note(BUZZER_SLOT_CUE, this->txNote); delay(60);
+    this->buzzer->NoTone(BUZZER_SLOT_CUE);
 }
 #else
 Serial.println("Radio output not configured. Radio Keyer mode unavailable.");
@@ -700,7 +835,7 @@ if (this->radioModeActive) {
         radioDahState = false;
         keyIsPressed = radioDitState;
         if (!keyIsPressed && radioKeyIsActiveBefore) {
-            this->buzzer->NoTone(0);
+            this->buzzer->NoTone(BUZZER_SLOT_SIDETONE);
         }
     } else {
         // DIT/DAH paddles
@@ -739,7 +874,7 @@ if (this->radioModeActive) {
 
         keyIsPressed = radioDitState || radioDahState;
         if (!keyIsPressed && radioKeyIsActiveBefore) {
-            this->buzzer->NoTone(0);
+            this->buzzer->NoTone(BUZZER_SLOT_SIDETONE);
         }
     }
 #endif
@@ -773,28 +908,92 @@ if (pressed) currentPaddleActivity = true;
 }
 
 void VailAdapter::HandleMIDI(midiEventPacket_t event) {
+#ifdef BUTTON_PIN
+// CIN 0x4-0x7 carry SysEx; data bytes never collide with the status cases below
+uint8_t cin = event.header & 0x0F;
+if (cin >= 0x4 && cin <= 0x7) {
+    this->sysexReceive(event);
+    return;
+}
+#endif
 uint16_t msg = (event.byte1 << 8) | (event.byte2 << 0);
 switch (event.byte1) {
 case 0xB0:
 switch (event.byte2) {
 case 0:
 this->keyboardMode = (event.byte3 > 0x3f);
-Serial.print("Keyboard mode: "); Serial.println(this->keyboardMode ? "ON" : "OFF");
+this->cwKeyboardMode = (event.byte3 >= CC0_CW_KEYBOARD_MIN && event.byte3 <= CC0_CW_KEYBOARD_MAX);
+Serial.print("Keyboard mode: "); Serial.println(this->cwKeyboardMode ? "CW" : (this->keyboardMode ? "ON" : "OFF"));
+Serial.print("HID reports sent: "); Serial.print(hidKeyboardReportsSent());
+Serial.print(", suppressed: "); Serial.println(hidKeyboardReportsSuppressed());
+Serial.print("Characters typed: "); Serial.print(hidKeyboardCharsTyped());
+Serial.print(", dropped: "); Serial.println(hidKeyboardCharsDropped());
+Serial.print("Buzzer output changes: "); Serial.print(this->buzzer->outputChanges);
+Serial.print(", suppressed: "); Serial.println(this->buzzer->outputCallsSuppressed);
+#ifdef SIDETONE_USB_AUDIO
+Serial.print("USB audio packets: "); Serial.print(usbAudioPacketsQueued());
+Serial.print(", dropped: "); Serial.print(usbAudioBlocksDropped());
+Serial.print(", empty frames: "); Serial.println(usbAudioEmptyFrames());
+#endif
+MidiUSB.sendMIDI(event);
+break;
+case 3:
+this->timestampMode = (event.byte3 > 0x3f);
+Serial.print("Timestamp mode: "); Serial.println(this->timestampMode ? "ON" : "OFF");
 MidiUSB.sendMIDI(event);
 break;
 case 1:
-this->ditDuration = event.byte3 * 2 * MILLISECOND;
-if (this->keyer) {
-this->keyer->SetDitDuration(this->ditDuration);
-}
-Serial.print("Dit duration set to: "); Serial.println(this->ditDuration);
-saveSettingsToEEPROM(getCurrentKeyerType(), this->ditDuration, this->txNote);
+// Speed MSB. On its own this is the legacy "value x 2 ms" setting; a following
+// CC33 supplies the LSB for 1/64 ms resolution.
+this->setDitDurationMicros(SPEED_VALUE_TO_MICROS((uint16_t)event.byte3 << 7));
+saveSettingsToEEPROM(getCurrentKeyerType(), this->ditDurationUs, this->txNote);
+break;
+case 33:
+this->setDitDurationMicros(SPEED_VALUE_TO_MICROS(((uint16_t)this->speedMsb << 7) | event.byte3));
+saveSettingsToEEPROM(getCurrentKeyerType(), this->ditDurationUs, this->txNote);
 break;
 case 2:
 this->txNote = event.byte3;
 Serial.print("TX Note set to: "); Serial.println(this->txNote);
 
-saveSettingsToEEPROM(getCurrentKeyerType(), this->ditDuration, this->txNote);
+saveSettingsToEEPROM(getCurrentKeyerType(), this->ditDurationUs, this->txNote);
+break;
+case 7: // Channel volume
+this->buzzer->SetVolume(CC_TO_VOLUME(event.byte3));
+saveVolumeToEEPROM(this->buzzer->volume);
+break;
+#ifdef RADIO_PTT_PIN
+case 14: // PTT lead time, ms
+savePttTimingToEEPROM(event.byte3, getPttHangSteps());
+pttSequencerSetTiming(getPttLeadMs(), (uint16_t)getPttHangSteps() * PTT_HANG_STEP_MS);
+break;
+case 15: // PTT hang time, 10 ms steps
+savePttTimingToEEPROM(getPttLeadMs(), event.byte3);
+pttSequencerSetTiming(getPttLeadMs(), (uint16_t)getPttHangSteps() * PTT_HANG_STEP_MS);
+break;
+#endif
+case 99: // NRPN parameter MSB
+this->nrpnParameter = ((uint16_t)event.byte3 << 7) | (this->nrpnParameter & 0x7F);
+break;
+case 98: // NRPN parameter LSB
+this->nrpnParameter = (this->nrpnParameter & 0x3F80) | event.byte3;
+break;
+case 101: // RPN select deselects any NRPN
+case 100:
+this->nrpnParameter = NRPN_NULL;
+break;
+case 6: // Data entry MSB, applied when the LSB arrives
+this->nrpnDataMsb = event.byte3;
+break;
+case 38: // Data entry LSB
+if (this->nrpnParameter == NRPN_SPEED_WPM_X10) {
+    uint16_t wpmTimesTen = ((uint16_t)this->nrpnDataMsb << 7) | event.byte3;
+    if (wpmTimesTen > 0) {
+        // dit = 1200 ms / WPM = 12,000,000 us / (WPM x 10)
+        this->setDitDurationMicros(12000000UL / wpmTimesTen);
+        saveSettingsToEEPROM(getCurrentKeyerType(), this->ditDurationUs, this->txNote);
+    }
+}
 break;
 }
 break;
@@ -808,22 +1007,82 @@ this->keyer = NULL;
 ReleaseAllKeys();
 this->keyer = GetKeyerByNumber(event.byte2, this);
 if (this->keyer) {
-this->keyer->SetDitDuration(this->ditDuration);
+this->keyer->SetDitDuration(this->ditDurationUs);
 Serial.print("Keyer mode set to: "); Serial.println(event.byte2);
 } else {
 Serial.print("Keyer mode set to passthrough (or invalid): "); Serial.println(event.byte2);
 }
-saveSettingsToEEPROM(event.byte2, this->ditDuration, this->txNote);
+saveSettingsToEEPROM(event.byte2, this->ditDurationUs, this->txNote);
 break;
 case 0x80:
-if (this->buzzerEnabled && !this->radioModeActive) this->buzzer->NoTone(1);
+if (this->buzzerEnabled && !this->radioModeActive) this->buzzer->NoTone(BUZZER_SLOT_HOST);
 break;
 case 0x90:
-if (this->buzzerEnabled && !this->radioModeActive) this->buzzer->Note(1, event.byte2);
+if (this->buzzerEnabled && !this->radioModeActive) this->buzzer->Note(BUZZER_SLOT_HOST, event.byte2);
 break;
 }
 }
 
+#ifdef BUTTON_PIN
+// USB-MIDI SysEx framing: CIN 0x4 = start/continue (3 bytes), CIN 0x5/0x6/0x7 =
+// end with 1/2/3 bytes. Oversized messages are dropped whole.
+void VailAdapter::sysexReceive(midiEventPacket_t event) {
+uint8_t cin = event.header & 0x0F;
+uint8_t count = (cin == 0x5) ? 1 : (cin == 0x6) ? 2 : 3;
+uint8_t bytes[3] = {event.byte1, event.byte2, event.byte3};
+for (uint8_t i = 0; i < count; i++) {
+    if (bytes[i] == 0xF0) {
+        this->sysexLength = 0;
+        this->sysexOverflow = false;
+    }
+    if (this->sysexLength < sizeof(this->sysexBuffer)) {
+        this->sysexBuffer[this->sysexLength++] = bytes[i];
+    } else {
+        this->sysexOverflow = true;
+    }
+}
+if (cin == 0x4) return;
+
+if (this->sysexLength >= 4 && this->sysexBuffer[0] == 0xF0 && this->sysexBuffer[1] == 0x7D &&
+    this->sysexBuffer[this->sysexLength - 1] == 0xF7) {
+    const uint8_t* payload = this->sysexBuffer + 3;
+    uint16_t payloadLength = this->sysexLength - 4;
+    if (this->sysexOverflow) {
+        Serial.println("SysEx too long - ignored");
+    } else if (this->sysexBuffer[2] == 0x02) {
+        this->storeTextMemory();
+    } else if (this->sysexBuffer[2] == 0x03) {
+        // Call sign for {CALL}: F0 7D 03 <ASCII> F7
+        saveCallSignToEEPROM(payload, payloadLength > 255 ? 255 : payloadLength);
+    } else if (this->sysexBuffer[2] == 0x04 && payloadLength == 2) {
+        // Next contest serial for {NR}: F0 7D 04 <MSB> <LSB> F7, 7 bits each
+        saveContestSerialToEEPROM(((uint16_t)payload[0] << 7) | payload[1]);
+    }
+}
+this->sysexLength = 0;
+}
+
+// Text memory SysEx: F0 7D 02 <slot> <ASCII text...> F7, slot 0-based.
+// No text clears the slot. See docs/MIDI_INTEGRATION_SPEC.md.
+void VailAdapter::storeTextMemory() {
+if (this->sysexLength < 5) return;
+uint8_t slot = this->sysexBuffer[3];
+if (slot >= MAX_MEMORY_SLOTS) {
+    Serial.print("Text memory SysEx for invalid slot "); Serial.println(slot + 1);
+    return;
+}
+// A save moves pool extents, which would invalidate a recording's free-space bound
+if (this->recordingState && this->recordingState->isRecording) {
+    Serial.println("Text memory SysEx ignored while recording");
+    return;
+}
+// Playback (or a repeat waiting to resend) reads its extent in place, and the save
+// may move every extent in the pool: stop it first, as the menu does before a clear
+stopPlaybackForLiveKeying();
+saveTextMemoryToEEPROM(slot, this->sysexBuffer + 4, this->sysexLength - 5, this->getDitDuration());
+}
+#endif
+
 void VailAdapter::Tick(unsigned long currentMillis) {
 // Check for dit hold during each tick
 if (this->ditIsHeld && this->buzzerEnabled) {
@@ -862,8 +1121,34 @@ this->DisableBuzzer();
 }
 }
 
+unsigned long now = micros();
+#ifdef RADIO_EDGE_TIMER
+// Run the keyer slightly ahead in radio mode: the edges it produces are
+// armed on the edge timer and hit the pins exactly on schedule
+if (this->radioModeActive) {
+    now += RADIO_EDGE_LOOKAHEAD_US;
+}
+#endif
+
 if (this->keyer) {
-    this->keyer->Tick(currentMillis);
+    this->keyer->Tick(now);
 }
+
+#ifdef RADIO_PTT_PIN
+pttSequencerTick(now);
+#endif
+
+// Type what the decoder makes of the keying in CW keyboard mode (not while
+// recording, which keeps the keying local). It decodes in every mode, so it
+// is already locked on to the speed when the mode is switched on.
+this->decoder.tick(micros());
+for (char c = this->decoder.read(); c; c = this->decoder.read()) {
+    if (this->cwKeyboardMode && !this->radioModeActive &&
+        !(recordingState != nullptr && recordingState->isRecording)) {
+        hidKeyboardType(c);
+    }
+}
+
+hidKeyboardTick();
 }
 
@@ -5,18 +5,30 @@
 #include "polybuzzer.h"
 #include "config.h" // Include config.h
 #include "memory.h" // Include memory.h for recording state
+#include "cw_decoder.h"
 
 class VailAdapter: public Transmitter {
 private:
     unsigned int txNote = DEFAULT_TONE_NOTE;
-    unsigned int ditDuration = DEFAULT_ADAPTER_DIT_DURATION_MS;
+    unsigned long ditDurationUs = DEFAULT_ADAPTER_DIT_DURATION_MS * 1000UL; // Full-precision dit duration
+
+    // High-resolution speed control state (CC1/CC33 pair and NRPN data entry)
+    uint8_t speedMsb = DEFAULT_ADAPTER_DIT_DURATION_MS / 2;
+    uint16_t nrpnParameter = 0x3FFF; // 0x3FFF = NRPN "null", nothing selected
+    uint8_t nrpnDataMsb = 0;
     bool keyboardMode = true;
+    bool cwKeyboardMode = false; // Type decoded text instead of the paddle keys (CC0 50-5F)
+    bool timestampMode = false; // Follow each MIDI note with a SysEx timestamp (CC3)
     Keyer *keyer = NULL;
     PolyBuzzer *buzzer = NULL;
 
     unsigned long keyPressStartTime = 0;
     bool keyIsPressed = false;
 
+    // Decodes the keying as it goes out (printed to Serial, and typed in CW
+    // keyboard mode)
+    CwDecoder decoder;
+
     unsigned long ditHoldStartTime = 0;
     bool ditIsHeld = false;
     bool buzzerEnabled = true;
@@ -41,15 +53,33 @@ private:
     // CW memory recording
     RecordingState* recordingState = nullptr;
 
+#ifdef BUTTON_PIN
+    // Text memory and macro variable SysEx (F0 7D 02-04), assembled across USB-MIDI packets
+    uint8_t sysexBuffer[MEMORY_TEXT_MAX_LENGTH + 5];
+    uint16_t sysexLength = 0;
+    bool sysexOverflow = false;
+    void sysexReceive(midiEventPacket_t event);
+    void storeTextMemory();
+#endif
+
+    // Scheduled time (micros) of the edge the keyer is currently transmitting
+    unsigned long edgeTime = 0;
+    bool edgeTimeValid = false;
+    unsigned long edgeTimeOrNow() const;
+
     void midiKey(uint8_t key, bool down);
+    void midiTimestamp(uint8_t key, bool down, unsigned long timestamp);
     void keyboardKey(uint8_t key, bool down);
 
     void setRadioDit(bool active);
     void setRadioDah(bool active);
 
+    void setDitDurationMicros(unsigned long durationUs);
+
 public:
     VailAdapter(unsigned int PiezoPin);
     bool KeyboardMode();
+    bool TimestampMode();
 
     void ProcessPaddleInput(Paddle paddle, bool pressed, bool isCapacitive);
     void HandleMIDI(midiEventPacket_t event);
@@ -59,6 +89,8 @@ public:
     void BeginTx(int relay) override;
     void EndTx(int relay) override;
     void Tx(int relay, bool closed); // Add Tx method for keyer relay control
+    void SetEdgeTime(unsigned long when) override;
+    void ClearEdgeTime() override;
 
     void Tick(unsigned long millis);
     
@@ -75,8 +107,17 @@ public:
     void ResetDahHoldCounter();
 
     uint8_t getCurrentKeyerType() const;
-    uint16_t getDitDuration() const;
+    uint16_t getDitDuration() const;       // Rounded to milliseconds
+    uint32_t getDitDurationMicros() const; // Full precision
     uint8_t getTxNote() const;
+    uint8_t getVolume() const;             // 0 to VOLUME_MAX
+    void PlayVolumeCue();
+
+    // Prompts and cues on the buzzer's cue slot: through the same output and
+    // volume as the sidetone, and heard even with the buzzer disabled
+    void CueTone(unsigned int frequency);
+    void CueNote(uint8_t note);
+    void CueOff();
 
     // CW memory recording support
     void setRecordingState(RecordingState* state);
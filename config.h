@@ -99,12 +99,14 @@
 
   // EEPROM/RAM-constrained: ATmega32U4 has 1024 bytes EEPROM (vs 16KB on SAMD21)
   // and only 2560 bytes RAM. Shrink CW memory slot dimensions to fit.
-  //   3 slots × (100 transitions × 2 bytes + 2 length bytes) = 606 bytes EEPROM
-  //   Plus 6 bytes settings = 612 bytes EEPROM used / 1024 available.
-  //   Each in-RAM CWMemory is 202 bytes; 3 slots + RecordingState ≈ ~800 bytes RAM.
+  //   256 bytes settings log + 2 × 42 byte slot directory + 552 byte pool
+  //   = 892 bytes EEPROM used / 1024 available.
+  //   200 bytes hold 100 RAW16 transitions, or ~400 keyer transitions in UNITS.
+  //   Saved slots are read in place; only the 200 byte recording buffer is in RAM.
   #define MAX_MEMORY_SLOTS 3
-  #define MAX_TRANSITIONS_PER_MEMORY 100
-  #define MAX_RECORDING_DURATION_MS 12000
+  #define MEMORY_POOL_SIZE 552
+  #define MEMORY_DATA_SIZE 200
+  #define MAX_RECORDING_DURATION_MS 45000
 #endif
 
 #ifdef TRRS_TRINKEY
@@ -142,15 +144,85 @@
     #define RADIO_ACTIVE_LEVEL HIGH
     #define RADIO_INACTIVE_LEVEL LOW
   #endif
+
+  // Drive radio key lines from a hardware timer compare (TC3) so element edges
+  // land on the keyer's schedule instead of whenever the loop gets to them.
+  // SAMD only; comment out to fall back to plain digitalWrite.
+  #if defined(ARDUINO_ARCH_SAMD)
+    #define RADIO_EDGE_TIMER
+  #endif
+  // How far ahead of real time the keyer runs in radio mode, so each edge is
+  // armed on the timer before it is due. Must cover the worst-case loop period.
+  #define RADIO_EDGE_LOOKAHEAD_US 3000
+
+  // Optional PTT output for amplifier/transceiver sequencing. When a PTT pin is
+  // defined, PTT is asserted as soon as the first element arrives, every key
+  // edge is delayed by the lead time, and PTT is held for the hang time after
+  // the last element. Elements inside the hang window reuse the open PTT.
+  // Pick a free pin for your board (D4/D5 are unused on the Advanced PCB).
+  // #define RADIO_PTT_PIN 4
+  // Default lead and hang times. CC14 (lead, 1 ms steps, up to 127 ms) and
+  // CC15 (hang, 10 ms steps, up to 1270 ms) change them and they are saved.
+  #define RADIO_PTT_LEAD_MS 15
+  #define RADIO_PTT_HANG_MS 250
 #endif
 
 
+// --- DAC SIDETONE (SAMD21 only) ---
+// Play the sidetone as a sine wave on the DAC pin (A0) instead of a square
+// wave from tone() on the piezo. It is gentler in headphones, and since the
+// samples are streamed by DMA there is no interrupt per half-cycle. A0 is
+// pin 0, which every stock board wires to the key or dah input. The No PCB
+// build is hand-wired, so there the straight key moves to D9 instead; on the
+// other boards the input has to be moved first, and the build stops with an
+// error until it is.
+// #define SIDETONE_DAC
+// Raised-cosine rise and fall of each element, 2-8 ms. Longer is softer;
+// the sidetone lags the key by 3 ms plus half of this.
+#define SIDETONE_RISE_MS 5
+// Fine tuning of every sidetone note in cents (-50 to 50), e.g. to sit on
+// the same pitch as a receiver's CW offset
+#define SIDETONE_TUNING_CENTS 0
+#if defined(SIDETONE_DAC) && !defined(ARDUINO_ARCH_SAMD)
+  #undef SIDETONE_DAC
+#endif
+#if defined(SIDETONE_DAC) && defined(NO_PCB_GITHUB_SPECS)
+  #undef KEY_PIN
+  #define KEY_PIN 9
+#endif
+// Also send the DAC sidetone to the computer as a USB audio input (16 kHz
+// mono), next to the keyboard and MIDI interfaces, so software can monitor
+// the adapter's own tone instead of making one after the USB and browser
+// delay. Needs SIDETONE_DAC, and keeps its timer running between tones.
+// #define SIDETONE_USB_AUDIO
+#if defined(SIDETONE_USB_AUDIO) && !defined(SIDETONE_DAC)
+  #undef SIDETONE_USB_AUDIO
+#endif
+
 // --- COMMON DEFINITIONS ---
 #define DIT_KEYBOARD_KEY KEY_LEFT_CTRL
 #define DAH_KEYBOARD_KEY KEY_RIGHT_CTRL
+// CC0 values selecting CW keyboard mode (decoded text typed as keystrokes);
+// the rest of 40-7F is keyboard mode
+#define CC0_CW_KEYBOARD_MIN 0x50
+#define CC0_CW_KEYBOARD_MAX 0x5F
 #define DEFAULT_TONE_NOTE 69
 #define DEFAULT_ADAPTER_DIT_DURATION_MS 100
 
+// Sidetone volume: 0 (silent) to VOLUME_MAX in 3 dB steps. CC7 carries it
+// scaled to the usual 0-127 MIDI range.
+#define VOLUME_MAX 10
+#define DEFAULT_VOLUME VOLUME_MAX
+#define VOLUME_TO_CC(v) (((uint16_t)(v) * 127 + VOLUME_MAX / 2) / VOLUME_MAX)
+#define CC_TO_VOLUME(cc) (((uint16_t)(cc) * VOLUME_MAX + 63) / 127)
+
+// High-resolution speed value: the 14-bit CC1 (MSB) / CC33 (LSB) pair carries the
+// dit duration in 1/64 ms (15.625 us) steps, so CC1 alone keeps its legacy
+// "value x 2 ms" meaning. The same value is what gets stored in EEPROM.
+#define SPEED_VALUE_MAX 0x3FFF
+#define SPEED_VALUE_TO_MICROS(v) (((uint32_t)(v) * 125UL) / 8UL)
+#define MICROS_TO_SPEED_VALUE(us) ((uint32_t)((((uint32_t)(us)) * 8UL + 62UL) / 125UL))
+
 #define MILLISECOND 1
 // NOTE: a `#define SECOND (1000 * MILLISECOND)` used to live here but was
 // never referenced in the codebase. Recent Adafruit FreeTouch / ASF headers
@@ -165,13 +237,31 @@
 #define CHAR_SPACE (DOT_DURATION * 3)
 #define WORD_SPACE (DOT_DURATION * 7)
 
-// EEPROM definitions
+// Legacy fixed EEPROM settings layout. Settings now live in a record log in the
+// NVM region (nvm_storage.h); these are only read once to migrate old settings.
 #define EEPROM_KEYER_TYPE_ADDR 0
 #define EEPROM_DIT_DURATION_ADDR 1
 #define EEPROM_TX_NOTE_ADDR 3
 #define EEPROM_VALID_FLAG_ADDR 4
 #define EEPROM_RADIO_KEYER_MODE_ADDR 5
-#define EEPROM_VALID_VALUE 0x42
+#define EEPROM_VALID_VALUE 0x43        // Dit duration stored as a 14-bit speed value
+#define EEPROM_VALID_VALUE_LEGACY 0x42 // Dit duration stored in whole milliseconds
+
+// Settings changes are cached in RAM and only appended to the settings log
+// once they have been stable for this long (or right before a reset)
+#define SETTINGS_COMMIT_IDLE_MS 2000
+
+// CW memories replay at the current keyer speed, rescaled from the dit
+// length they were recorded at. Define this to also square up elements and
+// gaps to ideal 1/3/7 ratios, which evens out a hand-keyed recording.
+// #define MEMORY_PLAYBACK_SNAP
+
+// Double-clicking a memory button in normal mode repeats the memory (CQ loop
+// or beacon) until a paddle, key or button is touched. Each send follows the
+// last after MEMORY_REPEAT_GAP_MS of silence; define MEMORY_REPEAT_PERIOD_MS
+// instead to start sends at a fixed interval, as a beacon would.
+#define MEMORY_REPEAT_GAP_MS 3000
+// #define MEMORY_REPEAT_PERIOD_MS 60000
 
 // Feature activation thresholds
 #define DIT_HOLD_BUZZER_DISABLE_THRESHOLD 5000   // 5 seconds
@@ -0,0 +1,12 @@
+#include "crc16.h"
+
+uint16_t crc16Update(uint16_t crc, const void* data, uint16_t len) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  while (len--) {
+    crc ^= (uint16_t)(*bytes++) << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
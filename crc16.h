@@ -0,0 +1,11 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+
+// CRC-16/CCITT-FALSE, chainable: pass the previous result as crc (start 0xFFFF)
+//
+// This file has no Arduino dependencies so host tools can build it as-is.
+uint16_t crc16Update(uint16_t crc, const void* data, uint16_t len);
+
+#endif // CRC16_H
@@ -0,0 +1,184 @@
+#include "cw_decoder.h"
+#include "morse_table.h"
+#include "config.h"
+
+// How far the gap since the last key-up has been classed
+#define GAP_ELEMENT 0   // Still inside the character
+#define GAP_LETTER 1    // The character is finished
+#define GAP_WORD 2      // So is the word (also when idle)
+
+// A mark this many times the one before it is the other kind
+#define MARK_RATIO 2
+
+// Centroid a quarter of the way towards a new sample
+static uint32_t pull(uint32_t centroid, uint32_t sample) {
+  return (uint32_t)((int32_t)centroid + ((int32_t)sample - (int32_t)centroid) / 4);
+}
+
+// Geometric mean, the midpoint between two centroids: timing errors grow
+// with the length being timed, so a long class spreads further than a short
+// one. Square root a bit at a time, at 64 us resolution (up to 4 s).
+static uint32_t between(uint32_t a, uint32_t b) {
+  a >>= 6;
+  b >>= 6;
+  if (a > 0xFFFF) a = 0xFFFF;
+  if (b > 0xFFFF) b = 0xFFFF;
+  uint32_t square = a * b;
+  uint32_t root = 0;
+  for (uint32_t bit = 1UL << 30; bit; bit >>= 2) {
+    if (square >= root + bit) {
+      square -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+  }
+  return root << 6;
+}
+
+CwDecoder::CwDecoder() {
+  reset(DEFAULT_ADAPTER_DIT_DURATION_MS * 1000UL);
+}
+
+void CwDecoder::reset(uint32_t ditUs) {
+  dit = ditUs;
+  dah = 3 * ditUs;
+  gap = ditUs;
+  letter = 3 * ditUs;
+  word = 7 * ditUs;
+  lastEdge = 0;
+  lastMark = 0;
+  node = MORSE_TRIE_ROOT;
+  down = false;
+  gapClass = GAP_WORD;
+  output = 0;
+  outputSpace = false;
+}
+
+void CwDecoder::key(bool keyDown, uint32_t when) {
+  if (keyDown == down) return;
+  int32_t elapsed = (int32_t)(when - lastEdge);
+  uint32_t length = elapsed > 0 ? (uint32_t)elapsed : 0;
+  lastEdge = when;
+  down = keyDown;
+
+  if (keyDown) {
+    classifyGap(length, true);
+    return;
+  }
+
+  // Key-up: class the mark, against the one before it if that settles it
+  bool isDah;
+  if (lastMark && length >= MARK_RATIO * lastMark) {
+    isDah = true;
+  } else if (lastMark && MARK_RATIO * length <= lastMark) {
+    isDah = false;
+  } else {
+    uint32_t threshold = between(dit, dah);
+    if (threshold > MARK_RATIO * dit) threshold = MARK_RATIO * dit;
+    isDah = length > threshold;
+  }
+
+  // Move the centroid, and the other one with it if the pair gets closer
+  // than 2:1 or further apart than 5:1 (only one kind being sent). A key
+  // held down counts as two dahs at most.
+  uint32_t sample = length < 2 * dah ? length : 2 * dah;
+  uint32_t oldDit = dit;
+  if (isDah) {
+    dah = pull(dah, sample);
+    if (dah < 2 * dit) dit = dah / 2;
+    if (dah > 5 * dit) dit = dah / 5;
+  } else {
+    dit = pull(dit, sample);
+    if (dah < 2 * dit) dah = 2 * dit;
+    if (dah > 5 * dit) dah = 5 * dit;
+  }
+
+  // The gaps scale with the marks, so they keep up with a change of speed
+  // before any gap has been sent at it
+  if (dit != oldDit && oldDit) {
+    uint32_t scale = (dit << 8) / oldDit;   // 8 fractional bits
+    gap = (gap >> 4) * scale >> 4;
+    letter = (letter >> 4) * scale >> 4;
+    word = (word >> 4) * scale >> 4;
+  }
+  lastMark = length;
+
+  // One step down the trie; past the longest code the pattern is unknown
+  if (node == 0 || node >= 0x80) {
+    node = 0;
+  } else {
+    node = (node << 1) | (isDah ? 1 : 0);
+  }
+  gapClass = GAP_ELEMENT;
+}
+
+void CwDecoder::tick(uint32_t now) {
+  if (down) return;
+  int32_t elapsed = (int32_t)(now - lastEdge);
+  if (elapsed <= 0) return;
+  classifyGap((uint32_t)elapsed, false);
+}
+
+void CwDecoder::classifyGap(uint32_t length, bool final) {
+  // A gap twice the element gap is past it whatever the letter gap centroid
+  // says, and one under a dit and a half is not, so both gap centroids keep
+  // being trained while the speed changes under them
+  uint32_t letterThreshold = between(gap, letter);
+  if (letterThreshold > MARK_RATIO * gap) letterThreshold = MARK_RATIO * gap;
+  if (letterThreshold < dit + dit / 2) letterThreshold = dit + dit / 2;
+  uint32_t wordThreshold = between(letter, word);
+  if (wordThreshold < 4 * dit) wordThreshold = 4 * dit;
+
+  if (gapClass < GAP_LETTER && length > letterThreshold) {
+    finishCharacter();
+    gapClass = GAP_LETTER;
+  }
+  if (gapClass < GAP_WORD && length > wordThreshold) {
+    if (output) {
+      outputSpace = true;
+    } else {
+      output = ' ';
+    }
+    gapClass = GAP_WORD;
+    lastMark = 0;
+  }
+  if (!final) return;
+
+  // The gap is over: train its centroid. A pause counts as twice the word
+  // gap at most.
+  if (length <= letterThreshold) {
+    gap = pull(gap, length);
+  } else if (length <= wordThreshold) {
+    letter = pull(letter, length);
+  } else {
+    // Gaps between the two centroids also draw the letter centroid up, a
+    // little, or it would never find letter gaps stretched past where it
+    // expected them (Farnsworth spacing)
+    if (length > letter && length < word) letter += (length - letter) / 8;
+    word = pull(word, length < 2 * word ? length : 2 * word);
+  }
+  if (gap < dit / 2) gap = dit / 2;
+  if (gap > 2 * dit) gap = 2 * dit;
+  if (letter < 2 * gap) letter = 2 * gap;
+  if (word < letter + 2 * dit) word = letter + 2 * dit;
+}
+
+void CwDecoder::finishCharacter() {
+  if (node == MORSE_TRIE_ROOT) return;
+  char c = node ? morseCharacter(node) : 0;
+  output = c ? c : CW_DECODER_UNKNOWN;
+  outputSpace = false;
+  node = MORSE_TRIE_ROOT;
+}
+
+char CwDecoder::read() {
+  char c = output;
+  if (outputSpace) {
+    output = ' ';
+    outputSpace = false;
+  } else {
+    output = 0;
+  }
+  return c;
+}
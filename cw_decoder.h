@@ -0,0 +1,68 @@
+#ifndef CW_DECODER_H
+#define CW_DECODER_H
+
+#include <stdint.h>
+
+// ============================================================================
+// STREAMING CW DECODER
+// ============================================================================
+// Decodes the adapter's own keying from its key edges, as they happen. Each
+// key-up classifies the element it ends and moves one step down the Morse
+// trie (morse_table.h); the key-down after a gap, or tick() once the key has
+// been up long enough, classifies the gap and finishes the character or the
+// word. Nothing is kept but the trie position and the speed estimates, so
+// every call takes constant time and the state is a few dozen bytes.
+//
+// The speed is tracked k-means style, with two centroids for the marks
+// (dit, dah) and three for the gaps (element, letter and word gap). A mark
+// or gap goes to the nearer centroid, i.e. against the geometric mean of
+// the two, and pulls that centroid a quarter of the way towards itself. A
+// mark at least twice as long or short as the mark before it is classed by
+// that comparison instead, and the gap centroids are scaled along with the
+// dit, so a sudden change of speed is picked up within a character or two.
+// Letter gaps stretched well past the letter centroid (Farnsworth spacing)
+// are found by letting word gaps shorter than the word centroid draw it up.
+//
+// This file has no Arduino dependencies so host tools can build it as-is.
+// ============================================================================
+
+// Character for a pattern that is not in the table
+#define CW_DECODER_UNKNOWN '*'
+
+class CwDecoder {
+public:
+    CwDecoder();
+
+    // Start over with dits of ditUs (e.g. the keyer's speed setting)
+    void reset(uint32_t ditUs);
+
+    // Key edge at when (micros); edges must come in order
+    void key(bool down, uint32_t when);
+
+    // Finish a character or word once the key has been up long enough
+    // (call regularly; now may be behind a scheduled edge)
+    void tick(uint32_t now);
+
+    // Next decoded character (' ' between words), or 0
+    char read();
+
+    // Current estimates, in microseconds
+    uint32_t ditMicros() const { return dit; }
+    uint32_t dahMicros() const { return dah; }
+
+private:
+    uint32_t dit, dah;          // Mark centroids
+    uint32_t gap, letter, word; // Gap centroids
+    uint32_t lastEdge;          // Time of the last edge
+    uint32_t lastMark;          // Length of the last mark, 0 after a word
+    uint8_t node;               // Trie position
+    bool down;                  // The key is down
+    uint8_t gapClass;           // How far the current gap has been classed
+    char output;                // Character not yet read
+    bool outputSpace;           // A word space follows it
+
+    void classifyGap(uint32_t length, bool final);
+    void finishCharacter();
+};
+
+#endif // CW_DECODER_H
@@ -9,6 +9,8 @@
 // MIDI note number → frequency (Hz) lookup, 0..127.
 // Stored in PROGMEM on AVR to save ~256 bytes of SRAM.
 // pgm_read_word is a no-op pointer deref on ARM cores, so GET_EQUAL_TEMPERAMENT_NOTE is safe on SAMD21.
+// Whole Hz suits tone(); the DAC sidetone plays notes at their exact pitch
+// from the phase step table behind sidetoneNoteIncrement() (sidetone_synth.h).
 extern const uint16_t equalTemperamentNote[128] PROGMEM;
 
 #define GET_EQUAL_TEMPERAMENT_NOTE(n) pgm_read_word(&equalTemperamentNote[(n)])
@@ -0,0 +1,203 @@
+#include <Keyboard.h>
+#include <string.h>
+#include "hid_keyboard.h"
+#include "config.h"
+
+// Keyboard library report ID and modifier key code range
+#define HID_KEYBOARD_REPORT_ID 2
+#define HID_MODIFIER_FIRST 0x80
+#define HID_MODIFIER_LAST 0x87
+
+// One USB full-speed frame
+#define HID_REPORT_INTERVAL_US 1000UL
+
+// Left shift in the modifier byte, and the flag for it in a queued usage
+#define HID_MODIFIER_SHIFT 0x02
+#define HID_USAGE_SHIFTED 0x80
+
+static_assert(DIT_KEYBOARD_KEY >= HID_MODIFIER_FIRST && DIT_KEYBOARD_KEY <= HID_MODIFIER_LAST,
+              "DIT_KEYBOARD_KEY must be a modifier key");
+static_assert(DAH_KEYBOARD_KEY >= HID_MODIFIER_FIRST && DAH_KEYBOARD_KEY <= HID_MODIFIER_LAST,
+              "DAH_KEYBOARD_KEY must be a modifier key");
+
+// ============================================================================
+// Report State
+// ============================================================================
+
+static KeyReport report = {0, 0, {0, 0, 0, 0, 0, 0}};
+static KeyReport sent = {0, 0, {0, 0, 0, 0, 0, 0}};
+static unsigned long lastReportTime = 0;
+static bool reportPending = false;
+static bool reportForced = false;
+
+static uint32_t reportsSent = 0;
+static uint32_t reportsSuppressed = 0;
+
+static bool reportChanged() {
+  return memcmp(&report, &sent, sizeof(KeyReport)) != 0;
+}
+
+static void sendReport(unsigned long now) {
+  HID().SendReport(HID_KEYBOARD_REPORT_ID, &report, sizeof(KeyReport));
+  sent = report;
+  lastReportTime = now;
+  reportPending = false;
+  reportForced = false;
+  reportsSent++;
+}
+
+static void updateReport(bool force) {
+  if (reportPending) {
+    // Folded into the report already waiting for the next frame
+    reportForced = reportForced || force;
+    reportsSuppressed++;
+    return;
+  }
+
+  if (!force && !reportChanged()) {
+    reportsSuppressed++;
+    return;
+  }
+
+  unsigned long now = micros();
+  if (now - lastReportTime >= HID_REPORT_INTERVAL_US) {
+    sendReport(now);
+  } else {
+    reportPending = true;
+    reportForced = force;
+  }
+}
+
+// ============================================================================
+// Typing
+// ============================================================================
+
+// Key usages waiting to be typed, HID_USAGE_SHIFTED set for shifted ones
+static uint8_t typeQueue[HID_TYPE_QUEUE];
+static uint8_t typeHead = 0;
+static uint8_t typeCount = 0;
+static bool typing = false;  // A typed key is down in the report
+
+static uint32_t charsTyped = 0;
+static uint32_t charsDropped = 0;
+
+// US layout key for each character the Morse table has, or 0
+static uint8_t usageFor(char c) {
+  if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+  if (c >= 'A' && c <= 'Z') return HID_USAGE_SHIFTED | (0x04 + c - 'A');
+  if (c >= '1' && c <= '9') return 0x1E + c - '1';
+  switch (c) {
+    case '0': return 0x27;
+    case ' ': return 0x2C;
+    case '-': return 0x2D;
+    case '_': return HID_USAGE_SHIFTED | 0x2D;
+    case '=': return 0x2E;
+    case '+': return HID_USAGE_SHIFTED | 0x2E;
+    case ';': return 0x33;
+    case ':': return HID_USAGE_SHIFTED | 0x33;
+    case '\'': return 0x34;
+    case '"': return HID_USAGE_SHIFTED | 0x34;
+    case ',': return 0x36;
+    case '.': return 0x37;
+    case '/': return 0x38;
+    case '?': return HID_USAGE_SHIFTED | 0x38;
+    case '!': return HID_USAGE_SHIFTED | 0x1E;
+    case '@': return HID_USAGE_SHIFTED | 0x1F;
+    case '$': return HID_USAGE_SHIFTED | 0x21;
+    case '&': return HID_USAGE_SHIFTED | 0x24;
+    case '*': return HID_USAGE_SHIFTED | 0x25;
+    case '(': return HID_USAGE_SHIFTED | 0x26;
+    case ')': return HID_USAGE_SHIFTED | 0x27;
+    default: return 0;
+  }
+}
+
+// Release the typed key, or press the next one: one change per report, so
+// repeated characters come out as separate key presses
+static void typeNext(unsigned long now) {
+  if (typing) {
+    report.keys[0] = 0;
+    report.modifiers &= ~HID_MODIFIER_SHIFT;
+    typing = false;
+  } else if (typeCount) {
+    uint8_t usage = typeQueue[typeHead];
+    typeHead = (typeHead + 1) % HID_TYPE_QUEUE;
+    typeCount--;
+    report.keys[0] = usage & ~HID_USAGE_SHIFTED;
+    if (usage & HID_USAGE_SHIFTED) report.modifiers |= HID_MODIFIER_SHIFT;
+    typing = true;
+    charsTyped++;
+  } else {
+    return;
+  }
+  sendReport(now);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void hidKeyboardPress(uint8_t key) {
+  if (key < HID_MODIFIER_FIRST || key > HID_MODIFIER_LAST) return;
+  report.modifiers |= (1 << (key - HID_MODIFIER_FIRST));
+  updateReport(false);
+}
+
+void hidKeyboardRelease(uint8_t key) {
+  if (key < HID_MODIFIER_FIRST || key > HID_MODIFIER_LAST) return;
+  report.modifiers &= ~(1 << (key - HID_MODIFIER_FIRST));
+  updateReport(false);
+}
+
+void hidKeyboardReleaseAll() {
+  report.modifiers = 0;
+  report.keys[0] = 0;
+  typing = false;
+  updateReport(true);
+}
+
+bool hidKeyboardType(char c) {
+  uint8_t usage = usageFor(c);
+  if (!usage) return false;
+  if (typeCount == HID_TYPE_QUEUE) {
+    charsDropped++;
+    return false;
+  }
+  typeQueue[(typeHead + typeCount) % HID_TYPE_QUEUE] = usage;
+  typeCount++;
+  return true;
+}
+
+void hidKeyboardTick() {
+  if (!reportPending && !typing && !typeCount) return;
+
+  unsigned long now = micros();
+  if (now - lastReportTime < HID_REPORT_INTERVAL_US) return;
+
+  if (reportPending) {
+    if (reportForced || reportChanged()) {
+      sendReport(now);
+      return;
+    }
+    // Changes inside the frame cancelled out
+    reportPending = false;
+    reportsSuppressed++;
+  }
+  typeNext(now);
+}
+
+uint32_t hidKeyboardReportsSent() {
+  return reportsSent;
+}
+
+uint32_t hidKeyboardReportsSuppressed() {
+  return reportsSuppressed;
+}
+
+uint32_t hidKeyboardCharsTyped() {
+  return charsTyped;
+}
+
+uint32_t hidKeyboardCharsDropped() {
+  return charsDropped;
+}
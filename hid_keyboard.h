@@ -0,0 +1,50 @@
+#ifndef HID_KEYBOARD_H
+#define HID_KEYBOARD_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// DIRECT HID KEYBOARD OUTPUT
+// ============================================================================
+// Keyboard mode only ever holds modifier keys (DIT_KEYBOARD_KEY and
+// DAH_KEYBOARD_KEY), so instead of going through Keyboard.press/release this
+// module keeps the 8-byte boot keyboard report locally, flips modifier bits
+// in place and hands the report to the HID endpoint itself.
+//
+// - Reports that would not change what the host sees are suppressed
+// - At most one report goes out per USB frame (1 ms); changes inside a frame
+//   are coalesced and flushed from hidKeyboardTick()
+//
+// CW keyboard mode types text instead: characters wait in a ring buffer and
+// hidKeyboardTick() sends each as a key press and a release, one report per
+// frame, so typing never holds up the caller.
+//
+// Keyboard.begin() is still called from setup so the Keyboard library
+// registers the HID report descriptor this module sends against.
+// ============================================================================
+
+// Characters waiting to be typed
+#define HID_TYPE_QUEUE 32
+
+// Press/release a modifier key (KEY_LEFT_CTRL .. KEY_RIGHT_GUI)
+void hidKeyboardPress(uint8_t key);
+void hidKeyboardRelease(uint8_t key);
+
+// Release everything with a single report, sent even if nothing was held
+void hidKeyboardReleaseAll();
+
+// Queue a character to be typed (US layout; letters come out as capitals).
+// Returns false if it has no key or the queue is full.
+bool hidKeyboardType(char c);
+
+// Flush a coalesced report once its frame has passed, and type the next
+// queued character (call every loop)
+void hidKeyboardTick();
+
+// Statistics
+uint32_t hidKeyboardReportsSent();
+uint32_t hidKeyboardReportsSuppressed();
+uint32_t hidKeyboardCharsTyped();
+uint32_t hidKeyboardCharsDropped();
+
+#endif // HID_KEYBOARD_H
@@ -49,7 +49,7 @@ public:
 class StraightKeyer: public Keyer {
 public:
     Transmitter *output;
-    unsigned int ditDuration;
+    unsigned long ditDuration; // microseconds
     bool txRelays[2];
     int currentTransmittingRelay = -1; // Track what we're currently transmitting
 
@@ -65,10 +65,10 @@ public:
         if (this->output) {
             this->output->EndTx();
         }
-        this->ditDuration = 100;
+        this->ditDuration = 100000;
     }
 
-    void SetDitDuration(unsigned int duration) {
+    void SetDitDuration(unsigned long duration) {
         this->ditDuration = duration;
     }
 
@@ -109,12 +109,20 @@ public:
         this->Tx(key, pressed);
     }
 
-    void Tick(unsigned long millis) {};
+    // Tx with a known edge time (micros) passed through to the output
+    void TxAt(int relay, bool closed, unsigned long when) {
+        this->output->SetEdgeTime(when);
+        this->Tx(relay, closed);
+        this->output->ClearEdgeTime();
+    }
+
+    void Tick(unsigned long now) {};
 };
 
 class BugKeyer: public StraightKeyer {
 public:
     unsigned long nextPulse = 0;
+    bool pulsing = false;
     bool keyPressed[2];
 
     using StraightKeyer::StraightKeyer;
@@ -122,6 +130,7 @@ public:
     void Reset() {
         StraightKeyer::Reset();
         this->nextPulse = 0;
+        this->pulsing = false;
         this->keyPressed[0] = false;
         this->keyPressed[1] = false;
     }
@@ -135,28 +144,39 @@ public:
         }
     }
 
-    void Tick(unsigned long millis) {
-        if (this->nextPulse && (millis >= this->nextPulse)) {
-            this->pulse(millis);
+    void Tick(unsigned long now) {
+        if (this->pulsing && ((long)(now - this->nextPulse) >= 0)) {
+            this->pulse(now);
         }
     }
 
     void beginPulsing() {
-        if (!this->nextPulse) {
-            this->nextPulse = 1;
+        if (!this->pulsing) {
+            this->pulsing = true;
+            this->nextPulse = micros();
+        }
+    }
+
+    // The edge belongs at the deadline that just expired. Chaining from it keeps
+    // loop latency out of element lengths; after a real stall, restart from now.
+    unsigned long scheduledEdge(unsigned long now) {
+        if ((long)(now - this->nextPulse) > (long)(this->ditDuration / 4)) {
+            return now;
         }
+        return this->nextPulse;
     }
 
-    virtual void pulse(unsigned long millis) {
+    virtual void pulse(unsigned long now) {
+        unsigned long edge = this->scheduledEdge(now);
         if (this->TxClosed(0)) {
-            this->Tx(0, false);
+            this->TxAt(0, false, edge);
         } else if (this->keyPressed[0]) {
-            this->Tx(0, true);
+            this->TxAt(0, true, edge);
         } else {
-            this->nextPulse = 0;
+            this->pulsing = false;
             return;
         }
-        this->nextPulse = millis + this->ditDuration;
+        this->nextPulse = edge + this->ditDuration;
     }
 };
 
@@ -193,7 +213,7 @@ public:
         }
     }
 
-    unsigned int keyDuration(int key) {
+    unsigned long keyDuration(int key) {
         switch (key) {
         case PADDLE_DIT:
             return this->ditDuration;
@@ -210,8 +230,9 @@ public:
         return this->nextRepeat;
     }
 
-    virtual void pulse(unsigned long millis) {
-        int nextPulse = 0;
+    virtual void pulse(unsigned long now) {
+        unsigned long edge = this->scheduledEdge(now);
+        unsigned long nextPulse = 0;
         if (this->currentTransmittingElement >= 0) {
             // Pause if we're currently transmitting - end current element
             nextPulse = this->keyDuration(PADDLE_DIT);
@@ -219,7 +240,7 @@ public:
             Serial.print(this->currentTransmittingElement);
             Serial.print(" nextPulse=");
             Serial.println(nextPulse);
-            this->Tx(this->currentTransmittingElement, false);
+            this->TxAt(this->currentTransmittingElement, false, edge);
             this->currentTransmittingElement = -1;
         } else {
             int next = this->nextTx();
@@ -231,14 +252,14 @@ public:
                 Serial.print(next);
                 Serial.print(" duration=");
                 Serial.println(nextPulse);
-                this->Tx(next, true);
+                this->TxAt(next, true, edge);
             }
         }
 
         if (nextPulse) {
-            this->nextPulse = millis + nextPulse;
+            this->nextPulse = edge + nextPulse;
         } else {
-            this->nextPulse = 0;
+            this->pulsing = false;
         }
     }
 };
@@ -14,19 +14,28 @@ public:
     virtual void EndTx();
     virtual void BeginTx(int relay);
     virtual void EndTx(int relay);
+
+    // Keyers bracket a timed Tx with SetEdgeTime/ClearEdgeTime so outputs that
+    // can act on it (hardware-timed radio edges, MIDI timestamps) use the
+    // scheduled edge time rather than the moment the loop got around to it.
+    virtual void SetEdgeTime(unsigned long /*when*/) {}
+    virtual void ClearEdgeTime() {}
 };
 
+// Keyers run on a microsecond time base: SetDitDuration takes microseconds
+// and Tick is driven with micros(). Deadlines are compared wrap-safe, since
+// micros() rolls over every ~71 minutes.
 class Keyer {
 public:
     virtual void SetOutput(Transmitter *output);
     virtual void Reset();
-    virtual void SetDitDuration(unsigned int d);
+    virtual void SetDitDuration(unsigned long d);
     virtual void Release();
     virtual bool TxClosed();
     virtual bool TxClosed(int relay);
     virtual void Tx(int relay, bool closed);
     virtual void Key(Paddle key, bool pressed);
-    virtual void Tick(unsigned long millis);
+    virtual void Tick(unsigned long micros);
 };
 
 Keyer *GetKeyerByNumber(int n, Transmitter *output);
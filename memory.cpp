@@ -1,18 +1,162 @@
 #include "memory.h"
+#include "nvm_storage.h"
+#include "settings_eeprom.h"
 
-// Note: EEPROM operations are in main .ino file to avoid linking issues
+// Note: storage operations are in settings_eeprom.cpp
+
+// ============================================================================
+// Stored Memory Access
+// ============================================================================
+
+// Byte source for MemoryStreamReader; addresses are NVM offsets
+uint8_t memoryStreamReadByte(uint32_t address) {
+#if defined(ARDUINO_ARCH_SAMD)
+  // Flash is memory-mapped
+  return *nvmPointer(address);
+#else
+  uint8_t value;
+  nvmRead(address, &value, sizeof(value));
+  return value;
+#endif
+}
+
+// ============================================================================
+// Text Macros
+// ============================================================================
+
+#define TEXT_TOKEN_NONE 0
+#define TEXT_TOKEN_NR   1   // Contest serial number, cut numbers, 3 digits minimum
+#define TEXT_TOKEN_CALL 2   // Call sign from the settings store
+#define TEXT_TOKEN_RST  3   // 5NN
+
+#define TEXT_TOKEN_NAME_MAX 4
+#define TEXT_SERIAL_MIN_DIGITS 3
+
+// Contest cut numbers: 0 -> T, 1 -> A, 9 -> N
+static char cutNumber(uint8_t digit) {
+  if (digit == 0) return 'T';
+  if (digit == 1) return 'A';
+  if (digit == 9) return 'N';
+  return '0' + digit;
+}
+
+void TextCursor::begin(const StoredMemory& memory, bool consumeSerial) {
+  address = memory.dataOffset;
+  remaining = memory.dataLength;
+  token = TEXT_TOKEN_NONE;
+  tokenIndex = 0;
+  serial = getContestSerial();
+  takeSerial = consumeSerial;
+  serialTaken = false;
+}
+
+// Read a token name up to its closing brace; unknown names expand to nothing
+uint8_t TextCursor::readToken() {
+  char name[TEXT_TOKEN_NAME_MAX];
+  uint8_t length = 0;
+  bool tooLong = false;
+  while (remaining > 0) {
+    remaining--;
+    char c = memoryStreamReadByte(address++);
+    if (c == '}') break;
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    if (length < TEXT_TOKEN_NAME_MAX) name[length++] = c;
+    else tooLong = true;
+  }
+  if (tooLong) return TEXT_TOKEN_NONE;
+  if (length == 2 && memcmp(name, "NR", 2) == 0) return TEXT_TOKEN_NR;
+  if (length == 4 && memcmp(name, "CALL", 4) == 0) return TEXT_TOKEN_CALL;
+  if (length == 3 && memcmp(name, "RST", 3) == 0) return TEXT_TOKEN_RST;
+  return TEXT_TOKEN_NONE;
+}
+
+char TextCursor::tokenChar() {
+  uint8_t index = tokenIndex++;
+  switch (token) {
+    case TEXT_TOKEN_NR: {
+      if (takeSerial && !serialTaken) {
+        // The first {NR} of a send uses up the number; later ones repeat it
+        serialTaken = true;
+        saveContestSerialToEEPROM(serial < CONTEST_SERIAL_MAX ? serial + 1 : 1);
+      }
+      uint8_t digits = 1;
+      for (uint16_t n = serial; n >= 10; n /= 10) digits++;
+      if (digits < TEXT_SERIAL_MIN_DIGITS) digits = TEXT_SERIAL_MIN_DIGITS;
+      if (index >= digits) return 0;
+      uint16_t value = serial;
+      for (uint8_t i = index + 1; i < digits; i++) value /= 10;
+      return cutNumber(value % 10);
+    }
+    case TEXT_TOKEN_CALL:
+      return getCallSignChar(index);
+    case TEXT_TOKEN_RST:
+      return (index < 3) ? "5NN"[index] : 0;
+  }
+  return 0;
+}
+
+char TextCursor::next() {
+  for (;;) {
+    if (token != TEXT_TOKEN_NONE) {
+      char c = tokenChar();
+      if (c) return c;
+      token = TEXT_TOKEN_NONE;
+    }
+    if (remaining == 0) return 0;
+    remaining--;
+    char c = memoryStreamReadByte(address++);
+    if (c != '{') return c;
+    token = readToken();
+    tokenIndex = 0;
+  }
+}
+
+// Character source for MorseElementGenerator
+static char readTextCursor(void* context) {
+  return ((TextCursor*)context)->next();
+}
+
+uint32_t StoredMemory::getDurationMs() const {
+  uint32_t total = 0;
+  uint8_t paddle;
+  if (isText()) {
+    TextCursor cursor;
+    cursor.begin(*this, false);
+    MorseElementGenerator generator;
+    generator.begin(readTextCursor, &cursor);
+    uint8_t units;
+    while (generator.next(paddle, units)) {
+      total += units;
+    }
+    return total * unitMs;
+  }
+
+  MemoryStreamReader r = reader();
+  uint16_t duration;
+  while (r.next(paddle, duration)) {
+    total += duration;
+  }
+  return total;
+}
 
 // ============================================================================
 // Recording Operations
 // ============================================================================
 
-void startRecording(RecordingState& state, uint8_t slotNumber) {
+void startRecording(RecordingState& state, uint8_t slotNumber, uint16_t unitMs) {
   if (slotNumber >= MAX_MEMORY_SLOTS) return;
 
-  state.startRecording(slotNumber);
+  state.startRecording(slotNumber, unitMs, getMemorySpaceForSlot(slotNumber));
 
   Serial.print("Started recording to memory slot ");
-  Serial.println(slotNumber + 1);
+  Serial.print(slotNumber + 1);
+  Serial.print(" (format=");
+  Serial.print(state.stream.format());
+  Serial.print(" unit=");
+  Serial.print(state.stream.unitMs());
+  Serial.print("ms, ");
+  Serial.print(getMemorySpaceForSlot(slotNumber));
+  Serial.println(" bytes free)");
 }
 
 void recordKeyEvent(RecordingState& state, bool keyDown, uint8_t paddle) {
@@ -24,24 +168,23 @@ void recordKeyEvent(RecordingState& state, bool keyDown, uint8_t paddle) {
   // Handle the state transition
   if (keyDown != state.keyCurrentlyDown) {
     // On very first key down, don't record the delay before it - just start timing
-    if (state.transitionCount == 0 && !state.keyCurrentlyDown && keyDown) {
+    if (state.stream.transitionCount() == 0 && !state.keyCurrentlyDown && keyDown) {
       Serial.print("REC: First key DOWN - starting timing (paddle=");
       Serial.print(paddle == PADDLE_DIT_FLAG ? "DIT" : "DAH");
       Serial.println(")");
       state.currentPaddle = paddle;
-    } else if (state.transitionCount < MAX_TRANSITIONS_PER_MEMORY) {
-      // Record the previous transition with its paddle info
-      uint16_t encodedTransition = ENCODE_TRANSITION(state.currentPaddle, duration);
-      state.transitions[state.transitionCount++] = encodedTransition;
-
+    } else if (state.stream.append(state.currentPaddle, duration)) {
+      // Recorded the previous transition with its paddle info
       Serial.print("REC[");
-      Serial.print(state.transitionCount - 1);
+      Serial.print(state.stream.transitionCount() - 1);
       Serial.print("]: ");
       Serial.print(state.keyCurrentlyDown ? "DN" : "UP");  // Print what we just recorded (previous state duration)
       Serial.print(" paddle=");
       Serial.print(state.currentPaddle == PADDLE_DIT_FLAG ? "DIT" : "DAH");
       Serial.print(" dur=");
       Serial.print(duration);
+      Serial.print("ms stored=");
+      Serial.print(state.stream.lastDurationMs());
       Serial.println("ms");
 
       // If this was a key-up event ending, update the last key-release time
@@ -63,7 +206,7 @@ void recordKeyEvent(RecordingState& state, bool keyDown, uint8_t paddle) {
   }
 }
 
-void stopRecording(RecordingState& state, CWMemory& memory) {
+void stopRecording(RecordingState& state) {
   if (!state.isRecording) return;
 
   // Calculate the time elapsed since the last key-release
@@ -76,77 +219,185 @@ void stopRecording(RecordingState& state, CWMemory& memory) {
 
   // If the last recorded transition was a key-down (odd count), we need to add a final key-up
   // to properly end the tone. Use a short fixed duration (50ms) for this final spacing.
-  if (state.transitionCount > 0 && (state.transitionCount % 2) == 1) {
+  uint16_t count = state.stream.transitionCount();
+  if (count > 0 && (count % 2) == 1) {
     const uint16_t FINAL_KEY_UP_DURATION = 50; // Short spacing to end the final tone
-    if (state.transitionCount < MAX_TRANSITIONS_PER_MEMORY) {
-      uint16_t encodedTransition = ENCODE_TRANSITION(state.currentPaddle, FINAL_KEY_UP_DURATION);
-      state.transitions[state.transitionCount++] = encodedTransition;
+    if (state.stream.append(state.currentPaddle, FINAL_KEY_UP_DURATION)) {
       Serial.print("Added final key-UP transition: ");
       Serial.print(FINAL_KEY_UP_DURATION);
       Serial.println("ms");
     }
   }
 
-  // Copy the recording to the memory structure
-  memory.transitionCount = state.transitionCount;
-  for (uint16_t i = 0; i < state.transitionCount; i++) {
-    memory.transitions[i] = state.transitions[i];
-  }
-
+  state.stream.finish();
   state.stopRecording();
 
   Serial.print("Recorded ");
-  Serial.print(memory.transitionCount);
+  Serial.print(state.stream.transitionCount());
   Serial.print(" transitions (");
-  Serial.print(memory.getDurationMs());
-  Serial.println("ms)");
+  Serial.print(state.stream.durationMs());
+  Serial.print("ms) in ");
+  Serial.print(state.stream.length());
+  Serial.print(" bytes, RAW16 would take ");
+  Serial.print(state.stream.transitionCount() * 2);
+  Serial.println(" bytes");
 }
 
 // ============================================================================
 // Playback Operations
 // ============================================================================
 
-bool startPlayback(PlaybackState& state, uint8_t slotNumber, CWMemory& memory) {
+void PlaybackState::beginSend(unsigned long startTime) {
+  if (memory.isText()) {
+    textCursor.begin(memory, onAir);
+    text.begin(readTextCursor, &textCursor);
+  } else {
+    reader = memory.reader();
+  }
+  streamDone = false;
+  waitingToRepeat = false;
+  currentTransitionIndex = 0;
+  sendStartTime = startTime;
+  transitionStartTime = startTime;  // Start timing for first transition
+  keyCurrentlyDown = true;  // First transition is always key-down, start with key down
+  sendCount++;
+
+  // Decode the first transition
+  if (!loadNextTransition()) {
+    currentPaddle = 0;  // Default to DIT
+    currentDuration = 0;
+    keyCurrentlyDown = false;  // Nothing to send (e.g. text without Morse characters)
+    streamDone = true;
+  }
+}
+
+bool PlaybackState::loadNextTransition() {
+  if (memory.isText()) {
+    // Rendered at the playback speed directly, no tempo scaling
+    uint8_t units;
+    if (!text.next(currentPaddle, units)) return false;
+    currentDuration = (uint32_t)units * unitMs;
+    return true;
+  }
+
+  uint16_t recordedMs;
+  if (!reader.next(currentPaddle, recordedMs)) return false;
+
+#ifdef MEMORY_PLAYBACK_SNAP
+  // Square up elements to 1/3 and gaps to 1/3/7 recorded dits; longer
+  // pauses are deliberate and keep their length
+  uint16_t unit = memory.unitMs ? memory.unitMs : 1;
+  bool keyDown = (currentTransitionIndex & 1) == 0;
+  uint8_t units = 0;
+  if (recordedMs < 2 * unit) units = 1;
+  else if (keyDown || recordedMs < 5 * unit) units = 3;
+  else if (recordedMs < 10 * unit) units = 7;
+  if (units) recordedMs = units * unit;
+#endif
+
+  // Q4.12 multiply-shift; any 16-bit duration × 0xFFFF still fits 32 bits
+  currentDuration = ((uint32_t)recordedMs * tempoScale) >> 12;
+  return true;
+}
+
+bool startPlayback(PlaybackState& state, uint8_t slotNumber, const StoredMemory& memory,
+                   uint16_t playbackUnitMs, bool onAir) {
   if (slotNumber >= MAX_MEMORY_SLOTS) return false;
   if (memory.isEmpty()) return false;
 
-  state.startPlayback(slotNumber, &memory);
+  state.startPlayback(slotNumber, memory, playbackUnitMs, onAir);
 
   Serial.print("Started playback of memory slot ");
   Serial.print(slotNumber + 1);
   Serial.print(" (");
   Serial.print(memory.transitionCount);
-  Serial.print(" transitions, ");
-  Serial.print(memory.getDurationMs());
-  Serial.println("ms)");
+  Serial.print(memory.isText() ? " characters, " : " transitions, ");
+  Serial.print((memory.getDurationMs() / 16) * state.tempoScale / 256);
+  Serial.print("ms, recorded at ");
+  Serial.print(memory.unitMs);
+  Serial.print("ms/dit, playing at ");
+  Serial.print(playbackUnitMs ? playbackUnitMs : memory.unitMs);
+  Serial.println("ms/dit)");
 
   return true;
 }
 
+void repeatPlayback(PlaybackState& state, uint8_t repeatMode, uint32_t intervalMs) {
+  if (!state.isPlaying) return;
+  state.repeatMode = repeatMode;
+  state.repeatIntervalMs = intervalMs;
+
+  Serial.print("Repeating memory slot ");
+  Serial.print(state.slotNumber + 1);
+  Serial.print(repeatMode == PLAYBACK_REPEAT_PERIOD ? " every " : " with a gap of ");
+  Serial.print(intervalMs);
+  Serial.println("ms");
+}
+
+void abortPlayback(PlaybackState& state) {
+  if (!state.isPlaying) return;
+
+  // Count the part of an element already on the air
+  if (state.keyCurrentlyDown && !state.streamDone) {
+    unsigned long elapsed = millis() - state.transitionStartTime;
+    state.airTimeMs += (elapsed < state.currentDuration) ? elapsed : state.currentDuration;
+  }
+  state.streamDone = true;
+  state.repeatMode = PLAYBACK_REPEAT_OFF;
+  state.waitingToRepeat = false;
+  Serial.println("Playback aborted");
+}
+
 void updatePlayback(PlaybackState& state) {
-  if (!state.isPlaying || state.memory == nullptr) return;
+  if (!state.isPlaying) return;
+
+  unsigned long now = millis();
 
-  // Check if we're past the last transition (cleanup phase)
-  if (state.currentTransitionIndex >= state.memory->transitionCount) {
+  // Cleanup phase: the last transition has played out
+  if (state.streamDone) {
     // If key is still down, turn it off
     if (state.keyCurrentlyDown) {
       state.keyCurrentlyDown = false;
       Serial.println("Final key-UP before playback complete");
       return; // Let main loop process the key-up, then we'll stop on next update
     }
+
+    if (state.repeatMode != PLAYBACK_REPEAT_OFF) {
+      if (!state.waitingToRepeat) {
+        // Schedule the next send. Periods chain from the last scheduled start
+        // so a beacon doesn't drift; at least a word gap separates two sends.
+        unsigned long earliest = now + 7UL * state.unitMs;
+        unsigned long next = (state.repeatMode == PLAYBACK_REPEAT_PERIOD)
+                               ? state.sendStartTime + state.repeatIntervalMs
+                               : now + state.repeatIntervalMs;
+        if ((long)(next - earliest) < 0) next = earliest;
+        state.nextSendTime = next;
+        state.waitingToRepeat = true;
+        Serial.print("Next send in ");
+        Serial.print(next - now);
+        Serial.println("ms");
+      }
+      if ((long)(now - state.nextSendTime) >= 0) {
+        state.beginSend(state.nextSendTime);
+      }
+      return;
+    }
+
     // Key is up, safe to stop
+    Serial.print("Playback complete - ");
+    Serial.print(state.sendCount);
+    Serial.print(state.sendCount == 1 ? " send, " : " sends, ");
+    Serial.print(state.airTimeMs);
+    Serial.println("ms air time");
     state.stopPlayback();
-    Serial.println("Playback complete");
     return;
   }
 
-  unsigned long now = millis();
   unsigned long elapsed = now - state.transitionStartTime;
 
-  // Decode current transition
-  uint16_t encodedTransition = state.memory->transitions[state.currentTransitionIndex];
-  uint16_t duration = DECODE_DURATION(encodedTransition);
-  uint8_t paddle = DECODE_PADDLE(encodedTransition);
+  // Current transition was decoded when it started
+  uint32_t duration = state.currentDuration;
+  uint8_t paddle = state.currentPaddle;
 
   // Check if current transition is complete
   if (elapsed >= duration) {
@@ -161,19 +412,26 @@ void updatePlayback(PlaybackState& state) {
     Serial.print(duration);
     Serial.println("ms");
 
-    // Toggle key state for next transition
-    state.keyCurrentlyDown = !state.keyCurrentlyDown;
+    // The next transition starts at the deadline that just expired, so loop
+    // latency doesn't add up over a memory; after a real stall, restart from now
+    unsigned long deadline = state.transitionStartTime + duration;
+    if (now - deadline > (unsigned long)(state.unitMs / 4)) {
+      deadline = now;
+    }
+    state.transitionStartTime = deadline;
 
-    // Move to next transition
-    state.currentTransitionIndex++;
+    if (state.keyCurrentlyDown) {
+      state.airTimeMs += duration;
+    }
 
-    // Start timing for the next transition (if there is one)
-    if (state.currentTransitionIndex < state.memory->transitionCount) {
-      state.transitionStartTime = now;
-      // Decode the paddle for the NEXT transition (for correct routing on next key-down)
-      uint16_t nextEncoded = state.memory->transitions[state.currentTransitionIndex];
-      state.currentPaddle = DECODE_PADDLE(nextEncoded);
+    // Move to next transition. Decode it first (paddle for correct routing on
+    // the next key-down) and only toggle the key if there is one.
+    state.currentTransitionIndex++;
+    if (state.loadNextTransition()) {
+      state.keyCurrentlyDown = !state.keyCurrentlyDown;
+    } else {
+      state.streamDone = true;
+      state.keyCurrentlyDown = false;  // A stream cut short may end on a key-down
     }
   }
 }
-
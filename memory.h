@@ -2,107 +2,117 @@
 #define MEMORY_H
 
 #include <Arduino.h>
-// Note: FlashStorage_SAMD.h is included in main .ino file only to avoid linking issues
+#include "config.h"  // Board overrides for slot dimensions
 
 // ============================================================================
 // CW MEMORY STORAGE SYSTEM
 // ============================================================================
-// This module implements 3 independent CW memory slots with run-length
-// encoding for efficient storage of key timing sequences.
+// This module implements 3 independent CW memory slots that store key timing
+// sequences as alternating key-down/key-up durations WITH paddle info.
 //
 // Storage Format:
-// - Each memory slot stores alternating key-down/key-up durations WITH paddle info
-// - Format: uint16_t with bit 15 = paddle (0=DIT, 1=DAH), bits 0-14 = duration (ms)
-// - Max duration per transition: 32767ms (32.7 seconds, plenty for individual events)
+// - Each slot holds a transition stream in one of the formats described in
+//   memory_codec.h, chosen when recording starts and stored in the slot header
+// - MEMORY_FORMAT_UNITS (default) quantizes to the dit length in effect when
+//   recording started, keeping a 1/16 dit residual; keyer-generated memories
+//   take about a nibble per transition
+// - MEMORY_FORMAT_RAW16 keeps exact millisecond timing at 2 bytes per transition
+// - MEMORY_FORMAT_TEXT slots hold ASCII (loaded over MIDI SysEx) and are keyed
+//   by MorseElementGenerator as they play. {NR} (contest serial, cut numbers),
+//   {CALL} and {RST} are expanded a character at a time on the way in
 // - Recording is automatically trimmed to end at last key-release
-// - Maximum recording duration: 25 seconds
-// - Maximum transitions: 200 per slot (conservative estimate)
-//
-// Encoding/Decoding Macros:
-// - ENCODE_TRANSITION(paddle, duration): Combines paddle flag and duration into uint16_t
-// - DECODE_DURATION(encoded): Extracts duration from encoded value
-// - DECODE_PADDLE(encoded): Extracts paddle (0=DIT, 1=DAH) from encoded value
+// - Recording stops when free pool space or MAX_RECORDING_DURATION_MS runs out
 // ============================================================================
 
-// Transition encoding constants
-#define PADDLE_BIT_MASK 0x8000    // Bit 15
-#define DURATION_MASK   0x7FFF    // Bits 0-14
-#define PADDLE_DIT_FLAG 0         // Paddle = DIT
-#define PADDLE_DAH_FLAG 1         // Paddle = DAH
-
-// Encoding/decoding macros
-#define ENCODE_TRANSITION(paddle, duration) (((paddle) << 15) | ((duration) & DURATION_MASK))
-#define DECODE_DURATION(encoded) ((encoded) & DURATION_MASK)
-#define DECODE_PADDLE(encoded) (((encoded) & PADDLE_BIT_MASK) >> 15)
-
-// EEPROM Memory Map
-// -----------------
-// Addresses 0-5: Existing settings (see config.h)
-// Address 6: Start of CW memory storage
-
-#define EEPROM_MEMORY_START_ADDR 6
+#include "memory_codec.h"
+#include "morse_table.h"
 
 // Memory slot configuration (can be overridden by config.h for constrained targets)
+//
+// Slots share one storage pool: MAX_MEMORY_SLOTS is the size of the slot
+// directory, and a single slot may use any free part of MEMORY_POOL_SIZE.
+// The buttons address slots 1-3; further slots are for host-side tools.
 #ifndef MAX_MEMORY_SLOTS
-#define MAX_MEMORY_SLOTS 3
+#define MAX_MEMORY_SLOTS 8
 #endif
 #ifndef MAX_RECORDING_DURATION_MS
-#define MAX_RECORDING_DURATION_MS 25000  // 25 seconds
+#define MAX_RECORDING_DURATION_MS 180000 // 3 minutes
 #endif
-#ifndef MAX_TRANSITIONS_PER_MEMORY
-#define MAX_TRANSITIONS_PER_MEMORY 200   // Conservative: ~8 transitions/sec * 25 sec
+#ifndef MEMORY_POOL_SIZE
+#define MEMORY_POOL_SIZE 2560            // Stream bytes shared by all slots
+#endif
+#ifndef MEMORY_DATA_SIZE
+#define MEMORY_DATA_SIZE MEMORY_POOL_SIZE  // Longest single stream (recording buffer)
+#endif
+#ifndef MEMORY_RECORD_FORMAT
+#define MEMORY_RECORD_FORMAT MEMORY_FORMAT_UNITS
+#endif
+#ifndef MEMORY_TEXT_MAX_LENGTH
+#define MEMORY_TEXT_MAX_LENGTH 120       // Longest text memory (SysEx receive buffer)
 #endif
 
-// Each memory slot structure in EEPROM:
-// - 2 bytes: length (number of transitions stored)
-// - MAX_TRANSITIONS_PER_MEMORY × 2 bytes: transition data
-// Default: 200 transitions × 2 + 2 length = 402 bytes per slot
-
-#define MEMORY_LENGTH_SIZE 2
-#define MEMORY_DATA_SIZE (MAX_TRANSITIONS_PER_MEMORY * 2)
-#define MEMORY_SLOT_SIZE_BYTES (MEMORY_LENGTH_SIZE + MEMORY_DATA_SIZE)
-
-// EEPROM addresses for each memory slot
-#define EEPROM_MEMORY_1_ADDR (EEPROM_MEMORY_START_ADDR)
-#define EEPROM_MEMORY_2_ADDR (EEPROM_MEMORY_1_ADDR + MEMORY_SLOT_SIZE_BYTES)
-#define EEPROM_MEMORY_3_ADDR (EEPROM_MEMORY_2_ADDR + MEMORY_SLOT_SIZE_BYTES)
+static_assert(MAX_MEMORY_SLOTS >= 3, "The memory menu addresses slots 1-3");
+static_assert(MEMORY_DATA_SIZE <= MEMORY_POOL_SIZE, "A recording must fit the pool");
 
-// Total EEPROM usage: 6 (settings) + 3×402 (memories) = 1212 bytes
-// SAMD21 has 16KB, so we're using < 8% of available space
+// Saved slots are never copied into RAM: playback reads transitions in place
+// through StoredMemory. The only transition buffer in RAM is the recording
+// scratch buffer in RecordingState (MEMORY_DATA_SIZE bytes).
 
 // ============================================================================
 // Data Structures
 // ============================================================================
 
-// In-memory representation of a CW memory slot
-struct CWMemory {
-  uint16_t transitionCount;           // Number of transitions stored (0 = empty)
-  uint16_t transitions[MAX_TRANSITIONS_PER_MEMORY];  // Alternating key-down/key-up durations (ms)
+// Read-only view of a saved memory slot. The stream is decoded in place from
+// NVM (memory-mapped flash on SAMD21, EEPROM reads on AVR).
+struct StoredMemory {
+  uint32_t dataOffset;                // NVM offset of the transition stream
+  uint16_t dataLength;                // Stream length in bytes
+  uint16_t transitionCount;           // Number of transitions (characters for text; 0 = empty)
+  uint16_t unitMs;                    // Dit length at recording (or text upload) time
+  uint8_t format;                     // MEMORY_FORMAT_*
 
-  CWMemory() : transitionCount(0) {
-    // Initialize all transitions to 0
-    for (int i = 0; i < MAX_TRANSITIONS_PER_MEMORY; i++) {
-      transitions[i] = 0;
-    }
-  }
+  StoredMemory() : dataOffset(0), dataLength(0), transitionCount(0),
+                   unitMs(0), format(MEMORY_FORMAT_RAW16) {}
 
   bool isEmpty() const {
     return transitionCount == 0;
   }
 
-  void clear() {
-    transitionCount = 0;
-    // No need to clear the array, just reset the count
+  bool isText() const {
+    return format == MEMORY_FORMAT_TEXT;
   }
 
-  uint32_t getDurationMs() const {
-    // Calculate total duration of the memory in milliseconds
-    uint32_t total = 0;
-    for (uint16_t i = 0; i < transitionCount; i++) {
-      total += DECODE_DURATION(transitions[i]);
-    }
-    return total;
+  // Reader positioned at the first transition (transition stream formats)
+  MemoryStreamReader reader() const {
+    MemoryStreamReader r;
+    r.begin(format, unitMs, dataOffset, transitionCount);
+    return r;
   }
+
+  // Total duration in milliseconds at unitMs; text is rendered to count it
+  uint32_t getDurationMs() const;
+};
+
+// Character source over a text memory in NVM. Macro tokens are expanded as
+// they are reached; only the current token's state is held in RAM.
+struct TextCursor {
+  uint32_t address;                   // NVM offset of the next text byte
+  uint16_t remaining;                 // Text bytes left
+  uint8_t token;                      // Token being expanded (TEXT_TOKEN_* in memory.cpp)
+  uint8_t tokenIndex;                 // Next character of it
+  uint16_t serial;                    // Serial number {NR} expands to
+  bool takeSerial;                    // Sending for real: {NR} uses up the serial
+  bool serialTaken;
+
+  TextCursor() : address(0), remaining(0), token(0), tokenIndex(0), serial(0),
+                 takeSerial(false), serialTaken(false) {}
+
+  void begin(const StoredMemory& memory, bool consumeSerial);
+  char next();
+
+private:
+  uint8_t readToken();
+  char tokenChar();
 };
 
 // Recording state for capturing live CW input
@@ -114,18 +124,18 @@ struct RecordingState {
   unsigned long lastKeyReleaseTime;   // Time of last key-release (for trimming)
   bool keyCurrentlyDown;              // Current state of the key
   uint8_t currentPaddle;              // Which paddle is currently active (0=DIT, 1=DAH)
-  uint16_t transitionCount;           // Number of transitions captured so far
-  uint16_t transitions[MAX_TRANSITIONS_PER_MEMORY];  // Captured transitions (encoded with paddle info)
+  MemoryStreamWriter stream;          // Encoder for the recording in progress
+  uint8_t data[MEMORY_DATA_SIZE];     // Shared scratch buffer behind stream
 
   RecordingState() : slotNumber(0), isRecording(false), recordingStartTime(0),
                       lastEventTime(0), lastKeyReleaseTime(0), keyCurrentlyDown(false),
-                      currentPaddle(0), transitionCount(0) {
-    for (int i = 0; i < MAX_TRANSITIONS_PER_MEMORY; i++) {
-      transitions[i] = 0;
+                      currentPaddle(0) {
+    for (int i = 0; i < MEMORY_DATA_SIZE; i++) {
+      data[i] = 0;
     }
   }
 
-  void startRecording(uint8_t slot) {
+  void startRecording(uint8_t slot, uint16_t unitMs, uint16_t capacity) {
     slotNumber = slot;
     isRecording = true;
     recordingStartTime = millis();
@@ -133,7 +143,8 @@ struct RecordingState {
     lastKeyReleaseTime = recordingStartTime;
     keyCurrentlyDown = false;
     currentPaddle = 0;  // Start with DIT as default
-    transitionCount = 0;
+    stream.begin(MEMORY_RECORD_FORMAT, unitMs, data,
+                 capacity < MEMORY_DATA_SIZE ? capacity : MEMORY_DATA_SIZE);
   }
 
   void stopRecording() {
@@ -145,10 +156,16 @@ struct RecordingState {
   }
 
   bool hasReachedMaxTransitions() const {
-    return transitionCount >= MAX_TRANSITIONS_PER_MEMORY;
+    // Keep room for the closing key-up that stopRecording() may add
+    return !stream.hasRoom(2);
   }
 };
 
+// Repeat modes (beacon / CQ loop)
+#define PLAYBACK_REPEAT_OFF    0
+#define PLAYBACK_REPEAT_GAP    1  // Next send starts intervalMs after the last one ends
+#define PLAYBACK_REPEAT_PERIOD 2  // Sends start every intervalMs
+
 // Playback state for playing back a memory
 struct PlaybackState {
   bool isPlaying;                     // Currently playing flag
@@ -157,46 +174,92 @@ struct PlaybackState {
   unsigned long transitionStartTime;  // When current transition started
   bool keyCurrentlyDown;              // Current key state during playback
   uint8_t currentPaddle;              // Current paddle being played (0=DIT, 1=DAH)
-  CWMemory* memory;                   // Pointer to the memory being played
+  uint32_t currentDuration;           // Duration of the current transition (ms, scaled)
+  uint16_t tempoScale;                // Playback/recorded dit ratio, Q4.12 (4096 = 1:1)
+  uint16_t unitMs;                    // Dit length being played at
+  bool streamDone;                    // Last transition has played out
+  bool onAir;                         // Sent for real rather than previewed
+  uint8_t repeatMode;                 // PLAYBACK_REPEAT_*
+  uint32_t repeatIntervalMs;
+  bool waitingToRepeat;               // Between sends of a repeat
+  unsigned long sendStartTime;        // Scheduled start of the current send
+  unsigned long nextSendTime;         // Scheduled start of the next one
+  uint16_t sendCount;                 // Sends started since startPlayback
+  uint32_t airTimeMs;                 // Key-down time since startPlayback
+  StoredMemory memory;                // View of the memory being played
+  MemoryStreamReader reader;          // Decodes one transition ahead at a time
+  MorseElementGenerator text;         // Renders text memories instead of reader
+  TextCursor textCursor;              // Feeds text
 
   PlaybackState() : isPlaying(false), slotNumber(0), currentTransitionIndex(0),
-                     transitionStartTime(0), keyCurrentlyDown(false), currentPaddle(0), memory(nullptr) {}
+                     transitionStartTime(0), keyCurrentlyDown(false), currentPaddle(0),
+                     currentDuration(0), tempoScale(4096), unitMs(0), streamDone(false),
+                     onAir(false), repeatMode(PLAYBACK_REPEAT_OFF), repeatIntervalMs(0),
+                     waitingToRepeat(false), sendStartTime(0), nextSendTime(0), sendCount(0),
+                     airTimeMs(0) {}
 
-  void startPlayback(uint8_t slot, CWMemory* mem) {
+  // playbackUnitMs: dit length to play at (0 = as recorded)
+  // sendOnAir: sent for real rather than previewed; {NR} advances the serial number
+  void startPlayback(uint8_t slot, const StoredMemory& mem, uint16_t playbackUnitMs,
+                     bool sendOnAir) {
     slotNumber = slot;
     memory = mem;
+    unitMs = playbackUnitMs ? playbackUnitMs : mem.unitMs;
+    onAir = sendOnAir;
     isPlaying = true;
-    currentTransitionIndex = 0;
-    transitionStartTime = millis();  // Start timing for first transition
-    keyCurrentlyDown = true;  // First transition is always key-down, start with key down
-    // Decode paddle from first transition
-    if (mem->transitionCount > 0) {
-      currentPaddle = DECODE_PADDLE(mem->transitions[0]);
-    } else {
-      currentPaddle = 0;  // Default to DIT
+    repeatMode = PLAYBACK_REPEAT_OFF;
+    sendCount = 0;
+    airTimeMs = 0;
+
+    // One division per playback; each transition is then a multiply-shift
+    uint32_t scale = 4096;
+    if (playbackUnitMs != 0 && mem.unitMs != 0) {
+      scale = ((uint32_t)playbackUnitMs << 12) / mem.unitMs;
+      if (scale > 0xFFFF) scale = 0xFFFF;
+      if (scale == 0) scale = 1;
     }
+    tempoScale = scale;
+
+    beginSend(millis());
   }
 
+  // Rewind to the first transition of memory, due at startTime
+  void beginSend(unsigned long startTime);
+
+  // Decode the transition at currentTransitionIndex into currentPaddle and
+  // currentDuration, scaled to the playback tempo
+  bool loadNextTransition();
+
   void stopPlayback() {
     isPlaying = false;
     keyCurrentlyDown = false;
     currentPaddle = 0;
-    memory = nullptr;
+    currentDuration = 0;
+    streamDone = false;
+    repeatMode = PLAYBACK_REPEAT_OFF;
+    waitingToRepeat = false;
+    memory = StoredMemory();
+    reader = MemoryStreamReader();
+    text = MorseElementGenerator();
   }
 };
 
 // ============================================================================
 // Function Declarations
 // ============================================================================
-// Note: EEPROM functions are declared in main .ino file to avoid linking issues
+// Note: storage functions are declared in settings_eeprom.h
 
 // Recording operations
-void startRecording(RecordingState& state, uint8_t slotNumber);
-void stopRecording(RecordingState& state, CWMemory& memory);
+void startRecording(RecordingState& state, uint8_t slotNumber, uint16_t unitMs);
+void stopRecording(RecordingState& state);  // Finalizes state.stream in place
 void recordKeyEvent(RecordingState& state, bool keyDown, uint8_t paddle);
 
 // Playback operations
-bool startPlayback(PlaybackState& state, uint8_t slotNumber, CWMemory& memory);
+bool startPlayback(PlaybackState& state, uint8_t slotNumber, const StoredMemory& memory,
+                   uint16_t playbackUnitMs,  // Current dit length in ms (0 = as recorded)
+                   bool onAir);              // False for a piezo preview
+void repeatPlayback(PlaybackState& state, uint8_t repeatMode, uint32_t intervalMs);
+void abortPlayback(PlaybackState& state);   // Key-up follows on the next updatePlayback()
 void updatePlayback(PlaybackState& state);  // Call this in loop()
 
 #endif // MEMORY_H
@@ -0,0 +1,212 @@
+#include "memory_codec.h"
+
+// Nibble codes for MEMORY_FORMAT_UNITS (see memory_codec.h)
+#define UNITS_ESCAPE_12   0x0
+#define UNITS_MAX_SHORT   0xB
+#define UNITS_RESIDUAL    0xC
+#define UNITS_PADDLE_FLIP 0xD
+#define UNITS_ESCAPE_16   0xE
+#define UNITS_END         0xF
+
+#define UNITS_MAX_RESIDUAL_K 15
+
+uint16_t memoryResidualStepMs(uint16_t unitMs) {
+  uint16_t step = (unitMs + 8) / 16;
+  return step ? step : 1;
+}
+
+// Length class used for paddle prediction: 0 = dit-like, 1 = dah-like
+static inline uint8_t lengthClass(uint16_t durationMs, uint16_t unit) {
+  return ((uint32_t)durationMs >= 2UL * unit) ? 1 : 0;
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+MemoryStreamWriter::MemoryStreamWriter() {
+  begin(MEMORY_FORMAT_RAW16, 1, 0, 0);
+}
+
+void MemoryStreamWriter::begin(uint8_t format, uint16_t unitMs, uint8_t* buf, uint16_t cap) {
+  buffer = buf;
+  capacity = cap;
+  nibbles = 0;
+  count = 0;
+  totalMs = 0;
+  lastDuration = 0;
+  streamFormat = format;
+  if (unitMs < 1) unitMs = 1;
+  if (unitMs > MEMORY_MAX_UNIT_MS) unitMs = MEMORY_MAX_UNIT_MS;
+  unit = unitMs;
+  classPaddle[0] = PADDLE_DIT_FLAG;
+  classPaddle[1] = PADDLE_DAH_FLAG;
+}
+
+bool MemoryStreamWriter::hasRoom(uint16_t transitions) const {
+  uint32_t perTransition = (streamFormat == MEMORY_FORMAT_RAW16) ? 4 : MEMORY_MAX_TRANSITION_NIBBLES;
+  return nibbles + perTransition * transitions <= 2UL * capacity;
+}
+
+void MemoryStreamWriter::putNibble(uint8_t value) {
+  uint8_t& b = buffer[nibbles / 2];
+  if ((nibbles & 1) == 0) {
+    b = (value << 4) | UNITS_END;  // Low half stays an end marker until written
+  } else {
+    b = (b & 0xF0) | (value & 0x0F);
+  }
+  nibbles++;
+}
+
+bool MemoryStreamWriter::append(uint8_t paddle, uint32_t durationMs) {
+  if (!hasRoom(1)) return false;
+
+  uint16_t duration = (durationMs > DURATION_MASK) ? DURATION_MASK : (uint16_t)durationMs;
+  uint16_t decoded = duration;
+
+  if (streamFormat == MEMORY_FORMAT_RAW16) {
+    uint16_t encoded = ENCODE_TRANSITION(paddle, duration);
+    buffer[nibbles / 2] = encoded & 0xFF;
+    buffer[nibbles / 2 + 1] = encoded >> 8;
+    nibbles += 4;
+  } else {
+    // Nearest whole number of units, then the residual in 1/16 dit steps
+    uint16_t step = memoryResidualStepMs(unit);
+    uint16_t k = (duration + unit / 2) / unit;
+    int32_t rem = (int32_t)duration - (int32_t)k * unit;
+    // Halves round toward zero so 1ms of loop jitter still lands on a whole unit
+    int32_t q = (rem >= 0) ? (rem + (step - 1) / 2) / step : -((-rem + (step - 1) / 2) / step);
+
+    uint8_t symbol[5];
+    uint8_t symbolLen;
+    if (q == 0 && k >= 1 && k <= UNITS_MAX_SHORT) {
+      symbol[0] = k;
+      symbolLen = 1;
+      decoded = k * unit;
+    } else if (k <= UNITS_MAX_RESIDUAL_K && q >= -8 && q <= 7) {
+      symbol[0] = UNITS_RESIDUAL;
+      symbol[1] = k;
+      symbol[2] = q & 0x0F;
+      symbolLen = 3;
+      decoded = k * unit + q * step;
+    } else if (duration < 0x1000) {
+      symbol[0] = UNITS_ESCAPE_12;
+      symbol[1] = (duration >> 8) & 0x0F;
+      symbol[2] = (duration >> 4) & 0x0F;
+      symbol[3] = duration & 0x0F;
+      symbolLen = 4;
+    } else {
+      symbol[0] = UNITS_ESCAPE_16;
+      symbol[1] = (duration >> 12) & 0x0F;
+      symbol[2] = (duration >> 8) & 0x0F;
+      symbol[3] = (duration >> 4) & 0x0F;
+      symbol[4] = duration & 0x0F;
+      symbolLen = 5;
+    }
+
+    // Even transitions are key-downs; only those carry a paddle
+    if ((count & 1) == 0) {
+      uint8_t cls = lengthClass(decoded, unit);
+      if (classPaddle[cls] != paddle) {
+        putNibble(UNITS_PADDLE_FLIP);
+        classPaddle[cls] = paddle;
+      }
+    }
+    for (uint8_t i = 0; i < symbolLen; i++) {
+      putNibble(symbol[i]);
+    }
+  }
+
+  count++;
+  totalMs += decoded;
+  lastDuration = decoded;
+  return true;
+}
+
+uint16_t MemoryStreamWriter::finish() {
+  // putNibble already left an end marker in the low half of a partial byte
+  return length();
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+MemoryStreamReader::MemoryStreamReader() {
+  begin(MEMORY_FORMAT_RAW16, 1, 0, 0);
+}
+
+void MemoryStreamReader::begin(uint8_t format, uint16_t unitMs, uint32_t addr, uint16_t transitionCount) {
+  address = addr;
+  nibble = 0;
+  remaining = transitionCount;
+  unit = unitMs ? unitMs : 1;
+  streamFormat = format;
+  keyDown = true;
+  lastPaddle = PADDLE_DIT_FLAG;
+  classPaddle[0] = PADDLE_DIT_FLAG;
+  classPaddle[1] = PADDLE_DAH_FLAG;
+}
+
+uint8_t MemoryStreamReader::getNibble() {
+  uint8_t b = memoryStreamReadByte(address + nibble / 2);
+  uint8_t value = (nibble & 1) ? (b & 0x0F) : (b >> 4);
+  nibble++;
+  return value;
+}
+
+bool MemoryStreamReader::next(uint8_t& paddle, uint16_t& durationMs) {
+  if (remaining == 0) return false;
+
+  if (streamFormat == MEMORY_FORMAT_RAW16) {
+    uint16_t encoded = memoryStreamReadByte(address + nibble / 2) |
+                       ((uint16_t)memoryStreamReadByte(address + nibble / 2 + 1) << 8);
+    nibble += 4;
+    paddle = DECODE_PADDLE(encoded);
+    durationMs = DECODE_DURATION(encoded);
+    remaining--;
+    return true;
+  }
+
+  bool flip = false;
+  uint8_t code = getNibble();
+  if (code == UNITS_PADDLE_FLIP && keyDown) {
+    flip = true;
+    code = getNibble();
+  }
+
+  uint16_t duration;
+  if (code >= 1 && code <= UNITS_MAX_SHORT) {
+    duration = code * unit;
+  } else if (code == UNITS_RESIDUAL) {
+    uint8_t k = getNibble();
+    uint8_t r = getNibble();
+    int16_t q = (r >= 8) ? (int16_t)r - 16 : (int16_t)r;
+    duration = k * unit + q * memoryResidualStepMs(unit);
+  } else if (code == UNITS_ESCAPE_12) {
+    duration = getNibble() << 8;
+    duration |= getNibble() << 4;
+    duration |= getNibble();
+  } else if (code == UNITS_ESCAPE_16) {
+    duration = (uint16_t)getNibble() << 12;
+    duration |= getNibble() << 8;
+    duration |= getNibble() << 4;
+    duration |= getNibble();
+  } else {
+    // End marker or garbage before the expected count: stop here
+    remaining = 0;
+    return false;
+  }
+
+  if (keyDown) {
+    uint8_t cls = lengthClass(duration, unit);
+    lastPaddle = classPaddle[cls] ^ (flip ? 1 : 0);
+    classPaddle[cls] = lastPaddle;
+  }
+  paddle = lastPaddle;
+  durationMs = duration;
+
+  keyDown = !keyDown;
+  remaining--;
+  return true;
+}
@@ -0,0 +1,133 @@
+#ifndef MEMORY_CODEC_H
+#define MEMORY_CODEC_H
+
+#include <stdint.h>
+
+// ============================================================================
+// CW MEMORY TRANSITION STREAMS
+// ============================================================================
+// A memory slot stores alternating key-down/key-up durations, starting with a
+// key-down. The stream format is chosen per slot and recorded in its header:
+//
+// MEMORY_FORMAT_RAW16 - one uint16_t per transition (little-endian),
+//   bit 15 = paddle (0=DIT, 1=DAH), bits 0-14 = duration in ms.
+//
+// MEMORY_FORMAT_UNITS - a nibble stream (high nibble first) that expresses
+//   each duration in units of the dit length the slot was recorded at:
+//     0x1-0xB        k units exactly
+//     0xC k r        k units (0-15) + r residual steps (signed, -8..7)
+//     0x0 a b c      12-bit raw duration in ms (long gaps, odd timings)
+//     0xE a b c d    16-bit raw duration in ms
+//     0xD            prefix on a key-down: paddle differs from prediction
+//     0xF            end of stream (also the erased-flash value)
+//   A residual step is 1/16 dit (min 1ms), so a decoded duration is within
+//   half a step of the recording. The paddle of a key-down is predicted from
+//   the last key-down of the same length class (under/over two units): an
+//   iambic keyer or a straight key needs no paddle nibbles after the first
+//   element of each class. Key-ups carry the paddle of the preceding key-down.
+//
+// Keyer output lands on whole units, so a typical iambic recording costs one
+// nibble per transition - a quarter of RAW16.
+//
+// MEMORY_FORMAT_TEXT - ASCII text, rendered into elements at playback time by
+//   MorseElementGenerator (morse_table.h). The header's transition count is
+//   the text length. One byte per character against roughly ten transitions,
+//   and the text always plays at the current speed. Not a transition stream:
+//   MemoryStreamReader/Writer do not handle it.
+//
+// This file has no Arduino dependencies so the host benchmark in
+// tools/memory_codec_bench can build it as-is.
+// ============================================================================
+
+// Transition encoding constants (MEMORY_FORMAT_RAW16)
+#define PADDLE_BIT_MASK 0x8000    // Bit 15
+#define DURATION_MASK   0x7FFF    // Bits 0-14
+#define PADDLE_DIT_FLAG 0         // Paddle = DIT
+#define PADDLE_DAH_FLAG 1         // Paddle = DAH
+
+// Encoding/decoding macros
+#define ENCODE_TRANSITION(paddle, duration) (((paddle) << 15) | ((duration) & DURATION_MASK))
+#define DECODE_DURATION(encoded) ((encoded) & DURATION_MASK)
+#define DECODE_PADDLE(encoded) (((encoded) & PADDLE_BIT_MASK) >> 15)
+
+// Stream formats (stored in the slot header)
+#define MEMORY_FORMAT_RAW16 0
+#define MEMORY_FORMAT_UNITS 1
+#define MEMORY_FORMAT_TEXT  2
+
+// Largest unit the UNITS format accepts; anything longer is a broken setting
+#define MEMORY_MAX_UNIT_MS 4095
+
+// Worst-case size of one transition, in nibbles (paddle prefix + 16-bit escape)
+#define MEMORY_MAX_TRANSITION_NIBBLES 6
+
+// Residual resolution of MEMORY_FORMAT_UNITS: 1/16 dit, at least 1ms
+uint16_t memoryResidualStepMs(uint16_t unitMs);
+
+// Byte source for MemoryStreamReader. Provided by memory.cpp on the adapter
+// (memory-mapped flash or EEPROM) and by the host benchmark.
+uint8_t memoryStreamReadByte(uint32_t address);
+
+// Appends transitions to a caller-owned buffer
+class MemoryStreamWriter {
+public:
+    MemoryStreamWriter();
+
+    // Start a new stream; unitMs is only used by MEMORY_FORMAT_UNITS
+    void begin(uint8_t format, uint16_t unitMs, uint8_t* buffer, uint16_t capacity);
+
+    // True if the next `transitions` appends are guaranteed to fit
+    bool hasRoom(uint16_t transitions) const;
+
+    // False (and nothing written) if the buffer is full
+    bool append(uint8_t paddle, uint32_t durationMs);
+
+    // Pad to a whole byte with the end marker; returns the stream length
+    uint16_t finish();
+
+    uint8_t format() const { return streamFormat; }
+    uint16_t unitMs() const { return unit; }
+    const uint8_t* data() const { return buffer; }
+    uint16_t length() const { return (nibbles + 1) / 2; }  // Bytes used so far
+    uint16_t transitionCount() const { return count; }
+    uint32_t durationMs() const { return totalMs; }         // As it will play back
+    uint16_t lastDurationMs() const { return lastDuration; }
+
+private:
+    uint8_t* buffer;
+    uint16_t capacity;
+    uint16_t nibbles;
+    uint16_t count;
+    uint32_t totalMs;
+    uint16_t lastDuration;
+    uint16_t unit;
+    uint8_t streamFormat;
+    uint8_t classPaddle[2];
+
+    void putNibble(uint8_t value);
+};
+
+// Decodes a stream one transition at a time
+class MemoryStreamReader {
+public:
+    MemoryStreamReader();
+
+    void begin(uint8_t format, uint16_t unitMs, uint32_t address, uint16_t transitionCount);
+
+    // False once every transition has been read
+    bool next(uint8_t& paddle, uint16_t& durationMs);
+
+private:
+    uint32_t address;
+    uint16_t nibble;
+    uint16_t remaining;
+    uint16_t unit;
+    uint8_t streamFormat;
+    bool keyDown;
+    uint8_t lastPaddle;
+    uint8_t classPaddle[2];
+
+    uint8_t getNibble();
+};
+
+#endif // MEMORY_CODEC_H
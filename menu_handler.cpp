@@ -17,12 +17,12 @@ static MenuHandlerState menuState = {
   12,           // tempSpeedWPM (default 12 WPM = 100ms dit)
   69,           // tempToneNote (default A4 = 440Hz)
   8,            // tempKeyerType (default Iambic B)
+  DEFAULT_VOLUME,  // tempVolume
   0             // lastActivityTime
 };
 
 // Module-level references
 static VailAdapter* adapter = nullptr;
-static CWMemory* memorySlots = nullptr;
 static RecordingState* recordingState = nullptr;
 static PlaybackState* playbackState = nullptr;
 static FlushBounceCallback flushBounceCallback = nullptr;
@@ -32,12 +32,10 @@ static FlushBounceCallback flushBounceCallback = nullptr;
 // ============================================================================
 
 void initMenuHandler(VailAdapter* adapterRef,
-                     CWMemory* memoryRef,
                      RecordingState* recordingRef,
                      PlaybackState* playbackRef,
                      FlushBounceCallback flushCallback) {
   adapter = adapterRef;
-  memorySlots = memoryRef;
   recordingState = recordingRef;
   playbackState = playbackRef;
   flushBounceCallback = flushCallback;
@@ -51,16 +49,32 @@ MenuHandlerState& getMenuState() {
 // Conversion Utilities
 // ============================================================================
 
-int ditDurationToWPM(uint16_t ditDuration) {
-  // WPM = 1200 / dit_duration_ms
-  if (ditDuration == 0) return 12;  // Safety
-  return 1200 / ditDuration;
+int ditDurationToWPM(uint32_t ditDurationUs) {
+  // WPM = 1,200,000 / dit_duration_us (rounded to nearest)
+  if (ditDurationUs == 0) return 12;  // Safety
+  return (1200000UL + ditDurationUs / 2) / ditDurationUs;
 }
 
-uint16_t wpmToDitDuration(int wpm) {
-  // dit_duration_ms = 1200 / WPM
-  if (wpm <= 0) return 100;  // Safety
-  return 1200 / wpm;
+uint32_t wpmToDitDuration(int wpm) {
+  // dit_duration_us = 1,200,000 / WPM
+  if (wpm <= 0) return 100000;  // Safety
+  return 1200000UL / wpm;
+}
+
+// Send a dit duration to the adapter as a CC1/CC33 pair so menu speeds are
+// applied at full precision rather than the 2 ms steps of CC1 alone
+static void sendSpeedToAdapter(uint32_t ditDurationUs) {
+  uint32_t speedValue = MICROS_TO_SPEED_VALUE(ditDurationUs);
+  if (speedValue > SPEED_VALUE_MAX) speedValue = SPEED_VALUE_MAX;
+  midiEventPacket_t event;
+  event.header = 0x0B;
+  event.byte1 = 0xB0;
+  event.byte2 = 1;
+  event.byte3 = speedValue >> 7;
+  adapter->HandleMIDI(event);
+  event.byte2 = 33;
+  event.byte3 = speedValue & 0x7F;
+  adapter->HandleMIDI(event);
 }
 
 // ============================================================================
@@ -71,13 +85,7 @@ void applyTemporarySpeed(int wpm) {
   if (!adapter) return;
   // Apply speed to adapter without saving to EEPROM
   // This allows testing the speed before committing
-  uint16_t newDitDuration = wpmToDitDuration(wpm);
-  midiEventPacket_t event;
-  event.header = 0x0B;
-  event.byte1 = 0xB0;
-  event.byte2 = 1;
-  event.byte3 = newDitDuration / (2 * MILLISECOND);
-  adapter->HandleMIDI(event);
+  sendSpeedToAdapter(wpmToDitDuration(wpm));
 }
 
 void applyTemporaryTone(uint8_t noteNumber) {
@@ -109,6 +117,17 @@ void applyTemporaryKeyerType(uint8_t keyerType) {
   }
 }
 
+void applyTemporaryVolume(uint8_t volume) {
+  if (!adapter) return;
+  // Apply volume to adapter (CC7) so the cue plays at the new level
+  midiEventPacket_t event;
+  event.header = 0x0B;
+  event.byte1 = 0xB0;
+  event.byte2 = 7;
+  event.byte3 = VOLUME_TO_CC(volume);
+  adapter->HandleMIDI(event);
+}
+
 // ============================================================================
 // Button State to String Conversion
 // ============================================================================
@@ -173,9 +192,9 @@ static void handleQuickPressToneMode(ButtonState gestureDetected) {
     } else {
       applyTemporaryTone(menuState.tempToneNote);  // Apply so user can test
       // Play a quick beep at the new tone
-      tone(PIEZO_PIN, GET_EQUAL_TEMPERAMENT_NOTE(menuState.tempToneNote));
+      adapter->CueNote(menuState.tempToneNote);
       delay(100);
-      noTone(PIEZO_PIN);
+      adapter->CueOff();
       Serial.print("  -> Tone increased to MIDI note ");
       Serial.print(menuState.tempToneNote);
       Serial.print(" (");
@@ -192,9 +211,9 @@ static void handleQuickPressToneMode(ButtonState gestureDetected) {
     } else {
       applyTemporaryTone(menuState.tempToneNote);  // Apply so user can test
       // Play a quick beep at the new tone
-      tone(PIEZO_PIN, GET_EQUAL_TEMPERAMENT_NOTE(menuState.tempToneNote));
+      adapter->CueNote(menuState.tempToneNote);
       delay(100);
-      noTone(PIEZO_PIN);
+      adapter->CueOff();
       Serial.print("  -> Tone decreased to MIDI note ");
       Serial.print(menuState.tempToneNote);
       Serial.print(" (");
@@ -228,6 +247,34 @@ static void handleQuickPressKeyMode(ButtonState gestureDetected) {
   }
 }
 
+static void handleQuickPressVolumeMode(ButtonState gestureDetected) {
+  if (gestureDetected == BTN_1) {
+    // Increase volume
+    if (menuState.tempVolume >= VOLUME_MAX) {
+      playErrorTone();
+      Serial.println("  -> At maximum volume");
+    } else {
+      menuState.tempVolume++;
+      applyTemporaryVolume(menuState.tempVolume);  // Apply so user can hear it
+      adapter->PlayVolumeCue();
+      Serial.print("  -> Volume increased to ");
+      Serial.println(menuState.tempVolume);
+    }
+  } else if (gestureDetected == BTN_3) {
+    // Decrease volume; the lowest step stays audible so the cue can be heard
+    if (menuState.tempVolume <= 1) {
+      playErrorTone();
+      Serial.println("  -> At minimum volume");
+    } else {
+      menuState.tempVolume--;
+      applyTemporaryVolume(menuState.tempVolume);  // Apply so user can hear it
+      adapter->PlayVolumeCue();
+      Serial.print("  -> Volume decreased to ");
+      Serial.println(menuState.tempVolume);
+    }
+  }
+}
+
 static void handleQuickPressNormalMode(ButtonState gestureDetected) {
   // In normal mode: quick press plays memory via current output mode
   uint8_t slotNumber = 0;
@@ -236,11 +283,12 @@ static void handleQuickPressNormalMode(ButtonState gestureDetected) {
   else if (gestureDetected == BTN_3) slotNumber = 2;
   else return;  // Not a single button press
 
-  if (!memorySlots[slotNumber].isEmpty()) {
+  StoredMemory memory;
+  if (openStoredMemory(slotNumber, memory)) {
     Serial.print("  -> Playing memory slot ");
     Serial.print(slotNumber + 1);
     Serial.println(" via current output mode");
-    startPlayback(*playbackState, slotNumber, memorySlots[slotNumber]);
+    startPlayback(*playbackState, slotNumber, memory, adapter->getDitDuration(), true);
     menuState.currentMode = MODE_PLAYING_MEMORY;
   } else {
     Serial.print("  -> Memory slot ");
@@ -249,6 +297,29 @@ static void handleQuickPressNormalMode(ButtonState gestureDetected) {
   }
 }
 
+static void handleQuickPressPlayingMode(ButtonState gestureDetected) {
+  // While a memory plays (once or repeating): any button stops it
+  if (gestureDetected == BTN_NONE) return;
+  Serial.println("  -> Stopping memory playback");
+  abortPlayback(*playbackState);
+}
+
+static void handleDoubleClickPlayingMode(ButtonState gestureDetected) {
+  // Second click on the button that started playback: repeat it (CQ loop / beacon)
+  uint8_t slotNumber = 0;
+  if (gestureDetected == BTN_1) slotNumber = 0;
+  else if (gestureDetected == BTN_2) slotNumber = 1;
+  else if (gestureDetected == BTN_3) slotNumber = 2;
+  else return;  // Not a single button double-click
+
+  if (!playbackState->isPlaying || playbackState->slotNumber != slotNumber) return;
+#ifdef MEMORY_REPEAT_PERIOD_MS
+  repeatPlayback(*playbackState, PLAYBACK_REPEAT_PERIOD, MEMORY_REPEAT_PERIOD_MS);
+#else
+  repeatPlayback(*playbackState, PLAYBACK_REPEAT_GAP, MEMORY_REPEAT_GAP_MS);
+#endif
+}
+
 static void handleQuickPressRecordingMode(ButtonState gestureDetected) {
   // In recording mode: single-click stops and saves recording
   uint8_t activeSlot = (menuState.currentMode == MODE_RECORDING_MEMORY_1) ? 0 :
@@ -263,8 +334,8 @@ static void handleQuickPressRecordingMode(ButtonState gestureDetected) {
 
   if (clickedSlot == activeSlot) {
     Serial.println("  -> Stopping recording (user-triggered)");
-    stopRecording(*recordingState, memorySlots[activeSlot]);
-    saveMemoryToEEPROM(activeSlot, memorySlots[activeSlot]);
+    stopRecording(*recordingState);
+    saveMemoryToEEPROM(activeSlot, recordingState->stream);
 
     // Play confirmation tone
     playAdjustmentBeep(true);
@@ -284,17 +355,20 @@ static void handleQuickPressMemoryManagementMode(ButtonState gestureDetected) {
   else if (gestureDetected == BTN_3) slotNumber = 2;
   else return;  // Not a single button press
 
+  StoredMemory memory;
+  bool stored = openStoredMemory(slotNumber, memory);
+
   Serial.print("  -> Attempting playback of slot ");
   Serial.print(slotNumber + 1);
   Serial.print(" - transitions: ");
-  Serial.print(memorySlots[slotNumber].transitionCount);
+  Serial.print(memory.transitionCount);
   Serial.print(", duration: ");
-  Serial.print(memorySlots[slotNumber].getDurationMs());
+  Serial.print(memory.getDurationMs());
   Serial.println("ms");
 
-  if (!memorySlots[slotNumber].isEmpty()) {
+  if (stored && !memory.isEmpty()) {
     Serial.println("  -> Starting playback (piezo only)");
-    startPlayback(*playbackState, slotNumber, memorySlots[slotNumber]);
+    startPlayback(*playbackState, slotNumber, memory, adapter->getDitDuration(), false);
     // Note: Playback happens in the background via updatePlayback() in loop()
   } else {
     Serial.println("  -> ERROR: Memory slot is empty!");
@@ -313,7 +387,7 @@ static void handleLongPressNormalMode(ButtonState currentState, unsigned long cu
       playMorseWord("SPEED");
       menuState.currentMode = MODE_SPEED_SETTING;
       if (adapter) {
-        menuState.tempSpeedWPM = ditDurationToWPM(adapter->getDitDuration());
+        menuState.tempSpeedWPM = ditDurationToWPM(adapter->getDitDurationMicros());
       }
       applyTemporarySpeed(menuState.tempSpeedWPM);  // Apply current speed so user can test
       menuState.lastActivityTime = currentTime;  // Reset timeout timer
@@ -367,15 +441,10 @@ static void handleLongPressSpeedMode(ButtonState currentState) {
     Serial.println(" - Saving and exiting SPEED mode");
 
     // Convert WPM to dit duration and apply to adapter
-    uint16_t newDitDuration = wpmToDitDuration(menuState.tempSpeedWPM);
+    uint32_t newDitDuration = wpmToDitDuration(menuState.tempSpeedWPM);
 
     // Update adapter settings via MIDI commands (same as loadSettingsFromEEPROM does)
-    midiEventPacket_t event;
-    event.header = 0x0B;
-    event.byte1 = 0xB0;
-    event.byte2 = 1;
-    event.byte3 = newDitDuration / (2 * MILLISECOND);
-    adapter->HandleMIDI(event);
+    sendSpeedToAdapter(newDitDuration);
 
     // Save to EEPROM
     saveSettingsToEEPROM(adapter->getCurrentKeyerType(), newDitDuration, adapter->getTxNote());
@@ -384,7 +453,7 @@ static void handleLongPressSpeedMode(ButtonState currentState) {
     Serial.print(menuState.tempSpeedWPM);
     Serial.print(" WPM (");
     Serial.print(newDitDuration);
-    Serial.println("ms dit duration)");
+    Serial.println("us dit duration)");
 
     // Play confirmation and return to normal mode
     playMorseWord("RR");
@@ -406,7 +475,7 @@ static void handleLongPressToneMode(ButtonState currentState) {
     adapter->HandleMIDI(event);
 
     // Save to EEPROM
-    saveSettingsToEEPROM(adapter->getCurrentKeyerType(), adapter->getDitDuration(), menuState.tempToneNote);
+    saveSettingsToEEPROM(adapter->getCurrentKeyerType(), adapter->getDitDurationMicros(), menuState.tempToneNote);
 
     Serial.print("Saved tone: MIDI note ");
     Serial.print(menuState.tempToneNote);
@@ -439,7 +508,7 @@ static void handleLongPressKeyMode(ButtonState currentState) {
     }
 
     // Save to EEPROM
-    saveSettingsToEEPROM(menuState.tempKeyerType, adapter->getDitDuration(), adapter->getTxNote());
+    saveSettingsToEEPROM(menuState.tempKeyerType, adapter->getDitDurationMicros(), adapter->getTxNote());
 
     Serial.print("Saved keyer type: ");
     Serial.println(getKeyerTypeName(menuState.tempKeyerType));
@@ -450,6 +519,23 @@ static void handleLongPressKeyMode(ButtonState currentState) {
   }
 }
 
+static void handleLongPressVolumeMode(ButtonState currentState) {
+  // In volume mode: B2 long press saves and exits
+  if (currentState == BTN_2 && adapter) {
+    Serial.println(" - Saving and exiting VOLUME mode");
+
+    // Update adapter (CC7 also stores the volume)
+    applyTemporaryVolume(menuState.tempVolume);
+
+    Serial.print("Saved volume: ");
+    Serial.println(menuState.tempVolume);
+
+    // Play confirmation and return to normal mode
+    playMorseWord("RR");
+    menuState.currentMode = MODE_NORMAL;
+  }
+}
+
 static void handleLongPressMemoryManagementMode(ButtonState currentState) {
   // In memory management mode: long press clears the memory slot
   uint8_t slotNumber = 0;
@@ -464,7 +550,10 @@ static void handleLongPressMemoryManagementMode(ButtonState currentState) {
   Serial.print(" - Clearing memory slot ");
   Serial.println(slotNumber + 1);
 
-  memorySlots[slotNumber].clear();
+  // Playback reads the slot in place, so it must not outlive the data
+  if (playbackState->isPlaying && playbackState->slotNumber == slotNumber) {
+    playbackState->stopPlayback();
+  }
   clearMemoryInEEPROM(slotNumber);
 
   playMemoryClearedAnnouncement(slotNumber);
@@ -479,13 +568,8 @@ static void handleTimeoutSpeedMode(unsigned long currentTime) {
     Serial.println(">>> TIMEOUT - Auto-saving and exiting SPEED mode");
 
     // Save current settings
-    uint16_t newDitDuration = wpmToDitDuration(menuState.tempSpeedWPM);
-    midiEventPacket_t event;
-    event.header = 0x0B;
-    event.byte1 = 0xB0;
-    event.byte2 = 1;
-    event.byte3 = newDitDuration / (2 * MILLISECOND);
-    adapter->HandleMIDI(event);
+    uint32_t newDitDuration = wpmToDitDuration(menuState.tempSpeedWPM);
+    sendSpeedToAdapter(newDitDuration);
     saveSettingsToEEPROM(adapter->getCurrentKeyerType(), newDitDuration, adapter->getTxNote());
 
     Serial.print("Auto-saved speed: ");
@@ -509,7 +593,7 @@ static void handleTimeoutToneMode(unsigned long currentTime) {
     event.byte2 = 2;
     event.byte3 = menuState.tempToneNote;
     adapter->HandleMIDI(event);
-    saveSettingsToEEPROM(adapter->getCurrentKeyerType(), adapter->getDitDuration(), menuState.tempToneNote);
+    saveSettingsToEEPROM(adapter->getCurrentKeyerType(), adapter->getDitDurationMicros(), menuState.tempToneNote);
 
     Serial.print("Auto-saved tone: MIDI note ");
     Serial.print(menuState.tempToneNote);
@@ -534,7 +618,7 @@ static void handleTimeoutKeyMode(unsigned long currentTime) {
     event.byte2 = menuState.tempKeyerType;
     event.byte3 = 0;
     adapter->HandleMIDI(event);
-    saveSettingsToEEPROM(menuState.tempKeyerType, adapter->getDitDuration(), adapter->getTxNote());
+    saveSettingsToEEPROM(menuState.tempKeyerType, adapter->getDitDurationMicros(), adapter->getTxNote());
 
     Serial.print("Auto-saved keyer type: ");
     Serial.println(getKeyerTypeName(menuState.tempKeyerType));
@@ -545,12 +629,27 @@ static void handleTimeoutKeyMode(unsigned long currentTime) {
   }
 }
 
+static void handleTimeoutVolumeMode(unsigned long currentTime) {
+  if ((currentTime - menuState.lastActivityTime) >= SETTING_MODE_TIMEOUT && adapter) {
+    Serial.println(">>> TIMEOUT - Auto-saving and exiting VOLUME mode");
+
+    applyTemporaryVolume(menuState.tempVolume);
+
+    Serial.print("Auto-saved volume: ");
+    Serial.println(menuState.tempVolume);
+
+    // Play descending tones and return to normal mode
+    playDescendingTones();
+    menuState.currentMode = MODE_NORMAL;
+  }
+}
+
 // ============================================================================
 // Main Menu Update Function
 // ============================================================================
 
 void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebouncer) {
-  if (!adapter || !memorySlots || !recordingState || !playbackState) return;
+  if (!adapter || !recordingState || !playbackState) return;
 
   // Read button state with debouncing
   int analogVal = readButtonAnalog();
@@ -572,6 +671,12 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
     // Check for double-click FIRST to trigger recording (before handling quick press)
     bool isDoubleClick = buttonDebouncer.isDoubleClick();
 
+    if (isDoubleClick && menuState.currentMode == MODE_PLAYING_MEMORY) {
+      Serial.println(" [DOUBLE-CLICK]");
+      handleDoubleClickPlayingMode(gestureDetected);
+      return;  // Exit early - don't process as quick press
+    }
+
     if (isDoubleClick && menuState.currentMode == MODE_MEMORY_MANAGEMENT) {
       // Only allow double-click recording in memory management mode
       uint8_t slotNumber = 0;
@@ -595,7 +700,7 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
       playRecordingCountdown();
 
       // Start recording
-      startRecording(*recordingState, slotNumber);
+      startRecording(*recordingState, slotNumber, adapter->getDitDuration());
 
       // Switch to recording mode
       if (slotNumber == 0) menuState.currentMode = MODE_RECORDING_MEMORY_1;
@@ -627,9 +732,15 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
         case MODE_KEY_SETTING:
           handleQuickPressKeyMode(gestureDetected);
           break;
+        case MODE_VOLUME_SETTING:
+          handleQuickPressVolumeMode(gestureDetected);
+          break;
         case MODE_NORMAL:
           handleQuickPressNormalMode(gestureDetected);
           break;
+        case MODE_PLAYING_MEMORY:
+          handleQuickPressPlayingMode(gestureDetected);
+          break;
         case MODE_RECORDING_MEMORY_1:
         case MODE_RECORDING_MEMORY_2:
         case MODE_RECORDING_MEMORY_3:
@@ -664,6 +775,9 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
       case MODE_KEY_SETTING:
         handleLongPressKeyMode(currentState);
         break;
+      case MODE_VOLUME_SETTING:
+        handleLongPressVolumeMode(currentState);
+        break;
       case MODE_MEMORY_MANAGEMENT:
         handleLongPressMemoryManagementMode(currentState);
         break;
@@ -695,6 +809,17 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
         playDescendingTones();
         menuState.currentMode = MODE_NORMAL;
       }
+    } else if (currentState == BTN_2_3 && menuState.currentMode == MODE_NORMAL) {
+      // B2+B3 combo enters volume mode
+      Serial.println(" - Entering VOLUME mode");
+      playMorseWord("VOL");
+      menuState.currentMode = MODE_VOLUME_SETTING;
+      menuState.tempVolume = adapter->getVolume();
+      if (menuState.tempVolume < 1) menuState.tempVolume = 1;  // Unmute so the cues are heard
+      applyTemporaryVolume(menuState.tempVolume);
+      menuState.lastActivityTime = currentTime;  // Reset timeout timer
+      Serial.print("Current volume: ");
+      Serial.println(menuState.tempVolume);
     } else {
       Serial.println();
     }
@@ -706,6 +831,7 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
     Serial.print(">>> MIDI SWITCH PRESS DETECTED (3s B1+B2): ");
 
     if (adapter) {
+      // CW keyboard mode (CC0 only) counts as keyboard mode and goes to MIDI
       bool currentMode = adapter->KeyboardMode();
 
       if (currentMode) {
@@ -745,6 +871,9 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
     case MODE_KEY_SETTING:
       handleTimeoutKeyMode(currentTime);
       break;
+    case MODE_VOLUME_SETTING:
+      handleTimeoutVolumeMode(currentTime);
+      break;
     default:
       break;
   }
@@ -12,6 +12,7 @@ typedef enum {
   MODE_SPEED_SETTING,
   MODE_TONE_SETTING,
   MODE_KEY_SETTING,
+  MODE_VOLUME_SETTING,
   MODE_MEMORY_MANAGEMENT,
   MODE_RECORDING_MEMORY_1,
   MODE_RECORDING_MEMORY_2,
@@ -25,6 +26,7 @@ struct MenuHandlerState {
   int tempSpeedWPM;
   uint8_t tempToneNote;
   uint8_t tempKeyerType;
+  uint8_t tempVolume;
   unsigned long lastActivityTime;
 };
 
@@ -33,7 +35,6 @@ typedef void (*FlushBounceCallback)();
 
 // Initialize menu handler
 void initMenuHandler(VailAdapter* adapterRef,
-                     CWMemory* memoryRef,
                      RecordingState* recordingRef,
                      PlaybackState* playbackRef,
                      FlushBounceCallback flushCallback = nullptr);
@@ -48,12 +49,13 @@ void updateMenuHandler(unsigned long currentTime, ButtonDebouncer& buttonDebounc
 const char* buttonStateToString(ButtonState state);
 
 // Conversion utilities
-int ditDurationToWPM(uint16_t ditDuration);
-uint16_t wpmToDitDuration(int wpm);
+int ditDurationToWPM(uint32_t ditDurationUs);
+uint32_t wpmToDitDuration(int wpm);  // Returns microseconds
 
 // Apply temporary settings (for testing before committing)
 void applyTemporarySpeed(int wpm);
 void applyTemporaryTone(uint8_t noteNumber);
 void applyTemporaryKeyerType(uint8_t keyerType);
+void applyTemporaryVolume(uint8_t volume);
 
 #endif // MENU_HANDLER_H
@@ -1,6 +1,6 @@
 #include "morse_audio.h"
 #include "config.h"
-#include "equal_temperament.h"
+#include "morse_table.h"
 
 // Valid keyer types for cycling
 #define KEYER_STRAIGHT 1
@@ -9,60 +9,69 @@
 
 // Static module-level references (set during init)
 static VailAdapter* adapter = nullptr;
-static int piezoPin = 0;
 
-void initMorseAudio(VailAdapter* adapterRef, int piezoPinRef) {
+void initMorseAudio(VailAdapter* adapterRef) {
   adapter = adapterRef;
-  piezoPin = piezoPinRef;
 }
 
 // ============================================================================
 // Morse Code Playback Functions
 // ============================================================================
+// Everything is sent from the shared Morse table (morse_table.h) through
+// MorseElementGenerator, as text memories are, so any character or prosign
+// in the table can be announced. All of this module's sound goes out on the
+// adapter's cue slot, so it follows the sidetone output and volume.
+
+// Character sources for MorseElementGenerator over a C string, in RAM or
+// in PROGMEM (fixed texts, kept out of SRAM on AVR)
+static char readString(void* context) {
+  const char** text = (const char**)context;
+  return **text ? *(*text)++ : 0;
+}
 
-void playMorseDit() {
-  if (!adapter) return;
-  uint8_t note = adapter->getTxNote();
-  uint16_t ditDur = adapter->getDitDuration();
-
-  tone(piezoPin, GET_EQUAL_TEMPERAMENT_NOTE(note));
-  delay(ditDur);
-  noTone(piezoPin);
-  delay(ditDur);  // Inter-element space = 1 dit
+static char readFlashString(void* context) {
+  const char** text = (const char**)context;
+  char c = pgm_read_byte(*text);
+  if (c) (*text)++;
+  return c;
 }
 
-void playMorseDah() {
+// Send text at ditDur ms per dit, the LED following the tone if showLed.
+// Ends with the 1 dit gap after the last element.
+static void playText(MorseTextSource source, const char* text, uint8_t noteNumber, uint16_t ditDur,
+                     bool showLed) {
   if (!adapter) return;
-  uint8_t note = adapter->getTxNote();
-  uint16_t ditDur = adapter->getDitDuration();
+  MorseElementGenerator generator;
+  generator.begin(source, &text);
+  uint8_t paddle, units;
+  bool keyDown = true;
+  while (generator.next(paddle, units)) {
+    if (keyDown) {
+#ifndef NO_LED
+      if (showLed) digitalWrite(LED_BUILTIN, LED_ON);
+#endif
+      adapter->CueNote(noteNumber);
+    }
+    delay((uint32_t)ditDur * units);
+    if (keyDown) {
+#ifndef NO_LED
+      if (showLed) digitalWrite(LED_BUILTIN, LED_OFF);
+#endif
+      adapter->CueOff();
+    }
+    keyDown = !keyDown;
+  }
+}
 
-  tone(piezoPin, GET_EQUAL_TEMPERAMENT_NOTE(note));
-  delay(ditDur * 3);
-  noTone(piezoPin);
-  delay(ditDur);  // Inter-element space = 1 dit
+// Send text at the user's speed and tone
+static void playAnnouncement(MorseTextSource source, const char* text) {
+  if (!adapter) return;
+  playText(source, text, adapter->getTxNote(), adapter->getDitDuration(), false);
 }
 
 void playMorseChar(char c) {
-  switch(c) {
-    case 'A': playMorseDit(); playMorseDah(); break;
-    case 'C': playMorseDah(); playMorseDit(); playMorseDah(); playMorseDit(); break;
-    case 'D': playMorseDah(); playMorseDit(); playMorseDit(); break;
-    case 'E': playMorseDit(); break;
-    case 'I': playMorseDit(); playMorseDit(); break;
-    case 'K': playMorseDah(); playMorseDit(); playMorseDah(); break;
-    case 'L': playMorseDit(); playMorseDah(); playMorseDit(); playMorseDit(); break;
-    case 'M': playMorseDah(); playMorseDah(); break;
-    case 'N': playMorseDah(); playMorseDit(); break;
-    case 'O': playMorseDah(); playMorseDah(); playMorseDah(); break;
-    case 'P': playMorseDit(); playMorseDah(); playMorseDah(); playMorseDit(); break;
-    case 'R': playMorseDit(); playMorseDah(); playMorseDit(); break;
-    case 'S': playMorseDit(); playMorseDit(); playMorseDit(); break;
-    case 'T': playMorseDah(); break;
-    case 'Y': playMorseDah(); playMorseDit(); playMorseDah(); playMorseDah(); break;
-    case '1': playMorseDit(); playMorseDah(); playMorseDah(); playMorseDah(); playMorseDah(); break;
-    case '2': playMorseDit(); playMorseDit(); playMorseDah(); playMorseDah(); playMorseDah(); break;
-    case '3': playMorseDit(); playMorseDit(); playMorseDit(); playMorseDah(); playMorseDah(); break;
-  }
+  char text[2] = {c, 0};
+  playAnnouncement(readString, text);
   // Inter-character space = 3 dits (we already have 1 from last element)
   if (adapter) {
     delay(adapter->getDitDuration() * 2);
@@ -70,13 +79,10 @@ void playMorseChar(char c) {
 }
 
 void playMorseWord(const char* word) {
-  while (*word) {
-    playMorseChar(*word);
-    word++;
-  }
-  // Inter-word space = 7 dits (we already have 3 from last char)
+  playAnnouncement(readString, word);
+  // Inter-word space = 7 dits (we already have 1 from last element)
   if (adapter) {
-    delay(adapter->getDitDuration() * 4);
+    delay(adapter->getDitDuration() * 6);
   }
 }
 
@@ -84,41 +90,10 @@ void playMorseWord(const char* word) {
 // Startup Sequence Functions
 // ============================================================================
 
-void playDot(uint8_t noteNumber) {
-#ifndef NO_LED
-  digitalWrite(LED_BUILTIN, LED_ON);
-#endif
-  tone(piezoPin, GET_EQUAL_TEMPERAMENT_NOTE(noteNumber));
-  delay(DOT_DURATION);
-#ifndef NO_LED
-  digitalWrite(LED_BUILTIN, LED_OFF);
-#endif
-  noTone(piezoPin);
-  delay(ELEMENT_SPACE);
-}
-
-void playDash(uint8_t noteNumber) {
-#ifndef NO_LED
-  digitalWrite(LED_BUILTIN, LED_ON);
-#endif
-  tone(piezoPin, GET_EQUAL_TEMPERAMENT_NOTE(noteNumber));
-  delay(DASH_DURATION);
-#ifndef NO_LED
-  digitalWrite(LED_BUILTIN, LED_OFF);
-#endif
-  noTone(piezoPin);
-  delay(ELEMENT_SPACE);
-}
+static const char startupText[] PROGMEM = "VAIL";
 
 void playVAIL(uint8_t noteNumber) {
-  playDot(noteNumber); playDot(noteNumber); playDot(noteNumber); playDash(noteNumber);
-  delay(CHAR_SPACE - ELEMENT_SPACE);
-  playDot(noteNumber); playDash(noteNumber);
-  delay(CHAR_SPACE - ELEMENT_SPACE);
-  playDot(noteNumber); playDot(noteNumber);
-  delay(CHAR_SPACE - ELEMENT_SPACE);
-  playDot(noteNumber); playDash(noteNumber); playDot(noteNumber); playDot(noteNumber);
-  noTone(piezoPin);
+  playText(readFlashString, startupText, noteNumber, DOT_DURATION, true);
 }
 
 // ============================================================================
@@ -128,58 +103,58 @@ void playVAIL(uint8_t noteNumber) {
 void playAdjustmentBeep(bool isIncrease) {
   if (!adapter) return;
   uint8_t note = adapter->getTxNote();
-  uint16_t frequency;
 
   if (isIncrease) {
     // Higher tone for increase (3 semitones up)
-    uint8_t highNote = min(note + 3, 127);
-    frequency = GET_EQUAL_TEMPERAMENT_NOTE(highNote);
+    note = min(note + 3, 127);
   } else {
     // Lower tone for decrease (3 semitones down)
-    uint8_t lowNote = max((int)note - 3, 0);
-    frequency = GET_EQUAL_TEMPERAMENT_NOTE(lowNote);
+    note = max((int)note - 3, 0);
   }
 
-  tone(piezoPin, frequency);
+  adapter->CueNote(note);
   delay(50);  // 50ms beep
-  noTone(piezoPin);
+  adapter->CueOff();
 }
 
 void playErrorTone() {
-  tone(piezoPin, 200);  // Low 200 Hz buzz
+  if (!adapter) return;
+  adapter->CueTone(200);  // Low 200 Hz buzz
   delay(200);  // 200ms duration
-  noTone(piezoPin);
+  adapter->CueOff();
 }
 
 void playDescendingTones() {
+  if (!adapter) return;
   // Descending tone pattern for timeout/exit without save
   int frequencies[] = {1000, 900, 800, 700, 600, 500, 400};
   for (int i = 0; i < 7; i++) {
-    tone(piezoPin, frequencies[i]);
+    adapter->CueTone(frequencies[i]);
     delay(100);
-    noTone(piezoPin);
+    adapter->CueOff();
     if (i < 6) delay(20);  // Small gap between tones
   }
 }
 
 void playRecordingCountdown() {
+  if (!adapter) return;
   // "doot, doot, dah" countdown pattern (inspired by Mario Kart)
   // First doot: 800 Hz, 200ms
-  tone(piezoPin, 800);
+  adapter->CueTone(800);
   delay(200);
-  noTone(piezoPin);
+  adapter->CueOff();
   delay(200);  // Pause
 
   // Second doot: 800 Hz, 200ms
-  tone(piezoPin, 800);
+  adapter->CueTone(800);
   delay(200);
-  noTone(piezoPin);
+  adapter->CueOff();
   delay(200);  // Pause
 
   // Dah: 600 Hz, 600ms
-  tone(piezoPin, 600);
+  adapter->CueTone(600);
   delay(600);
-  noTone(piezoPin);
+  adapter->CueOff();
   delay(200);  // Pause before recording starts
 }
 
@@ -211,64 +186,21 @@ const char* getKeyerTypeName(uint8_t keyerType) {
   }
 }
 
-void playKeyerTypeCode(uint8_t keyerType) {
-  if (!adapter) return;
-  // Play Morse code identifier for the keyer type
-  uint16_t ditDur = adapter->getDitDuration();
-  uint16_t charSpace = ditDur * 3;
+// Morse identifier for each keyer type, indexed by type
+static const char keyerTypeCodes[][3] PROGMEM = {
+  "",     // 0: No keyer
+  "S",    // 1: Straight
+  "B",    // 2: Bug
+  "EB",   // 3: ElBug
+  "SD",   // 4: SingleDot
+  "U",    // 5: Ultimatic
+  "P",    // 6: Plain
+  "IA",   // 7: Iambic A
+  "IB",   // 8: Iambic B
+  "K",    // 9: Keyahead
+};
 
-  switch (keyerType) {
-    case 1:  // Straight
-      // S = ... (dit dit dit)
-      playMorseDit(); playMorseDit(); playMorseDit();
-      break;
-    case 2:  // Bug
-      // B = -... (dah dit dit dit)
-      playMorseDah(); playMorseDit(); playMorseDit(); playMorseDit();
-      break;
-    case 3:  // ElBug
-      // EB = . -... (E then B)
-      // E = .
-      playMorseDit();
-      delay(charSpace - ditDur);  // Space between letters
-      // B = -...
-      playMorseDah(); playMorseDit(); playMorseDit(); playMorseDit();
-      break;
-    case 4:  // SingleDot
-      // SD = ... -.. (S then D)
-      // S = ...
-      playMorseDit(); playMorseDit(); playMorseDit();
-      delay(charSpace - ditDur);  // Space between letters
-      // D = -..
-      playMorseDah(); playMorseDit(); playMorseDit();
-      break;
-    case 5:  // Ultimatic
-      // U = ..- (dit dit dah)
-      playMorseDit(); playMorseDit(); playMorseDah();
-      break;
-    case 6:  // Plain
-      // P = .--. (dit dah dah dit)
-      playMorseDit(); playMorseDah(); playMorseDah(); playMorseDit();
-      break;
-    case 7:  // Iambic A
-      // IA = .. .- (I then A)
-      // I = ..
-      playMorseDit(); playMorseDit();
-      delay(charSpace - ditDur);  // Space between letters
-      // A = .-
-      playMorseDit(); playMorseDah();
-      break;
-    case 8:  // Iambic B
-      // IB = .. -... (I then B)
-      // I = ..
-      playMorseDit(); playMorseDit();
-      delay(charSpace - ditDur);  // Space between letters
-      // B = -...
-      playMorseDah(); playMorseDit(); playMorseDit(); playMorseDit();
-      break;
-    case 9:  // Keyahead
-      // K = -.- (dah dit dah)
-      playMorseDah(); playMorseDit(); playMorseDah();
-      break;
-  }
+void playKeyerTypeCode(uint8_t keyerType) {
+  if (keyerType >= sizeof(keyerTypeCodes) / sizeof(keyerTypeCodes[0])) return;
+  playAnnouncement(readFlashString, keyerTypeCodes[keyerType]);
 }
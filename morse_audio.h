@@ -7,15 +7,12 @@
 // Forward declarations
 class VailAdapter;
 
-// Morse code playback using adapter settings (user's current WPM and tone)
-void playMorseDit();
-void playMorseDah();
+// Morse code playback using adapter settings (user's current WPM and tone).
+// Any character in the Morse table can be sent; prosigns as "<SK>".
 void playMorseChar(char c);
 void playMorseWord(const char* word);
 
 // Startup sequence
-void playDot(uint8_t noteNumber);
-void playDash(uint8_t noteNumber);
 void playVAIL(uint8_t noteNumber);
 
 // Audio feedback tones
@@ -30,6 +27,6 @@ void playKeyerTypeCode(uint8_t keyerType);
 const char* getKeyerTypeName(uint8_t keyerType);
 
 // Initialize with adapter reference
-void initMorseAudio(VailAdapter* adapterRef, int piezoPinRef);
+void initMorseAudio(VailAdapter* adapterRef);
 
 #endif // MORSE_AUDIO_H
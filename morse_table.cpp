@@ -0,0 +1,152 @@
+#include "morse_table.h"
+
+#if defined(__AVR__)
+  #include <avr/pgmspace.h>
+  #define MORSE_TABLE_READ(p) pgm_read_byte(p)
+#else
+  #ifndef PROGMEM
+    #define PROGMEM
+  #endif
+  #define MORSE_TABLE_READ(p) (*(p))
+#endif
+
+// Paddle flags, as in memory_codec.h
+#define MORSE_DIT 0
+#define MORSE_DAH 1
+
+// Gap lengths in dit units
+#define MORSE_ELEMENT_GAP 1
+#define MORSE_CHARACTER_GAP 3
+#define MORSE_WORD_GAP 7
+
+// ASCII 0x20-0x5F, see morse_table.h for the packing
+static constexpr uint8_t morseTable[64] PROGMEM = {
+  0x00, 0x6B, 0x52, 0x00, 0x89, 0x00, 0x28, 0x5E,  //   ! " # $ % & '
+  0x36, 0x6D, 0x00, 0x2A, 0x73, 0x61, 0x55, 0x32,  // ( ) * + , - . /
+  0x3F, 0x2F, 0x27, 0x23, 0x21, 0x20, 0x30, 0x38,  // 0 1 2 3 4 5 6 7
+  0x3C, 0x3E, 0x78, 0x6A, 0x00, 0x31, 0x00, 0x4C,  // 8 9 : ; < = > ?
+  0x5A, 0x05, 0x18, 0x1A, 0x0C, 0x02, 0x12, 0x0E,  // @ A B C D E F G
+  0x10, 0x04, 0x17, 0x0D, 0x14, 0x07, 0x06, 0x0F,  // H I J K L M N O
+  0x16, 0x1D, 0x0A, 0x08, 0x03, 0x09, 0x11, 0x0B,  // P Q R S T U V W
+  0x19, 0x1B, 0x1C, 0x00, 0x00, 0x00, 0x00, 0x4D,  // X Y Z [ \ ] ^ _
+};
+
+// The implicit trie: the same table by code, for codes of up to six
+// elements. The only longer one ($) is found by searching morseTable.
+static constexpr char morseTrie[128] PROGMEM = {
+    0,   0, 'E', 'T', 'I', 'A', 'N', 'M',  // 00-07
+  'S', 'U', 'R', 'W', 'D', 'K', 'G', 'O',  // 08-0F
+  'H', 'V', 'F',   0, 'L',   0, 'P', 'J',  // 10-17
+  'B', 'X', 'C', 'Y', 'Z', 'Q',   0,   0,  // 18-1F
+  '5', '4',   0, '3',   0,   0,   0, '2',  // 20-27
+  '&',   0, '+',   0,   0,   0,   0, '1',  // 28-2F
+  '6', '=', '/',   0,   0,   0, '(',   0,  // 30-37
+  '7',   0,   0,   0, '8',   0, '9', '0',  // 38-3F
+    0,   0,   0,   0,   0,   0,   0,   0,  // 40-47
+    0,   0,   0,   0, '?', '_',   0,   0,  // 48-4F
+    0,   0, '"',   0,   0, '.',   0,   0,  // 50-57
+    0,   0, '@',   0,   0,   0, '\'',   0,  // 58-5F
+    0, '-',   0,   0,   0,   0,   0,   0,  // 60-67
+    0,   0, ';', '!',   0, ')',   0,   0,  // 68-6F
+    0,   0,   0, ',',   0,   0,   0,   0,  // 70-77
+  ':',   0,   0,   0,   0,   0,   0,   0,  // 78-7F
+};
+
+// Both tables are written out, so the build checks that each is the
+// other's inverse: a character added to one and not the other fails here
+static constexpr bool trieHasTable(int i) {
+  return i == sizeof(morseTable) ||
+         ((morseTable[i] == 0 || morseTable[i] >= sizeof(morseTrie) ||
+           morseTrie[morseTable[i]] == 0x20 + i) && trieHasTable(i + 1));
+}
+
+static constexpr bool tableHasTrie(int code) {
+  return code == sizeof(morseTrie) ||
+         ((morseTrie[code] == 0 || morseTable[morseTrie[code] - 0x20] == code) &&
+          tableHasTrie(code + 1));
+}
+
+static_assert(trieHasTable(0) && tableHasTrie(0), "morseTrie must invert morseTable");
+
+uint8_t morseCode(char c) {
+  if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+  if (c < 0x20 || c > 0x5F) return 0;
+  return MORSE_TABLE_READ(&morseTable[c - 0x20]);
+}
+
+// The code is the trie node a decoder reaches (dit = 2n, dah = 2n + 1 from
+// the root at 1), so the walk ends in a single read
+char morseCharacter(uint8_t code) {
+  if (code < sizeof(morseTrie)) return MORSE_TABLE_READ(&morseTrie[code]);
+  for (uint8_t i = 0; i < sizeof(morseTable); i++) {
+    if (MORSE_TABLE_READ(&morseTable[i]) == code) return 0x20 + i;
+  }
+  return 0;
+}
+
+MorseElementGenerator::MorseElementGenerator()
+  : source(0), context(0), pattern(0), elements(0), lastPaddle(MORSE_DIT),
+    keyDown(true), inProsign(false), finished(true) {}
+
+void MorseElementGenerator::begin(MorseTextSource textSource, void* textContext) {
+  source = textSource;
+  context = textContext;
+  lastPaddle = MORSE_DIT;
+  keyDown = true;
+  inProsign = false;
+  uint8_t gap;
+  finished = !loadCharacter(gap);  // Leading spaces are dropped
+}
+
+bool MorseElementGenerator::loadCharacter(uint8_t& gap) {
+  gap = inProsign ? MORSE_ELEMENT_GAP : MORSE_CHARACTER_GAP;
+  for (;;) {
+    char c = source ? source(context) : 0;
+    if (c == 0) {
+      elements = 0;
+      return false;
+    }
+    if (c == '<') {
+      inProsign = true;
+    } else if (c == '>') {
+      // Whatever follows the prosign is a character of its own
+      inProsign = false;
+      if (gap < MORSE_CHARACTER_GAP) gap = MORSE_CHARACTER_GAP;
+    } else if (c == ' ') {
+      // Each space is a full word gap, so "  " reads as a longer pause
+      uint16_t longer = (gap < MORSE_WORD_GAP) ? MORSE_WORD_GAP : gap + MORSE_WORD_GAP;
+      gap = (longer > 255) ? 255 : longer;
+    } else {
+      uint8_t code = morseCode(c);
+      if (code == 0) continue;  // Nothing to send; keep the gap as it is
+      pattern = code;
+      elements = 7;
+      while (!(code & (1 << elements))) elements--;
+      return true;
+    }
+  }
+}
+
+bool MorseElementGenerator::next(uint8_t& paddle, uint8_t& units) {
+  if (finished) return false;
+
+  if (keyDown) {
+    elements--;
+    lastPaddle = (pattern >> elements) & 1;
+    paddle = lastPaddle;
+    units = (lastPaddle == MORSE_DAH) ? 3 : 1;
+    keyDown = false;
+    return true;
+  }
+
+  paddle = lastPaddle;
+  keyDown = true;
+  if (elements > 0) {
+    units = MORSE_ELEMENT_GAP;
+  } else if (!loadCharacter(units)) {
+    // Closing key-up; trailing spaces are dropped
+    units = MORSE_ELEMENT_GAP;
+    finished = true;
+  }
+  return true;
+}
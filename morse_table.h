@@ -0,0 +1,66 @@
+#ifndef MORSE_TABLE_H
+#define MORSE_TABLE_H
+
+#include <stdint.h>
+
+// ============================================================================
+// MORSE CODE TABLE AND ELEMENT GENERATOR
+// ============================================================================
+// morseCode() maps ASCII to a packed code: the elements are the bits below
+// the highest set bit, first element first, 1 = dah. 'A' (.-) is 0b101 and
+// '$' (...-..-) is 0b10001001. The table covers the ITU letters, figures and
+// punctuation plus the common ! & $ _ extensions; lowercase folds to upper.
+//
+// Prosigns are written as their letters in angle brackets, e.g. "<SK>" or
+// "<BT>": the letters are sent with no character gap between them.
+//
+// MorseElementGenerator turns a character source into alternating key-down/
+// key-up lengths in dit units, one transition per call, the same shape as a
+// recorded memory stream. Nothing is buffered beyond the current character,
+// so text can be read straight out of NVM. Text memories, the menu
+// announcements (morse_audio.h) and the decoder (cw_decoder.h) all send or
+// read through this one table.
+//
+// This file has no Arduino dependencies so host tools can build it as-is.
+// ============================================================================
+
+// Packed code for c, or 0 if c has no Morse equivalent
+uint8_t morseCode(char c);
+
+// The packing doubles as a binary trie: the root (no elements yet) is code
+// MORSE_TRIE_ROOT, and an element moves from node n to 2n for a dit or
+// 2n + 1 for a dah, so a decoder walks it one element at a time.
+#define MORSE_TRIE_ROOT 1
+
+// Character at a trie node (a packed code), or 0 if no character ends there
+char morseCharacter(uint8_t code);
+
+// Next character of the text, or 0 at the end
+typedef char (*MorseTextSource)(void* context);
+
+class MorseElementGenerator {
+public:
+    MorseElementGenerator();
+
+    void begin(MorseTextSource source, void* context);
+
+    // Element (key-down) or gap (key-up) length in dit units; paddle is
+    // PADDLE_DAH_FLAG for dahs and key-ups carry the preceding element's.
+    // False once the closing key-up has been returned.
+    bool next(uint8_t& paddle, uint8_t& units);
+
+private:
+    MorseTextSource source;
+    void* context;
+    uint8_t pattern;       // Packed code of the current character
+    uint8_t elements;      // Elements of it not yet sent
+    uint8_t lastPaddle;
+    bool keyDown;          // Next transition is an element
+    bool inProsign;
+    bool finished;
+
+    // Load the next sendable character; gap is the key-up before it
+    bool loadCharacter(uint8_t& gap);
+};
+
+#endif // MORSE_TABLE_H
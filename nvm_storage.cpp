@@ -0,0 +1,139 @@
+#include "nvm_storage.h"
+#if !defined(ARDUINO_ARCH_SAMD)
+  #include <EEPROM.h>
+#endif
+
+// ============================================================================
+// CRC
+// ============================================================================
+
+uint16_t nvmCrc16(uint32_t offset, uint16_t len) {
+#if defined(ARDUINO_ARCH_SAMD)
+  return crc16Update(0xFFFF, nvmPointer(offset), len);
+#else
+  uint16_t crc = 0xFFFF;
+  uint8_t chunk[16];
+  while (len > 0) {
+    uint16_t n = (len < sizeof(chunk)) ? len : sizeof(chunk);
+    nvmRead(offset, chunk, n);
+    crc = crc16Update(crc, chunk, n);
+    offset += n;
+    len -= n;
+  }
+  return crc;
+#endif
+}
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+// ============================================================================
+// SAMD21 Flash Backend (NVMCTRL)
+// ============================================================================
+
+// The region occupies the last rows of flash; the sketch image grows up from
+// the bootloader and stays far below it
+#define NVM_REGION_BASE (FLASH_SIZE - NVM_REGION_SIZE)
+
+static_assert(NVM_REGION_SIZE % NVM_BLOCK_SIZE == 0, "NVM region must be whole rows");
+
+static inline void nvmWaitReady() {
+  while (NVMCTRL->INTFLAG.bit.READY == 0);
+}
+
+static inline void nvmCommand(uint32_t address, uint16_t command) {
+  nvmWaitReady();
+  NVMCTRL->STATUS.reg = NVMCTRL_STATUS_MASK;  // Clear any previous error
+  NVMCTRL->ADDR.reg = address / 2;            // ADDR takes a 16-bit word address
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | command;
+  nvmWaitReady();
+}
+
+const uint8_t* nvmPointer(uint32_t offset) {
+  return (const uint8_t*)(NVM_REGION_BASE + offset);
+}
+
+void nvmRead(uint32_t offset, void* dst, uint16_t len) {
+  memcpy(dst, nvmPointer(offset), len);
+}
+
+void nvmEraseBlock(uint32_t offset) {
+  uint32_t address = NVM_REGION_BASE + (offset - (offset % NVM_BLOCK_SIZE));
+  nvmCommand(address, NVMCTRL_CTRLA_CMD_ER);
+}
+
+void nvmWrite(uint32_t offset, const void* src, uint16_t len) {
+  const uint8_t* bytes = (const uint8_t*)src;
+  uint32_t address = NVM_REGION_BASE + offset;
+
+  // Manual page writes: fill the page buffer, then issue WP explicitly
+  NVMCTRL->CTRLB.bit.MANW = 1;
+
+  while (len > 0) {
+    uint16_t chunk = (len < NVM_WRITE_SIZE) ? len : NVM_WRITE_SIZE;
+
+    nvmCommand(address, NVMCTRL_CTRLA_CMD_PBC);
+
+    // The page buffer only accepts 32-bit writes
+    volatile uint32_t* dst = (volatile uint32_t*)address;
+    for (uint16_t i = 0; i < NVM_WRITE_SIZE; i += 4) {
+      uint32_t word = 0;
+      for (uint8_t b = 0; b < 4; b++) {
+        uint8_t value = (i + b < chunk) ? bytes[i + b] : 0xFF;
+        word |= (uint32_t)value << (8 * b);
+      }
+      *dst++ = word;
+    }
+
+    nvmCommand(address, NVMCTRL_CTRLA_CMD_WP);
+
+    address += NVM_WRITE_SIZE;
+    bytes += chunk;
+    len -= chunk;
+  }
+}
+
+bool nvmIsErased(uint32_t offset, uint16_t len) {
+  const uint8_t* p = nvmPointer(offset);
+  for (uint16_t i = 0; i < len; i++) {
+    if (p[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+#else
+
+// ============================================================================
+// AVR EEPROM Backend
+// ============================================================================
+
+// The region sits at the top of the EEPROM, clear of the legacy settings at 0-5
+#define NVM_REGION_BASE (E2END + 1 - NVM_REGION_SIZE)
+
+static_assert(NVM_REGION_SIZE <= E2END + 1 - 6, "NVM region does not fit in EEPROM");
+
+void nvmRead(uint32_t offset, void* dst, uint16_t len) {
+  uint8_t* bytes = (uint8_t*)dst;
+  for (uint16_t i = 0; i < len; i++) {
+    bytes[i] = EEPROM.read(NVM_REGION_BASE + offset + i);
+  }
+}
+
+void nvmEraseBlock(uint32_t offset) {
+  (void)offset;  // EEPROM bytes are rewritten in place
+}
+
+void nvmWrite(uint32_t offset, const void* src, uint16_t len) {
+  const uint8_t* bytes = (const uint8_t*)src;
+  for (uint16_t i = 0; i < len; i++) {
+    EEPROM.update(NVM_REGION_BASE + offset + i, bytes[i]);
+  }
+}
+
+bool nvmIsErased(uint32_t offset, uint16_t len) {
+  for (uint16_t i = 0; i < len; i++) {
+    if (EEPROM.read(NVM_REGION_BASE + offset + i) != 0xFF) return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef NVM_STORAGE_H
+#define NVM_STORAGE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "memory.h"
+#include "crc16.h"
+
+// ============================================================================
+// NON-VOLATILE STORAGE BACKEND
+// ============================================================================
+// A small region of non-volatile storage that the adapter manages itself,
+// addressed by offset from the start of the region.
+//
+// SAMD21: the top rows of program flash, written directly through NVMCTRL.
+//   - Erase unit is a row (NVM_BLOCK_SIZE = 256 bytes); erased bytes read 0xFF
+//   - Write unit is a page (NVM_WRITE_SIZE = 64 bytes) and needs erased flash
+//   - Reads are plain memory reads; nvmPointer() gives zero-copy access
+//   - Lives outside the sketch image, so it is kept across firmware updates
+//
+// AVR: the native EEPROM. Bytes are rewritten in place (EEPROM.update), so
+//   there is nothing to erase and every byte is its own write unit.
+//
+// Region layout (offsets from the region start):
+//   NVM_SETTINGS_LOG_OFFSET  settings record log (see settings_eeprom.cpp)
+//   NVM_MEMORY_OFFSET        CW memory slot directory (two copies) and the
+//                            shared pool of slot streams
+// ============================================================================
+
+#if defined(ARDUINO_ARCH_SAMD)
+  #define NVM_BLOCK_SIZE 256
+  #define NVM_WRITE_SIZE 64
+  #define NVM_ERASE_BEFORE_WRITE 1
+  #define NVM_SETTINGS_LOG_SIZE (4 * NVM_BLOCK_SIZE)
+#else
+  #define NVM_BLOCK_SIZE 1
+  #define NVM_WRITE_SIZE 1
+  #define NVM_ERASE_BEFORE_WRITE 0
+  #define NVM_SETTINGS_LOG_SIZE 256
+#endif
+
+#define NVM_ROUND_UP(n, unit) ((((n) + (unit) - 1) / (unit)) * (unit))
+
+// CW memories: two copies of the slot directory (each in its own blocks),
+// then the pool that holds every slot's transition stream
+#define NVM_MEMORY_DIR_RECORD_SIZE (6 + 12 * MAX_MEMORY_SLOTS)
+#define NVM_MEMORY_DIR_COPY_SIZE NVM_ROUND_UP(NVM_MEMORY_DIR_RECORD_SIZE, NVM_BLOCK_SIZE)
+#define NVM_MEMORY_POOL_SIZE NVM_ROUND_UP(MEMORY_POOL_SIZE, NVM_BLOCK_SIZE)
+
+#define NVM_SETTINGS_LOG_OFFSET 0
+#define NVM_MEMORY_OFFSET (NVM_SETTINGS_LOG_OFFSET + NVM_SETTINGS_LOG_SIZE)
+#define NVM_MEMORY_DIR_OFFSET NVM_MEMORY_OFFSET
+#define NVM_MEMORY_POOL_OFFSET (NVM_MEMORY_DIR_OFFSET + 2 * NVM_MEMORY_DIR_COPY_SIZE)
+#define NVM_MEMORY_SIZE (2 * NVM_MEMORY_DIR_COPY_SIZE + NVM_MEMORY_POOL_SIZE)
+#define NVM_REGION_SIZE (NVM_MEMORY_OFFSET + NVM_MEMORY_SIZE)
+
+static_assert(NVM_MEMORY_POOL_SIZE <= 0xFFFF, "Pool offsets are 16-bit");
+
+// Copy len bytes at offset into dst
+void nvmRead(uint32_t offset, void* dst, uint16_t len);
+
+// Erase the block containing offset (no-op where blocks don't exist)
+void nvmEraseBlock(uint32_t offset);
+
+// Write len bytes at offset; offset must be NVM_WRITE_SIZE aligned and the
+// target erased. A partial last write unit is padded with 0xFF.
+void nvmWrite(uint32_t offset, const void* src, uint16_t len);
+
+// True if len bytes at offset all read as erased (0xFF)
+bool nvmIsErased(uint32_t offset, uint16_t len);
+
+#if defined(ARDUINO_ARCH_SAMD)
+// Memory-mapped view of the region for zero-copy reads
+const uint8_t* nvmPointer(uint32_t offset);
+#endif
+
+// CRC-16 of len bytes of the region at offset, read in place
+uint16_t nvmCrc16(uint32_t offset, uint16_t len);
+
+#endif // NVM_STORAGE_H
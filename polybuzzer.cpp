@@ -2,30 +2,223 @@
 #include "polybuzzer.h"
 #include "equal_temperament.h"
 
+#ifdef SIDETONE_DAC
+// Sine amplitude (Q15) for each volume step, 3 dB apart
+static const uint16_t volumeGains[VOLUME_MAX + 1] = {
+    0, 1464, 2068, 2920, 4125, 5827, 8231, 11627, 16423, 23198, 32768,
+};
+#endif
+
+#ifdef POLYBUZZER_PWM
+#include "wiring_private.h"
+
+// The fundamental of a pulse wave with duty D is sin(pi D) times that of a
+// square wave, so each 3 dB volume step is a duty of asin(gain) / pi, in
+// 1/65536ths of the period. Full volume is the plain square wave.
+static const uint16_t volumeDuties[VOLUME_MAX + 1] = {
+    0, 932, 1317, 1862, 2633, 3729, 5297, 7566, 10951, 16409, 32768,
+};
+
+// GCLK0 / 8 = 6 MHz: a 16-bit period reaches down to 92 Hz
+#define PWM_TICKS_PER_SECOND (F_CPU / 8)
+#define PWM_PERIOD_MAX 0x10000UL
+
+static inline void pwmSync(Tcc* tcc) {
+    while (tcc->SYNCBUSY.reg);
+}
+
+// The TCC and compare channel that drive pin, or NULL if none does
+static Tcc* pwmTimer(uint8_t pin, uint8_t& channel) {
+    const PinDescription& desc = g_APinDescription[pin];
+    if ((desc.ulPinAttribute & PIN_ATTR_PWM) != PIN_ATTR_PWM) return NULL;
+    uint8_t timer = GetTCNumber(desc.ulPWMChannel);
+    if (timer >= TCC_INST_NUM) return NULL;
+    // TCCs with fewer compare channels than outputs repeat them (WO[n] = CC[n % count])
+    uint8_t count = (timer == 0) ? TCC0_CC_NUM : (timer == 1) ? TCC1_CC_NUM : TCC2_CC_NUM;
+    channel = GetTCChannelNumber(desc.ulPWMChannel) % count;
+    return (Tcc*)GetTC(desc.ulPWMChannel);
+}
+
+static void pwmStart(uint8_t pin, Tcc* tcc, uint8_t channel, uint32_t period, uint32_t high) {
+    const PinDescription& desc = g_APinDescription[pin];
+    uint8_t timer = GetTCNumber(desc.ulPWMChannel);
+    PM->APBCMASK.reg |= PM_APBCMASK_TCC0 << timer;
+    GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 |
+                        ((timer == 2) ? GCLK_CLKCTRL_ID_TCC2_TC3 : GCLK_CLKCTRL_ID_TCC0_TCC1);
+    while (GCLK->STATUS.bit.SYNCBUSY);
+
+    tcc->CTRLA.bit.ENABLE = 0;
+    pwmSync(tcc);
+    tcc->CTRLA.reg = TCC_CTRLA_PRESCALER_DIV8;
+    tcc->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
+    pwmSync(tcc);
+    tcc->PER.reg = period - 1;
+    tcc->CC[channel].reg = high;
+    pwmSync(tcc);
+    tcc->CTRLA.bit.ENABLE = 1;
+    pwmSync(tcc);
+
+    pinPeripheral(pin, (desc.ulPinAttribute & PIN_ATTR_TIMER) ? PIO_TIMER : PIO_TIMER_ALT);
+}
+
+static void pwmStop(uint8_t pin, Tcc* tcc) {
+    // pinMode hands the pin back from the TCC to the port, driven low
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    tcc->CTRLA.bit.ENABLE = 0;
+    pwmSync(tcc);
+}
+#endif
+
 PolyBuzzer::PolyBuzzer(uint8_t pin) {
         for (int i = 0; i < POLYBUZZER_MAX_TONES; i++) {
             this->tones[i] = 0;
+#ifdef SIDETONE_DAC
+            this->steps[i] = 0;
+#endif
         }
         this->playing = 0;
+#ifdef POLYBUZZER_PWM
+        this->pwmRunning = false;
+#endif
+        this->active = 0;
+        this->outputChanges = 0;
+        this->outputCallsSuppressed = 0;
+        this->volume = DEFAULT_VOLUME;
         this->pin = pin;
         pinMode(pin, OUTPUT);
     }
 
 void PolyBuzzer::update() {
-    for (int i = 0; i < POLYBUZZER_MAX_TONES; i++) {
-        if (this->tones[i]) {
-            if (this->playing != this->tones[i]) {
-                this->playing = this->tones[i];
-                Serial.print("Buzzer playing frequency: ");
-                Serial.println(this->playing);
-                tone(this->pin, this->playing);
-            }
+    this->update(micros());
+}
+
+void PolyBuzzer::update(unsigned long when) {
+#ifdef SIDETONE_DAC
+    // The mixer plays every slot as it changes; playing is the top one
+    (void)when;
+    this->playing = this->active ? this->tones[__builtin_clz(this->active)] : 0;
+#else
+    if (!this->active) {
+        if (!this->playing) {
+            this->outputCallsSuppressed++;
             return;
         }
+        this->playing = 0;
+        this->outputChanges++;
+        this->silence(when);
+        return;
     }
-    this->playing = 0;
-    Serial.println("Buzzer stopped");
+
+    // The highest priority slot holding a tone. M0+ has no CLZ instruction;
+    // libgcc's is a short table lookup, the same for any number of slots.
+    int slot = __builtin_clz(this->active);
+    if (this->playing == this->tones[slot]) {
+        this->outputCallsSuppressed++;
+        return;
+    }
+    this->playing = this->tones[slot];
+    this->outputChanges++;
+    this->play(when);
+#endif
+}
+
+// Store a slot's tone (0 = none); false if it already held exactly that,
+// in which case nothing audible can change
+bool PolyBuzzer::setSlot(int slot, unsigned int frequency, uint32_t step) {
+#ifdef SIDETONE_DAC
+    bool same = this->tones[slot] == frequency && this->steps[slot] == step;
+    this->steps[slot] = step;
+#else
+    (void)step;
+    bool same = this->tones[slot] == frequency;
+#endif
+    if (same) {
+        this->outputCallsSuppressed++;
+        return false;
+    }
+    this->tones[slot] = frequency;
+    uint32_t bit = 0x80000000UL >> slot;
+    if (frequency) {
+        this->active |= bit;
+    } else {
+        this->active &= ~bit;
+    }
+    return true;
+}
+
+// A slot now holds a different tone (setSlot returned true)
+void PolyBuzzer::slotChanged(int slot, unsigned long when) {
+#ifdef SIDETONE_DAC
+    this->outputChanges++;
+    sidetonePlay(slot, this->steps[slot], when);
+#else
+    (void)slot;
+#endif
+    this->update(when);
+}
+
+#ifndef SIDETONE_DAC
+// Start the output on playing (or retune it), at the current volume
+void PolyBuzzer::play(unsigned long when) {
+#if defined(POLYBUZZER_PWM)
+    (void)when;
+    uint8_t channel;
+    Tcc* tcc = pwmTimer(this->pin, channel);
+    if (!tcc) {
+        tone(this->pin, this->playing);
+        return;
+    }
+    uint32_t period = (PWM_TICKS_PER_SECOND + this->playing / 2) / this->playing;
+    if (period > PWM_PERIOD_MAX) period = PWM_PERIOD_MAX;
+    uint32_t high = (period * volumeDuties[this->volume]) >> 16;
+    if (this->pwmRunning) {
+        // Buffered: the change lands at the end of the current cycle
+        tcc->PERB.reg = period - 1;
+        tcc->CCB[channel].reg = high;
+        pwmSync(tcc);
+    } else {
+        pwmStart(this->pin, tcc, channel, period, high);
+        this->pwmRunning = true;
+    }
+#else
+    (void)when;
+    tone(this->pin, this->playing);
+#endif
+}
+
+void PolyBuzzer::silence(unsigned long when) {
+#if defined(POLYBUZZER_PWM)
+    (void)when;
+    uint8_t channel;
+    Tcc* tcc = pwmTimer(this->pin, channel);
+    if (!tcc) {
+        noTone(this->pin);
+    } else if (this->pwmRunning) {
+        pwmStop(this->pin, tcc);
+        this->pwmRunning = false;
+    }
+#else
+    (void)when;
     noTone(this->pin);
+#endif
+}
+#endif
+
+void PolyBuzzer::SetVolume(uint8_t volume) {
+    if (volume > VOLUME_MAX) {
+        volume = VOLUME_MAX;
+    }
+    this->volume = volume;
+    Serial.print("Buzzer volume: ");
+    Serial.println(volume);
+#if defined(SIDETONE_DAC)
+    sidetoneSetVolume(volumeGains[volume]);
+#elif defined(POLYBUZZER_PWM)
+    if (this->playing) {
+        this->play(micros());
+    }
+#endif
 }
 
 // On single-slot builds (AVR), remap any higher-priority slot request to
@@ -38,38 +231,45 @@ static inline int clampSlot(int slot) {
 }
 
 void PolyBuzzer::Tone(int slot, unsigned int frequency) {
-    slot = clampSlot(slot);
-    Serial.print("Setting tone in slot ");
-    Serial.print(slot);
-    Serial.print(" to frequency: ");
-    Serial.println(frequency);
-
-    this->tones[slot] = frequency;
-    this->update();
+    this->ToneAt(slot, frequency, micros());
 }
 
 void PolyBuzzer::Note(int slot, uint8_t note) {
+    this->NoteAt(slot, note, micros());
+}
+
+void PolyBuzzer::NoTone(int slot) {
+    this->NoToneAt(slot, micros());
+}
+
+void PolyBuzzer::ToneAt(int slot, unsigned int frequency, unsigned long when) {
+    slot = clampSlot(slot);
+#ifdef SIDETONE_DAC
+    uint32_t step = sidetonePhaseIncrement(frequency);
+#else
+    uint32_t step = 0;
+#endif
+    if (!this->setSlot(slot, frequency, step)) return;
+    this->slotChanged(slot, when);
+}
+
+void PolyBuzzer::NoteAt(int slot, uint8_t note, unsigned long when) {
     if (note > 127) {
         note = 127;
     }
     slot = clampSlot(slot);
-
-    Serial.print("Setting note in slot ");
-    Serial.print(slot);
-    Serial.print(" to MIDI note #");
-    Serial.print(note);
-    Serial.print(" (frequency: ");
-    Serial.print(GET_EQUAL_TEMPERAMENT_NOTE(note));
-    Serial.println("Hz)");
-
-    this->Tone(slot, GET_EQUAL_TEMPERAMENT_NOTE(note));
+#ifdef SIDETONE_DAC
+    // Same as ToneAt, but with the exact pitch rather than whole Hz
+    uint32_t step = sidetoneNoteIncrement(note, SIDETONE_TUNING_CENTS);
+#else
+    uint32_t step = 0;
+#endif
+    if (!this->setSlot(slot, GET_EQUAL_TEMPERAMENT_NOTE(note), step)) return;
+    this->slotChanged(slot, when);
 }
 
-void PolyBuzzer::NoTone(int slot) {
+void PolyBuzzer::NoToneAt(int slot, unsigned long when) {
     slot = clampSlot(slot);
-    Serial.print("Clearing tone in slot ");
-    Serial.println(slot);
-
-    tones[slot] = 0;
-    this->update();
-}
\ No newline at end of file
+    if (!this->setSlot(slot, 0, 0)) return;
+    this->slotChanged(slot, when);
+}
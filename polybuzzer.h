@@ -1,30 +1,81 @@
 #pragma once
 
 #include <Arduino.h>
+#include "config.h"
+#include "sidetone.h"
+
+// Slot roles. On the piezo a lower slot silences the ones above it; the DAC
+// sidetone plays each slot on its own mixer voice, so all are heard.
+#define BUZZER_SLOT_SIDETONE 0   // Local keying
+#define BUZZER_SLOT_HOST 1       // Note On/Off from the host
+#define BUZZER_SLOT_CUE 2        // Mode change and menu cues
 
 // On memory-constrained AVR boards (e.g. Arduino Micro / ATmega32U4)
 // drop to a single tone slot to save SRAM. SAMD21 keeps 2 slots for
-// the priority overlay behavior used by DisableBuzzer / Morse playback.
-#if defined(__AVR__)
-  #define POLYBUZZER_MAX_TONES 1
-#else
-  #define POLYBUZZER_MAX_TONES 2
+// the priority overlay behavior used by DisableBuzzer / Morse playback
+// (cues share the host slot), or one slot per voice with the DAC sidetone.
+// Up to 32 slots can be configured; a change costs the same at any count.
+#ifndef POLYBUZZER_MAX_TONES
+  #if defined(__AVR__)
+    #define POLYBUZZER_MAX_TONES 1
+  #elif defined(SIDETONE_DAC)
+    #define POLYBUZZER_MAX_TONES SIDETONE_VOICES
+  #else
+    #define POLYBUZZER_MAX_TONES 2
+  #endif
+#endif
+
+static_assert(POLYBUZZER_MAX_TONES >= 1 && POLYBUZZER_MAX_TONES <= 32,
+              "PolyBuzzer slots are tracked in a 32-bit mask");
+
+// Without the DAC sidetone, SAMD boards drive the piezo from the TCC behind
+// PIEZO_PIN so that volume can set the pulse width. Pins without a TCC, and
+// AVR boards, use tone() at full volume.
+#if defined(ARDUINO_ARCH_SAMD) && !defined(SIDETONE_DAC)
+  #define POLYBUZZER_PWM
 #endif
 
 // PolyBuzzer provides a proritized monophonic buzzer.
 //
 // A given tone will only be played when all higher priority tones have stopped.
+// Slot 0 has the highest priority. Slots holding a tone are kept as bits in
+// a mask, so the audible slot is a count of leading zeros, and the output is
+// only touched when the audible tone actually changes. With the DAC sidetone
+// there is no priority: each slot change goes straight to its voice.
+// The ...At variants take the keyed time of the change (micros) for outputs
+// that can place it exactly (the DAC sidetone); the others mean "now".
 class PolyBuzzer {
 public:
     unsigned int tones[POLYBUZZER_MAX_TONES];
     unsigned int playing;
     uint8_t pin;
+    uint8_t volume;
+    uint32_t active;            // Bit 31 - slot set while slot holds a tone
+
+    // Requests that changed what is heard, and those that left it as it was
+    uint32_t outputChanges;
+    uint32_t outputCallsSuppressed;
+#ifdef SIDETONE_DAC
+    // Phase steps of tones[]; notes come exact from the note table
+    uint32_t steps[POLYBUZZER_MAX_TONES];
+#endif
+#ifdef POLYBUZZER_PWM
+    bool pwmRunning;
+#endif
 
     PolyBuzzer(uint8_t pin);
     void update();
+    void update(unsigned long when);
     void Tone(int slot, unsigned int frequency);
     void Note(int slot, uint8_t note);
     void NoTone(int slot);
+    void ToneAt(int slot, unsigned int frequency, unsigned long when);
+    void NoteAt(int slot, uint8_t note, unsigned long when);
+    void NoToneAt(int slot, unsigned long when);
+
+    // Output level, 0 (silent) to VOLUME_MAX. Takes effect on the tone
+    // that is playing.
+    void SetVolume(uint8_t volume);
     
     // Debug helper - print current state
     void printDebugInfo() {
@@ -34,6 +85,20 @@ public:
             if (i < POLYBUZZER_MAX_TONES - 1) Serial.print(", ");
         }
         Serial.print("], Playing: ");
-        Serial.println(playing);
+        Serial.print(playing);
+        Serial.print(", Volume: ");
+        Serial.print(volume);
+        Serial.print(", Output changes: ");
+        Serial.print(outputChanges);
+        Serial.print(", suppressed: ");
+        Serial.println(outputCallsSuppressed);
     }
+
+private:
+    bool setSlot(int slot, unsigned int frequency, uint32_t step);
+    void slotChanged(int slot, unsigned long when);
+#ifndef SIDETONE_DAC
+    void play(unsigned long when);
+    void silence(unsigned long when);
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "radio_edge_scheduler.h"
+
+RadioEdgeScheduler::RadioEdgeScheduler() : count(0), early(0) {}
+
+void RadioEdgeScheduler::applyFirst(RadioEdgeApply apply) {
+  apply(edges[0].pin, edges[0].level);
+  count--;
+  for (uint8_t i = 0; i < count; i++) {
+    edges[i] = edges[i + 1];
+  }
+}
+
+void RadioEdgeScheduler::add(uint8_t pin, bool level, uint32_t when, RadioEdgeApply apply) {
+  if (count == RADIO_EDGE_QUEUE) {
+    applyFirst(apply);
+    early++;
+  }
+
+  // Insertion sort from the back: after any edge due at the same time
+  uint8_t at = count;
+  while (at > 0 && (int32_t)(when - edges[at - 1].due) < 0) {
+    edges[at] = edges[at - 1];
+    at--;
+  }
+  edges[at].due = when;
+  edges[at].pin = pin;
+  edges[at].level = level;
+  count++;
+}
+
+uint16_t RadioEdgeScheduler::service(uint32_t now, RadioEdgeApply apply) {
+  while (count > 0) {
+    int32_t delta = (int32_t)(edges[0].due - now);
+    if (delta < RADIO_TIMER_MIN_US) {
+      applyFirst(apply);
+      continue;
+    }
+    if ((uint32_t)delta > RADIO_TIMER_MAX_US) delta = RADIO_TIMER_MAX_US;
+    return (uint16_t)(delta * RADIO_TIMER_TICKS_PER_US);
+  }
+  return 0;
+}
+
+bool RadioEdgeScheduler::cancel(uint8_t pin) {
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (edges[i].pin != pin) edges[kept++] = edges[i];
+  }
+  bool dropped = kept != count;
+  count = kept;
+  return dropped;
+}
+
+void RadioEdgeScheduler::flush(RadioEdgeApply apply) {
+  while (count > 0) {
+    applyFirst(apply);
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef RADIO_EDGE_SCHEDULER_H
+#define RADIO_EDGE_SCHEDULER_H
+
+#include <stdint.h>
+
+// ============================================================================
+// RADIO EDGE SCHEDULING
+// ============================================================================
+// The timing side of the hardware-timed radio outputs (radio_output.h):
+// a short queue of pin edges in deadline order, and the one-shot timer
+// compare that wakes up for the earliest. add() queues an edge, and
+// service() applies every edge that is due and says how far away the next
+// one is, in timer ticks. The caller runs service() after adding and from
+// the timer interrupt, and arms the timer with what it returns.
+//
+// Edges are kept in deadline order rather than arrival order, so an edge
+// due now (a straight key) goes out while a keyer edge is still waiting a
+// lookahead ahead, and neither is moved. Only a full queue sends an edge
+// early: the earliest goes out to make room, counted by earlyEdges().
+//
+// This file has no Arduino dependencies so host tools can build it as-is.
+// ============================================================================
+
+// TC3 runs from GCLK0 (48 MHz) / 16 = 3 ticks per microsecond, giving a
+// 16-bit range of about 21.8 ms. Edges are only ever scheduled one keyer
+// lookahead ahead, so the clamp is just a guard on that range: a longer
+// wait is armed in parts.
+#define RADIO_TIMER_TICKS_PER_US 3
+#define RADIO_TIMER_MAX_US 20000UL
+// Below this, arming the timer costs more than it saves
+#define RADIO_TIMER_MIN_US 4
+
+// Edges waiting at once: both key lines and PTT, a few elements deep
+#define RADIO_EDGE_QUEUE 8
+
+// Write a pin now
+typedef void (*RadioEdgeApply)(uint8_t pin, bool level);
+
+class RadioEdgeScheduler {
+public:
+    RadioEdgeScheduler();
+
+    // Queue pin to go to level at when (micros). Edges due at the same time
+    // go out in the order they were added.
+    void add(uint8_t pin, bool level, uint32_t when, RadioEdgeApply apply);
+
+    // Apply the edges due at now; returns the compare, in ticks from now,
+    // for the next one, or 0 if none is left
+    uint16_t service(uint32_t now, RadioEdgeApply apply);
+
+    // Apply every queued edge now, in order
+    void flush(RadioEdgeApply apply);
+
+    // Drop the queued edges for pin; returns false if there were none
+    bool cancel(uint8_t pin);
+
+    uint8_t pending() const { return count; }
+
+    // Statistics
+    uint32_t earlyEdges() const { return early; }
+
+private:
+    struct Edge {
+        uint32_t due;
+        uint8_t pin;
+        bool level;
+    };
+    Edge edges[RADIO_EDGE_QUEUE];   // Sorted by due, earliest first
+    uint8_t count;
+    uint32_t early;
+
+    void applyFirst(RadioEdgeApply apply);
+};
+
+#endif // RADIO_EDGE_SCHEDULER_H
@@ -0,0 +1,233 @@
+#include "radio_output.h"
+
+#ifdef RADIO_EDGE_TIMER
+
+#include "radio_edge_scheduler.h"
+
+// ============================================================================
+// Edge Queue (shared with the TC3 interrupt)
+// ============================================================================
+
+static RadioEdgeScheduler scheduler;
+
+static void applyEdge(uint8_t pin, bool level) {
+  uint32_t mask = 1UL << g_APinDescription[pin].ulPin;
+  if (level) {
+    PORT->Group[g_APinDescription[pin].ulPort].OUTSET.reg = mask;
+  } else {
+    PORT->Group[g_APinDescription[pin].ulPort].OUTCLR.reg = mask;
+  }
+}
+
+static inline void timerSync() {
+  while (TC3->COUNT16.STATUS.bit.SYNCBUSY);
+}
+
+static void timerStop() {
+  TC3->COUNT16.CTRLA.bit.ENABLE = 0;
+  timerSync();
+  TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+}
+
+// Apply what is due and arm the timer for the next edge (interrupts off)
+static void serviceEdges() {
+  uint16_t ticks = scheduler.service(micros(), applyEdge);
+  if (ticks == 0) return;
+  TC3->COUNT16.COUNT.reg = 0;
+  timerSync();
+  TC3->COUNT16.CC[0].reg = ticks;
+  timerSync();
+  TC3->COUNT16.CTRLA.bit.ENABLE = 1;
+  timerSync();
+}
+
+void TC3_Handler() {
+  if (TC3->COUNT16.INTFLAG.bit.MC0) {
+    timerStop();
+    serviceEdges();
+  }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void initRadioEdgeTimer() {
+  PM->APBCMASK.reg |= PM_APBCMASK_TC3;
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_TCC2_TC3;
+  while (GCLK->STATUS.bit.SYNCBUSY);
+
+  TC3->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+  while (TC3->COUNT16.CTRLA.bit.SWRST);
+
+  TC3->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_NFRQ | TC_CTRLA_PRESCALER_DIV16;
+  timerSync();
+  TC3->COUNT16.CTRLBSET.reg = TC_CTRLBSET_ONESHOT;
+  timerSync();
+  TC3->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+
+  NVIC_SetPriority(TC3_IRQn, 0);
+  NVIC_EnableIRQ(TC3_IRQn);
+
+  Serial.println("Radio edge timer initialized (TC3)");
+}
+
+void radioEdgeFlush() {
+  noInterrupts();
+  timerStop();
+  scheduler.flush(applyEdge);
+  interrupts();
+}
+
+bool radioEdgeCancel(uint8_t pin) {
+  noInterrupts();
+  timerStop();
+  bool dropped = scheduler.cancel(pin);
+  serviceEdges();
+  interrupts();
+  return dropped;
+}
+
+void radioEdgeWriteAt(uint8_t pin, bool level, unsigned long when) {
+  noInterrupts();
+  timerStop();
+  scheduler.add(pin, level, when, applyEdge);
+  serviceEdges();
+  interrupts();
+}
+
+uint32_t radioEdgesSentEarly() {
+  return scheduler.earlyEdges();
+}
+
+#endif // RADIO_EDGE_TIMER
+
+#ifdef RADIO_PTT_PIN
+
+#define PTT_QUEUE_SIZE 8
+
+// ============================================================================
+// PTT Sequencer State
+// ============================================================================
+
+struct PttEdge {
+  uint8_t pin;
+  uint8_t level;
+  unsigned long due;
+};
+
+static PttEdge pttQueue[PTT_QUEUE_SIZE];
+static uint8_t pttHead = 0;
+static uint8_t pttCount = 0;
+static bool pttOn = false;
+static uint8_t keyLinesDown = 0;  // Bit 0 = DIT line, bit 1 = DAH line
+static unsigned long pttReleaseAt = 0;
+static unsigned long pttLeadUs = (unsigned long)RADIO_PTT_LEAD_MS * 1000UL;
+static unsigned long pttHangUs = (unsigned long)RADIO_PTT_HANG_MS * 1000UL;
+
+static void writeKeyLine(uint8_t pin, uint8_t level, unsigned long when) {
+#ifdef RADIO_EDGE_TIMER
+  radioEdgeWriteAt(pin, level, when);
+#else
+  (void)when;
+  digitalWrite(pin, level);
+#endif
+}
+
+static void outputHead() {
+  PttEdge& edge = pttQueue[pttHead];
+  uint8_t bit = (edge.pin == RADIO_DAH_PIN) ? 0x02 : 0x01;
+
+  writeKeyLine(edge.pin, edge.level, edge.due);
+  if (edge.level == RADIO_ACTIVE_LEVEL) {
+    keyLinesDown |= bit;
+  } else {
+    keyLinesDown &= ~bit;
+    pttReleaseAt = edge.due + pttHangUs;
+  }
+
+  pttHead = (pttHead + 1) % PTT_QUEUE_SIZE;
+  pttCount--;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void initPttSequencer() {
+  pinMode(RADIO_PTT_PIN, OUTPUT);
+  digitalWrite(RADIO_PTT_PIN, RADIO_INACTIVE_LEVEL);
+  Serial.println("PTT sequencer initialized");
+}
+
+void pttSequencerSetTiming(uint16_t leadMs, uint16_t hangMs) {
+  pttLeadUs = (unsigned long)leadMs * 1000UL;
+  pttHangUs = (unsigned long)hangMs * 1000UL;
+  Serial.print("PTT lead: ");
+  Serial.print(leadMs);
+  Serial.print("ms, hang: ");
+  Serial.print(hangMs);
+  Serial.println("ms");
+}
+
+void pttSequencerKey(uint8_t pin, uint8_t level, unsigned long when) {
+  if (!pttOn) {
+    if (level != RADIO_ACTIVE_LEVEL) {
+      // Nothing on the air: key-ups pass straight through
+      writeKeyLine(pin, level, when);
+      return;
+    }
+    bool released = true;
+#ifdef RADIO_EDGE_TIMER
+    // A release still waiting on the timer is taken back: PTT stays up
+    released = !radioEdgeCancel(RADIO_PTT_PIN);
+#endif
+    if (released) {
+      writeKeyLine(RADIO_PTT_PIN, RADIO_ACTIVE_LEVEL, when);
+    }
+    pttOn = true;
+    Serial.println("PTT on");
+  }
+
+  if (pttCount == PTT_QUEUE_SIZE) {
+    // Queue full (only at absurd speeds for the lead time): output the oldest early
+    outputHead();
+  }
+
+  PttEdge& edge = pttQueue[(pttHead + pttCount) % PTT_QUEUE_SIZE];
+  edge.pin = pin;
+  edge.level = level;
+  edge.due = when + pttLeadUs;
+  pttCount++;
+}
+
+void pttSequencerTick(unsigned long now) {
+  while (pttCount > 0 && (long)(now - pttQueue[pttHead].due) >= 0) {
+    outputHead();
+  }
+
+  if (pttOn && pttCount == 0 && keyLinesDown == 0 &&
+      (long)(now - pttReleaseAt) >= 0) {
+    writeKeyLine(RADIO_PTT_PIN, RADIO_INACTIVE_LEVEL, pttReleaseAt);
+    pttOn = false;
+    Serial.println("PTT off");
+  }
+}
+
+void pttSequencerReset() {
+  pttHead = 0;
+  pttCount = 0;
+  keyLinesDown = 0;
+#ifdef RADIO_EDGE_TIMER
+  radioEdgeFlush();
+#endif
+  digitalWrite(RADIO_DIT_PIN, RADIO_INACTIVE_LEVEL);
+  digitalWrite(RADIO_DAH_PIN, RADIO_INACTIVE_LEVEL);
+  if (pttOn) {
+    digitalWrite(RADIO_PTT_PIN, RADIO_INACTIVE_LEVEL);
+    pttOn = false;
+    Serial.println("PTT off");
+  }
+}
+
+#endif // RADIO_PTT_PIN
@@ -0,0 +1,70 @@
+#ifndef RADIO_OUTPUT_H
+#define RADIO_OUTPUT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifdef RADIO_EDGE_TIMER
+
+// ============================================================================
+// Hardware-Timed Radio Key Output
+// ============================================================================
+// Radio key lines are written straight to the PORT OUTSET/OUTCLR registers.
+// Edges with a future time (micros) wait in a short deadline-ordered queue
+// (radio_edge_scheduler.h); TC3 in one-shot compare mode wakes up for the
+// earliest and its interrupt applies it, so the on-air edge lands within a
+// microsecond of the keyer's schedule regardless of loop jitter. An edge
+// due now goes out at once without disturbing the ones still waiting.
+
+// Configure TC3 and its interrupt (call once from setup)
+void initRadioEdgeTimer();
+
+// Set a radio pin to level at time when (micros); past or imminent
+// times are applied immediately
+void radioEdgeWriteAt(uint8_t pin, bool level, unsigned long when);
+
+// Apply all pending edges now
+void radioEdgeFlush();
+
+// Drop the pending edges for pin; returns false if there were none
+bool radioEdgeCancel(uint8_t pin);
+
+// Edges sent early because the queue was full
+uint32_t radioEdgesSentEarly();
+
+#endif // RADIO_EDGE_TIMER
+
+#ifdef RADIO_PTT_PIN
+
+// ============================================================================
+// PTT Sequencer
+// ============================================================================
+// Sits between the adapter and the radio key lines. The first key-down
+// asserts PTT at its edge time and opens a delay line: every key edge is
+// output the lead time after it was keyed, so element timing is preserved
+// exactly. PTT drops the hang time after the last key-up is output. PTT
+// edges go through the edge timer like the key lines. Both times start at
+// RADIO_PTT_LEAD_MS/RADIO_PTT_HANG_MS and are set over MIDI (CC14/CC15).
+
+// Hang time resolution of CC15 and the settings store
+#define PTT_HANG_STEP_MS 10
+
+// Configure the PTT pin (inactive)
+void initPttSequencer();
+
+// Set the lead and hang times. Edges already queued keep their times.
+void pttSequencerSetTiming(uint16_t leadMs, uint16_t hangMs);
+
+// Queue a key line change; when is the edge time (micros)
+void pttSequencerKey(uint8_t pin, uint8_t level, unsigned long when);
+
+// Output due key edges and release PTT after the hang time (call every loop).
+// now may run ahead of micros() by the edge timer lookahead.
+void pttSequencerTick(unsigned long now);
+
+// Drop queued edges and release key lines and PTT immediately
+void pttSequencerReset();
+
+#endif // RADIO_PTT_PIN
+
+#endif // RADIO_OUTPUT_H
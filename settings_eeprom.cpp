@@ -1,202 +1,737 @@
 #include "settings_eeprom.h"
 #include "config.h"
+#include "nvm_storage.h"
+#include "settings_log.h"
+#include "radio_output.h"
 #include <Arduino.h>
-#if defined(ARDUINO_ARCH_SAMD)
-  // SAMD21 has no true EEPROM — FlashStorage_SAMD emulates it in Flash
-  // and requires an explicit EEPROM.commit() to flush writes.
-  #include <FlashStorage_SAMD.h>
-  #define EEPROM_NEEDS_COMMIT 1
-#else
-  // AVR (e.g. Arduino Micro ATmega32U4) has native EEPROM; writes are
-  // committed per-byte by the hardware, and EEPROM.commit() is not provided.
+#if !defined(ARDUINO_ARCH_SAMD)
+  // AVR: the legacy fixed settings layout is read from the native EEPROM once,
+  // for migration. (On SAMD21 the old FlashStorage_SAMD emulated EEPROM lived
+  // inside the sketch image and is wiped by every firmware update anyway.)
   #include <EEPROM.h>
+  #define HAS_LEGACY_EEPROM_SETTINGS 1
 #endif
 #include <MIDIUSB.h>
 
-static inline void eeprom_commit() {
-#ifdef EEPROM_NEEDS_COMMIT
-  EEPROM.commit();
+// ============================================================================
+// Settings Record Log
+// ============================================================================
+// Settings are kept in a SettingsLog (settings_log.h) at the start of the NVM
+// region (see nvm_storage.h). Settings from the old fixed layout (flag at
+// EEPROM_VALID_FLAG_ADDR) are migrated into the log the first time it is
+// found empty (AVR only).
+
+// One record per write unit, so appending never rewrites programmed flash
+#if NVM_WRITE_SIZE > SETTINGS_RECORD_SIZE
+  #define SETTINGS_SLOT_SIZE NVM_WRITE_SIZE
+#else
+  #define SETTINGS_SLOT_SIZE SETTINGS_RECORD_SIZE
 #endif
+#define SETTINGS_SLOT_COUNT (NVM_SETTINGS_LOG_SIZE / SETTINGS_SLOT_SIZE)
+#define SETTINGS_SLOTS_PER_BLOCK \
+  ((NVM_BLOCK_SIZE > SETTINGS_SLOT_SIZE) ? (NVM_BLOCK_SIZE / SETTINGS_SLOT_SIZE) : 1)
+
+// Payload layout (version 1)
+struct SettingsCache {
+  uint16_t speedValue;
+  uint8_t keyerType;
+  uint8_t txNote;
+  uint8_t radioKeyerMode;
+  uint8_t volumeStepsDown;                   // VOLUME_MAX - volume: older records (0) load at full
+  uint16_t contestSerial;                    // Next {NR}
+  char callSign[SETTINGS_CALLSIGN_LENGTH];   // {CALL}, NUL-padded
+  uint8_t pttLeadCode;                       // PTT lead ms + 1; 0 (builds without PTT) = default
+  uint8_t pttHangCode;                       // PTT hang 10 ms steps + 1; 0 = default
+};
+
+static_assert(sizeof(SettingsCache) <= SETTINGS_PAYLOAD_MAX, "Settings payload too large");
+static_assert(SETTINGS_SLOT_COUNT / SETTINGS_SLOTS_PER_BLOCK >= 2,
+              "Settings log needs at least two blocks");
+
+static const SettingsLogStorage settingsLogStorage = {
+  nvmRead, nvmEraseBlock, nvmWrite, nvmIsErased,
+  NVM_SETTINGS_LOG_OFFSET, SETTINGS_SLOT_SIZE, SETTINGS_SLOT_COUNT, SETTINGS_SLOTS_PER_BLOCK,
+  NVM_ERASE_BEFORE_WRITE,
+};
+static SettingsLog settingsLog(settingsLogStorage);
+
+static void appendSettingsRecord(const void* payload, uint8_t length) {
+  if (!settingsLog.append(payload, length)) {
+    Serial.println("Settings log: no writable slot");
+  }
 }
 
 // ============================================================================
-// Adapter Settings EEPROM Functions
+// Settings Write-Back Cache
 // ============================================================================
+// A host dragging a speed slider sends dozens of CC1s a second. Settings
+// changes land in RAM first and a record is only appended once they have been
+// stable for SETTINGS_COMMIT_IDLE_MS, or right before a reset.
+
+static SettingsCache settingsCache;
+static SettingsCache storedSettings;   // What the newest log record holds
+static bool settingsCacheLoaded = false;
+static bool settingsDirty = false;
+static unsigned long settingsChangedAt = 0;
+static uint32_t settingsCommits = 0;
+static uint32_t settingsCommitsAvoided = 0;
+
+static void setDefaultSettings(SettingsCache& settings) {
+  settings.speedValue = MICROS_TO_SPEED_VALUE(DEFAULT_ADAPTER_DIT_DURATION_MS * 1000UL);
+  settings.keyerType = 8;  // Default to Iambic B
+  settings.txNote = DEFAULT_TONE_NOTE;
+  settings.radioKeyerMode = 0;
+  settings.volumeStepsDown = VOLUME_MAX - DEFAULT_VOLUME;
+  settings.contestSerial = 1;
+  memset(settings.callSign, 0, sizeof(settings.callSign));
+  settings.pttLeadCode = 0;
+  settings.pttHangCode = 0;
+}
 
-uint8_t loadToneFromEEPROM() {
-  if (EEPROM.read(EEPROM_VALID_FLAG_ADDR) == EEPROM_VALID_VALUE) {
-    uint8_t txNote = EEPROM.read(EEPROM_TX_NOTE_ADDR);
-    return txNote;
+// Read settings from the pre-log fixed EEPROM layout, if present
+static bool readLegacySettings(SettingsCache& settings) {
+#ifndef HAS_LEGACY_EEPROM_SETTINGS
+  (void)settings;
+  return false;
+#else
+  uint8_t flag = EEPROM.read(EEPROM_VALID_FLAG_ADDR);
+  if (flag != EEPROM_VALID_VALUE && flag != EEPROM_VALID_VALUE_LEGACY) {
+    return false;
+  }
+
+  uint16_t ditDurationVal;
+  EEPROM.get(EEPROM_DIT_DURATION_ADDR, ditDurationVal);
+  uint32_t speedValue = ditDurationVal;
+  if (flag == EEPROM_VALID_VALUE_LEGACY) {
+    // Older firmware stored whole milliseconds; convert to a 14-bit speed value
+    speedValue = MICROS_TO_SPEED_VALUE((uint32_t)ditDurationVal * 1000UL);
+  }
+  if (speedValue > SPEED_VALUE_MAX) speedValue = SPEED_VALUE_MAX;
+
+  settings.speedValue = speedValue;
+  settings.keyerType = EEPROM.read(EEPROM_KEYER_TYPE_ADDR);
+  settings.txNote = EEPROM.read(EEPROM_TX_NOTE_ADDR);
+  settings.radioKeyerMode = (EEPROM.read(EEPROM_RADIO_KEYER_MODE_ADDR) == 1) ? 1 : 0;
+  return true;
+#endif
+}
+
+static void loadSettingsCache() {
+  SettingsRecord record;
+  setDefaultSettings(settingsCache);
+
+  if (settingsLog.scan(record)) {
+    uint8_t length = record.length;
+    if (length > sizeof(SettingsCache)) length = sizeof(SettingsCache);
+    memcpy(&settingsCache, record.payload, length);
+    Serial.print("Settings loaded from log record "); Serial.println(settingsLog.sequence());
+  } else if (readLegacySettings(settingsCache)) {
+    Serial.println("Migrating settings from legacy EEPROM layout");
+    appendSettingsRecord(&settingsCache, sizeof(SettingsCache));
   } else {
-    Serial.println("EEPROM not initialized, using default tone");
-    return DEFAULT_TONE_NOTE;
+    Serial.println("Settings log empty, writing defaults");
+    appendSettingsRecord(&settingsCache, sizeof(SettingsCache));
+  }
+
+  if (settingsCache.speedValue > SPEED_VALUE_MAX) settingsCache.speedValue = SPEED_VALUE_MAX;
+  if (settingsCache.volumeStepsDown > VOLUME_MAX) settingsCache.volumeStepsDown = 0;
+  if (settingsCache.pttLeadCode > 128) settingsCache.pttLeadCode = 0;
+  if (settingsCache.pttHangCode > 128) settingsCache.pttHangCode = 0;
+  storedSettings = settingsCache;
+  settingsCacheLoaded = true;
+}
+
+// Record one requested save; only the first change since the last commit
+// will cost a commit, everything else is coalesced or a no-op
+static void markSettingsChanged(bool changed) {
+  if (!changed || settingsDirty) {
+    settingsCommitsAvoided++;
+  }
+  if (changed) {
+    settingsDirty = true;
+    settingsChangedAt = millis();
+  }
+}
+
+void flushSettingsToEEPROM() {
+  if (!settingsDirty) return;
+  settingsDirty = false;
+
+  // A slider that ended where it started needs no record
+  if (memcmp(&settingsCache, &storedSettings, sizeof(SettingsCache)) == 0) {
+    settingsCommitsAvoided++;
+    return;
+  }
+
+  appendSettingsRecord(&settingsCache, sizeof(SettingsCache));
+  storedSettings = settingsCache;
+  settingsCommits++;
+
+  Serial.print("Settings record "); Serial.print(settingsLog.sequence());
+  Serial.print(" written (commits: "); Serial.print(settingsCommits);
+  Serial.print(", avoided: "); Serial.print(settingsCommitsAvoided); Serial.println(")");
+}
+
+void serviceSettingsStore(unsigned long currentTime) {
+  if (settingsDirty && (currentTime - settingsChangedAt) >= SETTINGS_COMMIT_IDLE_MS) {
+    flushSettingsToEEPROM();
   }
 }
 
-void saveSettingsToEEPROM(uint8_t keyerType, uint16_t ditDuration, uint8_t txNote) {
-  EEPROM.write(EEPROM_KEYER_TYPE_ADDR, keyerType);
-  EEPROM.put(EEPROM_DIT_DURATION_ADDR, ditDuration);
-  EEPROM.write(EEPROM_TX_NOTE_ADDR, txNote);
-  EEPROM.write(EEPROM_VALID_FLAG_ADDR, EEPROM_VALID_VALUE);
-  eeprom_commit();
-  Serial.print("Saved to EEPROM - Keyer: "); Serial.print(keyerType);
-  Serial.print(", Dit Duration: "); Serial.print(ditDuration);
+uint32_t getSettingsCommitCount() {
+  return settingsCommits;
+}
+
+uint32_t getSettingsCommitsAvoided() {
+  return settingsCommitsAvoided;
+}
+
+// ============================================================================
+// Adapter Settings Functions
+// ============================================================================
+
+uint8_t loadToneFromEEPROM() {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  return settingsCache.txNote;
+}
+
+void saveSettingsToEEPROM(uint8_t keyerType, uint32_t ditDurationUs, uint8_t txNote) {
+  uint32_t speedValue = MICROS_TO_SPEED_VALUE(ditDurationUs);
+  if (speedValue > SPEED_VALUE_MAX) speedValue = SPEED_VALUE_MAX;
+  if (!settingsCacheLoaded) loadSettingsCache();
+
+  bool changed = (settingsCache.keyerType != keyerType) ||
+                 (settingsCache.speedValue != speedValue) ||
+                 (settingsCache.txNote != txNote);
+  markSettingsChanged(changed);
+  if (!changed) return;
+
+  settingsCache.keyerType = keyerType;
+  settingsCache.speedValue = speedValue;
+  settingsCache.txNote = txNote;
+  Serial.print("Settings changed - Keyer: "); Serial.print(keyerType);
+  Serial.print(", Dit Duration (us): "); Serial.print(ditDurationUs);
   Serial.print(", TX Note: "); Serial.println(txNote);
 }
 
 void saveRadioKeyerModeToEEPROM(bool radioKeyerMode) {
-  EEPROM.write(EEPROM_RADIO_KEYER_MODE_ADDR, radioKeyerMode ? 1 : 0);
-  eeprom_commit();
-  Serial.print("Saved Radio Keyer Mode to EEPROM: "); Serial.println(radioKeyerMode ? "ON" : "OFF");
+  if (!settingsCacheLoaded) loadSettingsCache();
+
+  uint8_t value = radioKeyerMode ? 1 : 0;
+  bool changed = (settingsCache.radioKeyerMode != value);
+  markSettingsChanged(changed);
+  if (!changed) return;
+
+  settingsCache.radioKeyerMode = value;
+  Serial.print("Radio Keyer Mode changed: "); Serial.println(radioKeyerMode ? "ON" : "OFF");
+}
+
+uint8_t getVolume() {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  return VOLUME_MAX - settingsCache.volumeStepsDown;
+}
+
+void saveVolumeToEEPROM(uint8_t volume) {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  if (volume > VOLUME_MAX) volume = VOLUME_MAX;
+
+  uint8_t stepsDown = VOLUME_MAX - volume;
+  bool changed = (settingsCache.volumeStepsDown != stepsDown);
+  markSettingsChanged(changed);
+  if (!changed) return;
+
+  settingsCache.volumeStepsDown = stepsDown;
+  Serial.print("Volume changed: "); Serial.println(volume);
+}
+
+#ifdef RADIO_PTT_PIN
+uint8_t getPttLeadMs() {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  if (settingsCache.pttLeadCode == 0) return RADIO_PTT_LEAD_MS;
+  return settingsCache.pttLeadCode - 1;
+}
+
+uint8_t getPttHangSteps() {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  if (settingsCache.pttHangCode == 0) return RADIO_PTT_HANG_MS / PTT_HANG_STEP_MS;
+  return settingsCache.pttHangCode - 1;
+}
+
+void savePttTimingToEEPROM(uint8_t leadMs, uint8_t hangSteps) {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  if (leadMs > 127) leadMs = 127;
+  if (hangSteps > 127) hangSteps = 127;
+
+  bool changed = (settingsCache.pttLeadCode != leadMs + 1) || (settingsCache.pttHangCode != hangSteps + 1);
+  markSettingsChanged(changed);
+  if (!changed) return;
+
+  settingsCache.pttLeadCode = leadMs + 1;
+  settingsCache.pttHangCode = hangSteps + 1;
+  Serial.print("PTT timing changed - Lead: "); Serial.print(leadMs);
+  Serial.print("ms, Hang: "); Serial.print((uint16_t)hangSteps * PTT_HANG_STEP_MS); Serial.println("ms");
+}
+#endif
+
+uint16_t getContestSerial() {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  return settingsCache.contestSerial;
+}
+
+void saveContestSerialToEEPROM(uint16_t serial) {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  if (serial < 1 || serial > CONTEST_SERIAL_MAX) serial = 1;
+
+  bool changed = (settingsCache.contestSerial != serial);
+  markSettingsChanged(changed);
+  if (!changed) return;
+
+  settingsCache.contestSerial = serial;
+  Serial.print("Contest serial changed: "); Serial.println(serial);
+}
+
+char getCallSignChar(uint8_t index) {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  if (index >= SETTINGS_CALLSIGN_LENGTH) return 0;
+  return settingsCache.callSign[index];
+}
+
+void saveCallSignToEEPROM(const uint8_t* callSign, uint8_t length) {
+  if (!settingsCacheLoaded) loadSettingsCache();
+  char value[SETTINGS_CALLSIGN_LENGTH];
+  memset(value, 0, sizeof(value));
+  for (uint8_t i = 0; i < length && i < SETTINGS_CALLSIGN_LENGTH; i++) {
+    value[i] = callSign[i];
+  }
+
+  bool changed = (memcmp(settingsCache.callSign, value, sizeof(value)) != 0);
+  markSettingsChanged(changed);
+  if (!changed) return;
+
+  memcpy(settingsCache.callSign, value, sizeof(value));
+  Serial.print("Call sign changed: ");
+  for (uint8_t i = 0; i < SETTINGS_CALLSIGN_LENGTH && value[i]; i++) Serial.print(value[i]);
+  Serial.println();
 }
 
 void loadRadioKeyerModeFromEEPROM(VailAdapter& adapter) {
 #ifdef HAS_RADIO_OUTPUT
-  if (EEPROM.read(EEPROM_VALID_FLAG_ADDR) == EEPROM_VALID_VALUE) {
-    uint8_t radioKeyerModeVal = EEPROM.read(EEPROM_RADIO_KEYER_MODE_ADDR);
-    bool radioKeyerMode = (radioKeyerModeVal == 1);
+  if (!settingsCacheLoaded) loadSettingsCache();
+  bool radioKeyerMode = (settingsCache.radioKeyerMode == 1);
 
-    adapter.SetRadioKeyerMode(radioKeyerMode);
-    Serial.print("Loaded Radio Keyer Mode from EEPROM: ");
-    Serial.println(radioKeyerMode ? "ON" : "OFF");
-  }
+  adapter.SetRadioKeyerMode(radioKeyerMode);
+  Serial.print("Loaded Radio Keyer Mode: ");
+  Serial.println(radioKeyerMode ? "ON" : "OFF");
 #endif
 }
 
 void loadSettingsFromEEPROM(VailAdapter& adapter) {
-  if (EEPROM.read(EEPROM_VALID_FLAG_ADDR) == EEPROM_VALID_VALUE) {
-    uint8_t keyerType = EEPROM.read(EEPROM_KEYER_TYPE_ADDR);
-    uint16_t ditDurationVal;
-    EEPROM.get(EEPROM_DIT_DURATION_ADDR, ditDurationVal);
-    uint8_t txNoteVal = EEPROM.read(EEPROM_TX_NOTE_ADDR);
-
-    Serial.print("EEPROM values - Keyer: "); Serial.print(keyerType);
-    Serial.print(", Dit Duration: "); Serial.print(ditDurationVal);
-    Serial.print(", TX Note: "); Serial.println(txNoteVal);
-
-    midiEventPacket_t event;
-    event.header = 0x0B; event.byte1 = 0xB0;
-    event.byte2 = 1;
-    event.byte3 = ditDurationVal / (2 * MILLISECOND);
-    adapter.HandleMIDI(event);
+  if (!settingsCacheLoaded) loadSettingsCache();
+
+  uint8_t keyerType = settingsCache.keyerType;
+  uint16_t speedValue = settingsCache.speedValue;
+  uint8_t txNoteVal = settingsCache.txNote;
+
+  Serial.print("Stored settings - Keyer: "); Serial.print(keyerType);
+  Serial.print(", Dit Duration (us): "); Serial.print(SPEED_VALUE_TO_MICROS(speedValue));
+  Serial.print(", TX Note: "); Serial.println(txNoteVal);
+
+  // Replay as a CC1/CC33 pair so the full-precision speed is restored.
+  // The resulting saves match the cache and cost nothing.
+  midiEventPacket_t event;
+  event.header = 0x0B; event.byte1 = 0xB0;
+  event.byte2 = 1;
+  event.byte3 = speedValue >> 7;
+  adapter.HandleMIDI(event);
+
+  event.byte2 = 33;
+  event.byte3 = speedValue & 0x7F;
+  adapter.HandleMIDI(event);
+
+  event.byte2 = 2;
+  event.byte3 = txNoteVal;
+  adapter.HandleMIDI(event);
+
+  event.byte2 = 7;
+  event.byte3 = VOLUME_TO_CC(VOLUME_MAX - settingsCache.volumeStepsDown);
+  adapter.HandleMIDI(event);
+
+#ifdef RADIO_PTT_PIN
+  event.byte2 = 14;
+  event.byte3 = getPttLeadMs();
+  adapter.HandleMIDI(event);
+
+  event.byte2 = 15;
+  event.byte3 = getPttHangSteps();
+  adapter.HandleMIDI(event);
+#endif
 
-    event.byte2 = 2;
-    event.byte3 = txNoteVal;
+  if (keyerType <= 9) {
+    event.header = 0x0C; event.byte1 = 0xC0;
+    event.byte2 = keyerType; event.byte3 = 0;
     adapter.HandleMIDI(event);
-
-    if (keyerType >= 0 && keyerType <= 9) {
-      event.header = 0x0C; event.byte1 = 0xC0;
-      event.byte2 = keyerType; event.byte3 = 0;
-      adapter.HandleMIDI(event);
-    }
-  } else {
-    Serial.println("EEPROM initializing with default values...");
-    EEPROM.write(EEPROM_KEYER_TYPE_ADDR, 8);  // Default to Iambic B
-    EEPROM.put(EEPROM_DIT_DURATION_ADDR, (uint16_t)DEFAULT_ADAPTER_DIT_DURATION_MS);
-    EEPROM.write(EEPROM_TX_NOTE_ADDR, DEFAULT_TONE_NOTE);
-    EEPROM.write(EEPROM_RADIO_KEYER_MODE_ADDR, 0); // Default: Radio Keyer Mode OFF
-    EEPROM.write(EEPROM_VALID_FLAG_ADDR, EEPROM_VALID_VALUE);
-    eeprom_commit();
-    Serial.println("EEPROM initialized. Loading these defaults now.");
-    loadSettingsFromEEPROM(adapter);
   }
 }
 
 // ============================================================================
-// CW Memory EEPROM Functions
+// CW Memory Pool
 // ============================================================================
+// All slots share one pool of NVM. A directory maps each slot to a single
+// extent (write-unit aligned) holding its transition stream:
+//
+//   directory copy A | directory copy B | pool
+//
+// Directories are written last, alternating between the two copies with a
+// sequence number, so a save cut short by power loss leaves the previous
+// directory in charge. A save appends the new stream after the last live
+// extent; when that tail is too short (or not blank) the pool is first
+// defragmented, packing the other extents down to its start a block at a
+// time through RAM. Packing is the one step where power loss can cost slots:
+// their CRC no longer matches and they read back as empty.
+
+#define MEMORY_DIR_MAGIC 0xD1
+#define MEMORY_DIR_VERSION 1
+#define MEMORY_ENTRY_EMPTY 0xFF   // format of an unused directory entry
+
+struct MemoryDirEntry {
+  uint8_t format;           // MEMORY_FORMAT_*, or MEMORY_ENTRY_EMPTY
+  uint8_t reserved;
+  uint16_t transitionCount;
+  uint16_t offset;          // Pool offset of the stream
+  uint16_t length;          // Stream length in bytes
+  uint16_t unitMs;          // Dit length the stream was recorded at
+  uint16_t crc;             // Over the stream
+};
+
+struct MemoryDirectory {
+  uint8_t magic;
+  uint8_t version;
+  uint16_t sequence;
+  MemoryDirEntry entries[MAX_MEMORY_SLOTS];
+  uint16_t crc;             // Over all of the above
+};
+
+static_assert(sizeof(MemoryDirectory) == NVM_MEMORY_DIR_RECORD_SIZE, "Memory directory size");
+
+static MemoryDirectory memoryDirectory;
+static uint8_t memoryDirectoryCopy = 1;   // Copy holding memoryDirectory
+static bool memoryDirectoryLoaded = false;
+
+static inline uint32_t memoryDirectoryOffset(uint8_t copy) {
+  return NVM_MEMORY_DIR_OFFSET + (uint32_t)copy * NVM_MEMORY_DIR_COPY_SIZE;
+}
+
+static inline bool isEntryUsed(const MemoryDirEntry& entry) {
+  return entry.format != MEMORY_ENTRY_EMPTY;
+}
+
+static inline uint16_t extentSize(const MemoryDirEntry& entry) {
+  return NVM_ROUND_UP(entry.length, NVM_WRITE_SIZE);
+}
+
+static uint16_t directoryCrc(const MemoryDirectory& dir) {
+  return crc16Update(0xFFFF, &dir, sizeof(dir) - sizeof(dir.crc));
+}
+
+static void loadMemoryDirectory() {
+  if (memoryDirectoryLoaded) return;
+  memoryDirectoryLoaded = true;
+
+  bool found = false;
+  for (uint8_t copy = 0; copy < 2; copy++) {
+    MemoryDirectory dir;
+    nvmRead(memoryDirectoryOffset(copy), &dir, sizeof(dir));
+    if (dir.magic != MEMORY_DIR_MAGIC || dir.version != MEMORY_DIR_VERSION ||
+        dir.crc != directoryCrc(dir)) {
+      continue;
+    }
+    if (!found || (int16_t)(dir.sequence - memoryDirectory.sequence) > 0) {
+      memoryDirectory = dir;
+      memoryDirectoryCopy = copy;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    memset(&memoryDirectory, 0xFF, sizeof(memoryDirectory));
+    memoryDirectory.sequence = 0;
+    memoryDirectoryCopy = 1;  // First write goes to copy 0
+  }
+}
+
+static void writeMemoryDirectory(MemoryDirectory& dir) {
+  dir.magic = MEMORY_DIR_MAGIC;
+  dir.version = MEMORY_DIR_VERSION;
+  dir.sequence = memoryDirectory.sequence + 1;
+  dir.crc = directoryCrc(dir);
+
+  uint8_t copy = memoryDirectoryCopy ^ 1;
+  uint32_t base = memoryDirectoryOffset(copy);
+#if NVM_ERASE_BEFORE_WRITE
+  for (uint32_t offset = 0; offset < NVM_MEMORY_DIR_COPY_SIZE; offset += NVM_BLOCK_SIZE) {
+    nvmEraseBlock(base + offset);
+  }
+#endif
+  nvmWrite(base, &dir, sizeof(dir));
+
+  memoryDirectory = dir;
+  memoryDirectoryCopy = copy;
+}
+
+// End of the last live extent in dir, i.e. where an append would go
+static uint16_t memoryPoolTail(const MemoryDirectory& dir) {
+  uint16_t tail = 0;
+  for (uint8_t i = 0; i < MAX_MEMORY_SLOTS; i++) {
+    if (!isEntryUsed(dir.entries[i])) continue;
+    uint16_t end = dir.entries[i].offset + extentSize(dir.entries[i]);
+    if (end > tail) tail = end;
+  }
+  return tail;
+}
+
+// Pack the live extents of dir to the start of the pool, in pool order, and
+// erase what is left behind. Every extent only moves down, so each block is
+// assembled from data at or above it before it is rewritten. Returns the new
+// tail.
+static uint16_t defragmentMemoryPool(MemoryDirectory& dir) {
+  uint8_t order[MAX_MEMORY_SLOTS];
+  uint8_t used = 0;
+  for (uint8_t i = 0; i < MAX_MEMORY_SLOTS; i++) {
+    if (!isEntryUsed(dir.entries[i])) continue;
+    uint8_t j = used++;
+    while (j > 0 && dir.entries[order[j - 1]].offset > dir.entries[i].offset) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  uint16_t packed[MAX_MEMORY_SLOTS];
+  uint16_t tail = 0;
+  for (uint8_t k = 0; k < used; k++) {
+    packed[order[k]] = tail;
+    tail += extentSize(dir.entries[order[k]]);
+  }
+
+  uint8_t block[NVM_BLOCK_SIZE];
+  uint16_t blocksRewritten = 0;
+  for (uint16_t blockStart = 0; blockStart < NVM_MEMORY_POOL_SIZE; blockStart += NVM_BLOCK_SIZE) {
+    uint32_t blockOffset = NVM_MEMORY_POOL_OFFSET + blockStart;
+
+    if (blockStart >= tail) {
+#if NVM_ERASE_BEFORE_WRITE
+      if (!nvmIsErased(blockOffset, NVM_BLOCK_SIZE)) {
+        nvmEraseBlock(blockOffset);
+      }
+#endif
+      continue;
+    }
+
+    memset(block, 0xFF, sizeof(block));
+    bool moved = false;
+    for (uint8_t k = 0; k < used; k++) {
+      const MemoryDirEntry& entry = dir.entries[order[k]];
+      uint16_t dest = packed[order[k]];
+      uint16_t from = (dest > blockStart) ? dest : blockStart;
+      uint16_t to = dest + entry.length;
+      if (to > blockStart + NVM_BLOCK_SIZE) to = blockStart + NVM_BLOCK_SIZE;
+      if (from >= to) continue;
+      nvmRead(NVM_MEMORY_POOL_OFFSET + entry.offset + (from - dest),
+              block + (from - blockStart), to - from);
+      if (dest != entry.offset) moved = true;
+    }
+#if NVM_ERASE_BEFORE_WRITE
+    // The block holding the tail must also be blank past it for the append
+    if (!moved && blockStart + NVM_BLOCK_SIZE > tail &&
+        !nvmIsErased(NVM_MEMORY_POOL_OFFSET + tail, blockStart + NVM_BLOCK_SIZE - tail)) {
+      moved = true;
+    }
+#endif
+    if (!moved) continue;  // Block already holds its packed contents
+
+    nvmEraseBlock(blockOffset);
+    nvmWrite(blockOffset, block, NVM_BLOCK_SIZE);
+    blocksRewritten++;
+  }
+
+  for (uint8_t k = 0; k < used; k++) {
+    dir.entries[order[k]].offset = packed[order[k]];
+  }
 
-uint16_t getEEPROMAddressForSlot(uint8_t slotNumber) {
-  // Returns the starting EEPROM address for the given slot (0-2)
-  switch (slotNumber) {
-    case 0: return EEPROM_MEMORY_1_ADDR;
-    case 1: return EEPROM_MEMORY_2_ADDR;
-    case 2: return EEPROM_MEMORY_3_ADDR;
-    default: return EEPROM_MEMORY_1_ADDR;  // Safety fallback
+  Serial.print("Memory pool defragmented - ");
+  Serial.print(used);
+  Serial.print(" slots packed into ");
+  Serial.print(tail);
+  Serial.print(" bytes, ");
+  Serial.print(blocksRewritten);
+  Serial.println(" blocks rewritten");
+  return tail;
+}
+
+uint16_t getMemorySpaceForSlot(uint8_t slotNumber) {
+  if (slotNumber >= MAX_MEMORY_SLOTS) return 0;
+  loadMemoryDirectory();
+
+  uint16_t usedByOthers = 0;
+  for (uint8_t i = 0; i < MAX_MEMORY_SLOTS; i++) {
+    if (i == slotNumber || !isEntryUsed(memoryDirectory.entries[i])) continue;
+    usedByOthers += extentSize(memoryDirectory.entries[i]);
   }
+  return NVM_MEMORY_POOL_SIZE - usedByOthers;
 }
 
-void saveMemoryToEEPROM(uint8_t slotNumber, const CWMemory& memory) {
+// Write data to the pool as slotNumber's new extent, then commit the directory
+static void storeMemoryExtent(uint8_t slotNumber, uint8_t format, uint16_t transitionCount,
+                              uint16_t unitMs, const uint8_t* data, uint16_t dataBytes) {
   if (slotNumber >= MAX_MEMORY_SLOTS) return;  // Safety check
+  loadMemoryDirectory();
 
-  uint16_t baseAddr = getEEPROMAddressForSlot(slotNumber);
+  unsigned long startTime = micros();
 
-  // Write the transition count (2 bytes)
-  EEPROM.put(baseAddr, memory.transitionCount);
+  // The slot's old extent is free from here on
+  MemoryDirectory dir = memoryDirectory;
+  dir.entries[slotNumber].format = MEMORY_ENTRY_EMPTY;
 
-  // Write the transition data
-  uint16_t dataAddr = baseAddr + MEMORY_LENGTH_SIZE;
-  for (uint16_t i = 0; i < memory.transitionCount && i < MAX_TRANSITIONS_PER_MEMORY; i++) {
-    EEPROM.put(dataAddr + (i * 2), memory.transitions[i]);
+  uint16_t offset = memoryPoolTail(dir);
+  bool fits = (uint32_t)offset + dataBytes <= NVM_MEMORY_POOL_SIZE;
+#if NVM_ERASE_BEFORE_WRITE
+  fits = fits && nvmIsErased(NVM_MEMORY_POOL_OFFSET + offset, NVM_ROUND_UP(dataBytes, NVM_WRITE_SIZE));
+#endif
+  bool defragmented = false;
+  if (!fits) {
+    offset = defragmentMemoryPool(dir);
+    defragmented = true;
+    if ((uint32_t)offset + dataBytes > NVM_MEMORY_POOL_SIZE) {
+      // getMemorySpaceForSlot() bounds recordings, so this needs a corrupt directory
+      Serial.print("Memory slot ");
+      Serial.print(slotNumber + 1);
+      Serial.println(" - no room in memory pool, not saved");
+      writeMemoryDirectory(dir);
+      return;
+    }
+  }
+
+  if (dataBytes > 0) {
+    nvmWrite(NVM_MEMORY_POOL_OFFSET + offset, data, dataBytes);
   }
 
-  eeprom_commit();
+  // Directory last: it is what makes the slot valid
+  MemoryDirEntry& entry = dir.entries[slotNumber];
+  entry.format = format;
+  entry.reserved = 0xFF;
+  entry.transitionCount = transitionCount;
+  entry.offset = offset;
+  entry.length = dataBytes;
+  entry.unitMs = unitMs;
+  entry.crc = crc16Update(0xFFFF, data, dataBytes);
+  writeMemoryDirectory(dir);
+
+  unsigned long elapsed = micros() - startTime;
 
   Serial.print("Saved memory slot ");
   Serial.print(slotNumber + 1);
   Serial.print(" - ");
-  Serial.print(memory.transitionCount);
-  Serial.print(" transitions, ");
-  Serial.print(memory.getDurationMs());
-  Serial.println("ms duration");
+  Serial.print(entry.transitionCount);
+  Serial.print(format == MEMORY_FORMAT_TEXT ? " characters in " : " transitions in ");
+  Serial.print(dataBytes);
+  Serial.print(" bytes at pool offset ");
+  Serial.print(offset);
+  Serial.print(" (format ");
+  Serial.print(entry.format);
+  Serial.print(defragmented ? ", defragmented" : "");
+  Serial.print("), save took ");
+  Serial.print(elapsed);
+  Serial.println("us");
 }
 
-void loadMemoryFromEEPROM(uint8_t slotNumber, CWMemory& memory) {
-  if (slotNumber >= MAX_MEMORY_SLOTS) {
-    memory.clear();
+void saveMemoryToEEPROM(uint8_t slotNumber, const MemoryStreamWriter& stream) {
+  storeMemoryExtent(slotNumber, stream.format(), stream.transitionCount(), stream.unitMs(),
+                    stream.data(), stream.length());
+}
+
+void saveTextMemoryToEEPROM(uint8_t slotNumber, const uint8_t* text, uint16_t length,
+                            uint16_t unitMs) {
+  if (length == 0) {
+    clearMemoryInEEPROM(slotNumber);
     return;
   }
-
-  uint16_t baseAddr = getEEPROMAddressForSlot(slotNumber);
-
-  // Read the transition count
-  uint16_t count;
-  EEPROM.get(baseAddr, count);
-
-  // Validate the count
-  if (count > MAX_TRANSITIONS_PER_MEMORY) {
-    // Invalid data, clear the memory
-    memory.clear();
+  if (length > MEMORY_TEXT_MAX_LENGTH || length > getMemorySpaceForSlot(slotNumber)) {
     Serial.print("Memory slot ");
     Serial.print(slotNumber + 1);
-    Serial.println(" - invalid data, cleared");
+    Serial.println(" - text too long, not saved");
     return;
   }
+  storeMemoryExtent(slotNumber, MEMORY_FORMAT_TEXT, length, unitMs, text, length);
+}
 
-  memory.transitionCount = count;
+bool openStoredMemory(uint8_t slotNumber, StoredMemory& memory) {
+  memory = StoredMemory();
+  if (slotNumber >= MAX_MEMORY_SLOTS) return false;
+  loadMemoryDirectory();
 
-  // Read the transition data
-  uint16_t dataAddr = baseAddr + MEMORY_LENGTH_SIZE;
-  for (uint16_t i = 0; i < count; i++) {
-    EEPROM.get(dataAddr + (i * 2), memory.transitions[i]);
+  const MemoryDirEntry& entry = memoryDirectory.entries[slotNumber];
+  if (entry.format != MEMORY_FORMAT_RAW16 && entry.format != MEMORY_FORMAT_UNITS &&
+      entry.format != MEMORY_FORMAT_TEXT) {
+    return false;
+  }
+  if ((uint32_t)entry.offset + entry.length > NVM_MEMORY_POOL_SIZE) {
+    return false;
   }
 
-  Serial.print("Loaded memory slot ");
-  Serial.print(slotNumber + 1);
-  Serial.print(" - ");
-  Serial.print(memory.transitionCount);
-  Serial.print(" transitions, ");
-  Serial.print(memory.getDurationMs());
-  Serial.println("ms duration");
+  uint32_t dataOffset = NVM_MEMORY_POOL_OFFSET + entry.offset;
+  if (nvmCrc16(dataOffset, entry.length) != entry.crc) {
+    Serial.print("Memory slot ");
+    Serial.print(slotNumber + 1);
+    Serial.println(" - CRC mismatch, ignored");
+    return false;
+  }
+
+  memory.dataOffset = dataOffset;
+  memory.dataLength = entry.length;
+  memory.transitionCount = entry.transitionCount;
+  memory.unitMs = entry.unitMs;
+  memory.format = entry.format;
+  return true;
 }
 
 void clearMemoryInEEPROM(uint8_t slotNumber) {
   if (slotNumber >= MAX_MEMORY_SLOTS) return;
+  loadMemoryDirectory();
 
-  uint16_t baseAddr = getEEPROMAddressForSlot(slotNumber);
-
-  // Write 0 for the transition count
-  uint16_t zero = 0;
-  EEPROM.put(baseAddr, zero);
-  eeprom_commit();
+  // The extent is reclaimed by the next defragmentation
+  MemoryDirectory dir = memoryDirectory;
+  dir.entries[slotNumber].format = MEMORY_ENTRY_EMPTY;
+  writeMemoryDirectory(dir);
 
   Serial.print("Cleared memory slot ");
   Serial.println(slotNumber + 1);
 }
 
-void loadMemoriesFromEEPROM(CWMemory memorySlots[]) {
-  Serial.println("Loading CW memories from EEPROM...");
+void logStoredMemories() {
+  loadMemoryDirectory();
+  uint16_t used = 0;
   for (uint8_t i = 0; i < MAX_MEMORY_SLOTS; i++) {
-    loadMemoryFromEEPROM(i, memorySlots[i]);
+    if (isEntryUsed(memoryDirectory.entries[i])) used += extentSize(memoryDirectory.entries[i]);
+  }
+  Serial.print("Checking stored CW memories (pool ");
+  Serial.print(used);
+  Serial.print("/");
+  Serial.print(NVM_MEMORY_POOL_SIZE);
+  Serial.println(" bytes used)...");
+  for (uint8_t i = 0; i < MAX_MEMORY_SLOTS; i++) {
+    StoredMemory memory;
+    Serial.print("Memory slot ");
+    Serial.print(i + 1);
+    if (openStoredMemory(i, memory)) {
+      Serial.print(" - ");
+      Serial.print(memory.transitionCount);
+      Serial.print(memory.isText() ? " characters, " : " transitions, ");
+      Serial.print(memory.getDurationMs());
+      Serial.print("ms duration, ");
+      Serial.print(memory.dataLength);
+      Serial.println(" bytes");
+    } else {
+      Serial.println(" - empty");
+    }
   }
 }
@@ -6,17 +6,41 @@
 #include "memory.h"
 
 // EEPROM operations for adapter settings
-void saveSettingsToEEPROM(uint8_t keyerType, uint16_t ditDuration, uint8_t txNote);
+void saveSettingsToEEPROM(uint8_t keyerType, uint32_t ditDurationUs, uint8_t txNote);
 void saveRadioKeyerModeToEEPROM(bool radioKeyerMode);
 void loadSettingsFromEEPROM(VailAdapter& adapter);
 void loadRadioKeyerModeFromEEPROM(VailAdapter& adapter);
 uint8_t loadToneFromEEPROM();
+uint8_t getVolume();                          // 0 (silent) to VOLUME_MAX
+void saveVolumeToEEPROM(uint8_t volume);
+#ifdef RADIO_PTT_PIN
+uint8_t getPttLeadMs();                       // 0-127 ms
+uint8_t getPttHangSteps();                    // 0-127 steps of PTT_HANG_STEP_MS
+void savePttTimingToEEPROM(uint8_t leadMs, uint8_t hangSteps);
+#endif
 
-// EEPROM operations for CW memory slots
-uint16_t getEEPROMAddressForSlot(uint8_t slotNumber);
-void saveMemoryToEEPROM(uint8_t slotNumber, const CWMemory& memory);
-void loadMemoryFromEEPROM(uint8_t slotNumber, CWMemory& memory);
+// Write-back settings cache: saves above only update RAM; the commit happens
+// after SETTINGS_COMMIT_IDLE_MS without changes, or on an explicit flush
+void serviceSettingsStore(unsigned long currentTime);  // Call from main loop
+void flushSettingsToEEPROM();                          // Call before a reset
+uint32_t getSettingsCommitCount();
+uint32_t getSettingsCommitsAvoided();
+
+// Contest macro variables, kept in the settings store ({NR} and {CALL})
+#define SETTINGS_CALLSIGN_LENGTH 12
+#define CONTEST_SERIAL_MAX 9999
+uint16_t getContestSerial();                  // Next serial number to send
+void saveContestSerialToEEPROM(uint16_t serial);
+char getCallSignChar(uint8_t index);          // 0 past the end
+void saveCallSignToEEPROM(const uint8_t* callSign, uint8_t length);
+
+// Storage operations for CW memory slots (a directory over one shared pool)
+void saveMemoryToEEPROM(uint8_t slotNumber, const MemoryStreamWriter& stream);
+void saveTextMemoryToEEPROM(uint8_t slotNumber, const uint8_t* text, uint16_t length,
+                            uint16_t unitMs);  // Empty text clears the slot
+uint16_t getMemorySpaceForSlot(uint8_t slotNumber);  // Bytes a new stream may use
+bool openStoredMemory(uint8_t slotNumber, StoredMemory& memory);  // False if empty/invalid
 void clearMemoryInEEPROM(uint8_t slotNumber);
-void loadMemoriesFromEEPROM(CWMemory memorySlots[]);
+void logStoredMemories();
 
 #endif // SETTINGS_EEPROM_H
@@ -0,0 +1,66 @@
+#include "settings_log.h"
+#include "crc16.h"
+#include <stddef.h>
+#include <string.h>
+
+static uint16_t settingsRecordCrc(const SettingsRecord& record) {
+  return crc16Update(0xFFFF, &record, offsetof(SettingsRecord, crc));
+}
+
+SettingsLog::SettingsLog(const SettingsLogStorage& storage)
+  : storage(storage), latest(-1), latestSequence(0) {}
+
+uint32_t SettingsLog::slotOffset(uint16_t slot) const {
+  return (uint32_t)slot * storage.slotSize + storage.offset;
+}
+
+bool SettingsLog::readRecord(uint16_t slot, SettingsRecord& record) const {
+  storage.read(slotOffset(slot), &record, sizeof(record));
+  return record.magic == SETTINGS_RECORD_MAGIC &&
+         record.length <= SETTINGS_PAYLOAD_MAX &&
+         record.crc == settingsRecordCrc(record);
+}
+
+bool SettingsLog::scan(SettingsRecord& newest) {
+  SettingsRecord record;
+  latest = -1;
+  for (uint16_t slot = 0; slot < storage.slotCount; slot++) {
+    if (!readRecord(slot, record)) continue;
+    if (latest < 0 || (int32_t)(record.sequence - latestSequence) > 0) {
+      latest = slot;
+      latestSequence = record.sequence;
+      newest = record;
+    }
+  }
+  return latest >= 0;
+}
+
+bool SettingsLog::append(const void* payload, uint8_t length) {
+  SettingsRecord record;
+  memset(&record, 0xFF, sizeof(record));
+  record.magic = SETTINGS_RECORD_MAGIC;
+  record.version = SETTINGS_RECORD_VERSION;
+  record.length = length;
+  record.reserved = 0;
+  record.sequence = latestSequence + 1;
+  memcpy(record.payload, payload, length);
+  record.crc = settingsRecordCrc(record);
+
+  uint16_t slot = (latest < 0) ? 0 : (latest + 1) % storage.slotCount;
+  for (uint16_t tries = 0; tries < storage.slotCount; tries++) {
+    uint32_t offset = slotOffset(slot);
+    if (slot % storage.slotsPerBlock == 0) {
+      storage.eraseBlock(offset);
+    }
+    // A torn write can leave junk in the next slot; skip to a fresh block
+    if (storage.eraseBeforeWrite && !storage.isErased(offset, storage.slotSize)) {
+      slot = (slot / storage.slotsPerBlock + 1) * storage.slotsPerBlock % storage.slotCount;
+      continue;
+    }
+    storage.write(offset, &record, sizeof(record));
+    latest = slot;
+    latestSequence = record.sequence;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,83 @@
+#ifndef SETTINGS_LOG_H
+#define SETTINGS_LOG_H
+
+#include <stdint.h>
+
+// ============================================================================
+// SETTINGS RECORD LOG
+// ============================================================================
+// Settings live in an append-only log of fixed-size records rather than
+// being rewritten in place. Each record holds a full snapshot, a sequence
+// number and a CRC:
+//
+//   magic | version | length | reserved | sequence (4) | payload | crc16
+//
+// - scan() reads every record slot once and takes the valid record with the
+//   highest sequence number, so a torn write just falls back to the previous one
+// - Records are appended round-robin; entering a new block erases it first.
+//   Everything in that block is superseded, so this is also the compaction step
+// - Wear is spread over the whole log instead of one block
+//
+// The log runs on any storage with the erase/write rules of nvm_storage.h,
+// described by a SettingsLogStorage: the NVM region on the adapter, a flash
+// model in tools/settings_log_bench.
+//
+// This file has no Arduino dependencies so host tools can build it as-is.
+// ============================================================================
+
+#define SETTINGS_RECORD_MAGIC 0x56    // 'V'
+#define SETTINGS_RECORD_VERSION 1
+#define SETTINGS_RECORD_SIZE 32
+#define SETTINGS_PAYLOAD_MAX (SETTINGS_RECORD_SIZE - 10)
+
+struct SettingsRecord {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t length;      // Valid payload bytes; newer fields missing from old records keep defaults
+  uint8_t reserved;
+  uint32_t sequence;
+  uint8_t payload[SETTINGS_PAYLOAD_MAX];
+  uint16_t crc;        // Over all bytes above
+};
+
+static_assert(sizeof(SettingsRecord) == SETTINGS_RECORD_SIZE, "Settings record size");
+
+// Where the log lives and the storage operations it needs. Offsets are
+// from the start of the storage; slotSize is at least one write unit, so
+// appending never rewrites programmed bytes.
+struct SettingsLogStorage {
+  void (*read)(uint32_t offset, void* dst, uint16_t len);
+  void (*eraseBlock)(uint32_t offset);
+  void (*write)(uint32_t offset, const void* src, uint16_t len);
+  bool (*isErased)(uint32_t offset, uint16_t len);
+  uint32_t offset;          // Start of the log
+  uint16_t slotSize;
+  uint16_t slotCount;
+  uint16_t slotsPerBlock;
+  bool eraseBeforeWrite;    // Flash: a slot must read erased to be written
+};
+
+class SettingsLog {
+public:
+    SettingsLog(const SettingsLogStorage& storage);
+
+    // Find the newest valid record; returns false if the log is empty
+    bool scan(SettingsRecord& latest);
+
+    // Append a record holding length bytes of payload after the newest one;
+    // returns false if no slot could be written
+    bool append(const void* payload, uint8_t length);
+
+    uint32_t sequence() const { return latestSequence; }
+    int16_t latestSlot() const { return latest; }
+
+private:
+    const SettingsLogStorage& storage;
+    int16_t latest;             // Slot of the newest valid record, -1 if none
+    uint32_t latestSequence;    // Sequence number of that record
+
+    uint32_t slotOffset(uint16_t slot) const;
+    bool readRecord(uint16_t slot, SettingsRecord& record) const;
+};
+
+#endif // SETTINGS_LOG_H
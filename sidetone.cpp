@@ -0,0 +1,225 @@
+#include "sidetone.h"
+#include "usb_audio.h"
+
+#ifdef SIDETONE_DAC
+
+#if defined(PIN_A0) && (PIN_A0 == DIT_PIN || PIN_A0 == DAH_PIN || PIN_A0 == KEY_PIN)
+  #error "SIDETONE_DAC needs A0, which this board uses as a paddle or key input"
+#endif
+
+#define SIDETONE_DMA_CHANNEL 0
+#define SIDETONE_TIMER_TOP (F_CPU / SIDETONE_SAMPLE_RATE - 1)
+#define SIDETONE_SAMPLES_PER_MS (SIDETONE_SAMPLE_RATE / 1000)
+
+// An edge is heard this long after its keyed time: the two blocks queued
+// for the DMA, a block of slack for loop jitter, and half a ramp so the
+// ramp is centred on the edge (5.5 ms at the default 5 ms rise)
+#define SIDETONE_LATENCY_SAMPLES (3 * SIDETONE_BLOCK_SAMPLES + synth.rampSamples() / 2)
+
+// ============================================================================
+// Engine State (shared with the DMA interrupt)
+// ============================================================================
+
+static SidetoneSynth synth;
+
+// Voice levels (Q15), by PolyBuzzer slot: the local sidetone on top, host
+// notes 6 dB and UI cues 3 dB below it, the spare voice as host notes
+static const uint16_t voiceLevels[SIDETONE_VOICES] = {32768, 16423, 23198, 16423};
+static uint16_t blocks[2][SIDETONE_BLOCK_SAMPLES];
+static volatile bool blockSilent[2] = {true, true};
+static volatile uint8_t finishedBlock = 0;   // Block the next interrupt refills
+static volatile bool running = false;
+
+// The sample that started playing at anchorMicros, updated every block
+static volatile uint32_t anchorSample = 0;
+static volatile unsigned long anchorMicros = 0;
+
+// The DMAC reads channel descriptors from a 16-byte aligned table in SRAM
+static DmacDescriptor descriptors[SIDETONE_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static DmacDescriptor writeback[SIDETONE_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+// The rest of the ring after the channel's own descriptor. With USB audio
+// each block plays as two halves, so the endpoint can be refilled every
+// half block (usb_audio_stream.h).
+#ifdef SIDETONE_USB_AUDIO
+#define SIDETONE_DMA_PARTS 2
+static volatile bool secondHalf = false;
+#else
+#define SIDETONE_DMA_PARTS 1
+#endif
+#define SIDETONE_DMA_BEATS (SIDETONE_BLOCK_SAMPLES / SIDETONE_DMA_PARTS)
+static DmacDescriptor ring[2 * SIDETONE_DMA_PARTS - 1] __attribute__((aligned(16)));
+
+static inline void timerSync() {
+  while (TC4->COUNT16.STATUS.bit.SYNCBUSY);
+}
+
+static void setupDescriptor(DmacDescriptor* d, uint16_t* samples, DmacDescriptor* next) {
+  d->BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BLOCKACT_INT |
+                  DMAC_BTCTRL_BEATSIZE_HWORD | DMAC_BTCTRL_SRCINC;
+  d->BTCNT.reg = SIDETONE_DMA_BEATS;
+  // With SRCINC the source address is the end of the samples
+  d->SRCADDR.reg = (uint32_t)(samples + SIDETONE_DMA_BEATS);
+  d->DSTADDR.reg = (uint32_t)&DAC->DATA.reg;
+  d->DESCADDR.reg = (uint32_t)next;
+}
+
+static void stopEngine() {
+  TC4->COUNT16.CTRLA.bit.ENABLE = 0;
+  timerSync();
+  DMAC->CHID.reg = DMAC_CHID_ID(SIDETONE_DMA_CHANNEL);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  running = false;
+}
+
+// The channel restarts from its base descriptor, so both blocks are
+// rendered and block 0 plays first
+static void startEngine() {
+  blockSilent[0] = !synth.render(blocks[0], SIDETONE_BLOCK_SAMPLES);
+  blockSilent[1] = !synth.render(blocks[1], SIDETONE_BLOCK_SAMPLES);
+  finishedBlock = 0;
+#ifdef SIDETONE_USB_AUDIO
+  secondHalf = false;
+#endif
+  running = true;
+
+  DMAC->CHID.reg = DMAC_CHID_ID(SIDETONE_DMA_CHANNEL);
+  DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+  TC4->COUNT16.COUNT.reg = 0;
+  timerSync();
+  TC4->COUNT16.CTRLA.bit.ENABLE = 1;
+  timerSync();
+}
+
+void DMAC_Handler() {
+  DMAC->CHID.reg = DMAC_CHID_ID(SIDETONE_DMA_CHANNEL);
+  if (!(DMAC->CHINTFLAG.reg & DMAC_CHINTFLAG_TCMPL)) return;
+  DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL;
+
+#ifdef SIDETONE_USB_AUDIO
+  // Halfway through a block only the USB endpoint needs a refill
+  secondHalf = !secondHalf;
+  if (secondHalf) {
+    usbAudioPump();
+    return;
+  }
+#else
+  // Both blocks silent: the DAC is resting at mid scale and can be left there
+  if (blockSilent[0] && blockSilent[1] && !synth.active()) {
+    stopEngine();
+    return;
+  }
+#endif
+
+  anchorSample += SIDETONE_BLOCK_SAMPLES;
+  anchorMicros = micros();
+
+  uint8_t block = finishedBlock;
+  blockSilent[block] = !synth.render(blocks[block], SIDETONE_BLOCK_SAMPLES);
+  finishedBlock = block ^ 1;
+#ifdef SIDETONE_USB_AUDIO
+  usbAudioBlock(blocks[block]);
+#endif
+}
+
+// Sample at which an edge keyed at when (micros) is heard
+static uint32_t edgeSample(unsigned long when) {
+  noInterrupts();
+  uint32_t sample = anchorSample;
+  unsigned long at = anchorMicros;
+  interrupts();
+  int32_t offset = (int32_t)(when - at) * SIDETONE_SAMPLES_PER_MS / 1000;
+  return sample + offset + SIDETONE_LATENCY_SAMPLES;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void initSidetone() {
+  // The core's analogWrite sets up the DAC clock, pin mux and reference
+  analogWriteResolution(SIDETONE_DAC_BITS);
+  analogWrite(A0, SIDETONE_DAC_MID);
+
+  // TC4: one overflow (= one DMA beat) per sample
+  PM->APBCMASK.reg |= PM_APBCMASK_TC4;
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_TC4_TC5;
+  while (GCLK->STATUS.bit.SYNCBUSY);
+
+  TC4->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+  while (TC4->COUNT16.CTRLA.bit.SWRST);
+
+  TC4->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV1;
+  timerSync();
+  TC4->COUNT16.CC[0].reg = SIDETONE_TIMER_TOP;
+  timerSync();
+
+  // DMAC: one channel, a descriptor per block (or half block) in a ring
+  PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+  PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+  DMAC->CTRL.reg = 0;
+  DMAC->CTRL.reg = DMAC_CTRL_SWRST;
+  while (DMAC->CTRL.bit.SWRST);
+  DMAC->BASEADDR.reg = (uint32_t)descriptors;
+  DMAC->WRBADDR.reg = (uint32_t)writeback;
+  DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+
+  DMAC->CHID.reg = DMAC_CHID_ID(SIDETONE_DMA_CHANNEL);
+  DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+  while (DMAC->CHCTRLA.bit.SWRST);
+  DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(TC4_DMAC_ID_OVF) |
+                      DMAC_CHCTRLB_TRIGACT_BEAT;
+  DMAC->CHINTENSET.reg = DMAC_CHINTENSET_TCMPL;
+
+  // The ring: descriptors[channel] and then ring[], over blocks[0] and [1]
+  DmacDescriptor* part = &descriptors[SIDETONE_DMA_CHANNEL];
+  for (uint8_t i = 0; i < 2 * SIDETONE_DMA_PARTS; i++) {
+    DmacDescriptor* next = (i + 1 < 2 * SIDETONE_DMA_PARTS) ? &ring[i] : &descriptors[SIDETONE_DMA_CHANNEL];
+    setupDescriptor(part, &blocks[0][0] + i * SIDETONE_DMA_BEATS, next);
+    part = next;
+  }
+
+  // Below the radio edge timer, which must not be held up
+  NVIC_SetPriority(DMAC_IRQn, 1);
+  NVIC_EnableIRQ(DMAC_IRQn);
+
+  synth.setRiseTime(SIDETONE_RISE_MS);
+  for (uint8_t voice = 0; voice < SIDETONE_VOICES; voice++) {
+    synth.setVoiceLevel(voice, voiceLevels[voice]);
+  }
+
+  Serial.print("DAC sidetone initialized (TC4 + DMA on A0), rise ");
+  Serial.print(synth.rampSamples() / SIDETONE_SAMPLES_PER_MS);
+  Serial.println("ms");
+
+#ifdef SIDETONE_USB_AUDIO
+  // The USB stream needs a block every frame, silent or not
+  startEngine();
+  Serial.println("USB audio sidetone stream enabled");
+#endif
+}
+
+void sidetonePlay(uint8_t voice, uint32_t increment, unsigned long when) {
+  if (!running) {
+    if (increment == 0) return;
+    // Start a new timeline: the next sample rendered plays first
+    anchorSample = synth.sampleClock();
+    anchorMicros = micros();
+  }
+  // Queuing the edge first keeps the interrupt from stopping the engine
+  // under us: it only stops when there is nothing left to play. A key-up
+  // is played out (the fall) before the timer stops.
+  synth.keyStepAt(voice, edgeSample(when), increment);
+  if (synth.active() && !running) {
+    startEngine();
+  }
+}
+
+void sidetoneSetVolume(uint16_t gain) {
+  synth.setVolume(gain);
+}
+
+void sidetoneSetVoiceLevel(uint8_t voice, uint16_t gain) {
+  synth.setVoiceLevel(voice, gain);
+}
+
+#endif // SIDETONE_DAC
@@ -0,0 +1,45 @@
+#ifndef SIDETONE_H
+#define SIDETONE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifdef SIDETONE_DAC
+
+#include "sidetone_synth.h"
+
+// ============================================================================
+// DAC Sine Sidetone
+// ============================================================================
+// A sine sidetone on the DAC pin (A0) in place of tone() on the piezo. TC4
+// overflows at SIDETONE_SAMPLE_RATE and each overflow triggers one DMA beat
+// from a sample block to DAC->DATA. Two blocks are chained in a ring; the
+// DMA interrupt refills whichever block just finished (one interrupt every
+// SIDETONE_BLOCK_SAMPLES samples). The timer stops once a silent block has
+// played, so the engine costs nothing between tones. With SIDETONE_USB_AUDIO
+// it keeps running, interrupts every half block, and every block is also
+// sent to the host (usb_audio.h).
+//
+// Key edges carry their keyed time (micros) and are rendered at a fixed
+// latency behind it, each with a SIDETONE_RISE_MS raised-cosine ramp
+// centred on the edge, so element timing is kept to the sample.
+//
+// Each PolyBuzzer slot plays on its own voice (local sidetone, host notes,
+// UI cues), and the voices are mixed, so they are heard together.
+
+// Configure the DAC, TC4 and the DMA channel (call once from setup)
+void initSidetone();
+
+// Play voice at phase step increment (sidetonePhaseIncrement or
+// sidetoneNoteIncrement) from when (micros), or stop it for 0. A playing
+// tone changes pitch without restarting its wave.
+void sidetonePlay(uint8_t voice, uint32_t increment, unsigned long when);
+
+// Master output level and the level of one voice, Q15 (SIDETONE_GAIN_ONE =
+// full scale)
+void sidetoneSetVolume(uint16_t gain);
+void sidetoneSetVoiceLevel(uint8_t voice, uint16_t gain);
+
+#endif // SIDETONE_DAC
+
+#endif // SIDETONE_H
@@ -0,0 +1,279 @@
+#include "sidetone_synth.h"
+
+// sin(i * pi / 128) for i = 0..64, Q15: one quarter of a 256 step wave
+static const int16_t quarterSine[65] = {
+      0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+   6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+  12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+  18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+  23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+  27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+  30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+  32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+  32767,
+};
+
+// Q15 down to the DAC's signed range
+#define SIDETONE_SAMPLE_SHIFT (16 - SIDETONE_DAC_BITS)
+
+static inline int16_t sineAt(const int16_t* table, uint32_t phase) {
+  uint8_t index = phase >> 24;
+  uint8_t step = index & 0x3F;
+  int16_t value = (index & 0x40) ? table[64 - step] : table[step];
+  return (index & 0x80) ? -value : value;
+}
+
+uint32_t sidetonePhaseIncrement(uint16_t hz) {
+  // 2^32 * hz / rate, rounded
+  return (uint32_t)((((uint64_t)hz << 32) + SIDETONE_SAMPLE_RATE / 2) / SIDETONE_SAMPLE_RATE);
+}
+
+// ============================================================================
+// Note table
+// ============================================================================
+// Both tables are constant expressions, so the compiler evaluates them in
+// double precision and they land in flash as plain constants. Powers are
+// repeated multiplication: a C++11 constexpr function is a single return.
+
+#define SEMITONE_RATIO 1.0594630943592953   // 2^(1/12)
+#define CENT_RATIO     1.0005777895065548   // 2^(1/1200)
+
+static constexpr double ratioPower(double ratio, int n) {
+  return n == 0 ? 1.0 : n > 0 ? ratio * ratioPower(ratio, n - 1) : ratioPower(ratio, n + 1) / ratio;
+}
+
+static constexpr uint32_t notePhaseStep(int note) {
+  return (uint32_t)(440.0 * ratioPower(SEMITONE_RATIO, note - 69) * 4294967296.0 / SIDETONE_SAMPLE_RATE + 0.5);
+}
+
+// 2^(c/1200) - 1 in 1/65536ths: the fraction a step grows by over c cents
+static constexpr uint16_t centFraction(int c) {
+  return (uint16_t)((ratioPower(CENT_RATIO, c) - 1.0) * 65536.0 + 0.5);
+}
+
+#define NOTE_STEPS_8(n) \
+  notePhaseStep(n), notePhaseStep(n + 1), notePhaseStep(n + 2), notePhaseStep(n + 3), \
+  notePhaseStep(n + 4), notePhaseStep(n + 5), notePhaseStep(n + 6), notePhaseStep(n + 7)
+
+#define CENT_FRACTIONS_10(c) \
+  centFraction(c), centFraction(c + 1), centFraction(c + 2), centFraction(c + 3), centFraction(c + 4), \
+  centFraction(c + 5), centFraction(c + 6), centFraction(c + 7), centFraction(c + 8), centFraction(c + 9)
+
+static const uint32_t noteSteps[128] = {
+  NOTE_STEPS_8(0),   NOTE_STEPS_8(8),   NOTE_STEPS_8(16),  NOTE_STEPS_8(24),
+  NOTE_STEPS_8(32),  NOTE_STEPS_8(40),  NOTE_STEPS_8(48),  NOTE_STEPS_8(56),
+  NOTE_STEPS_8(64),  NOTE_STEPS_8(72),  NOTE_STEPS_8(80),  NOTE_STEPS_8(88),
+  NOTE_STEPS_8(96),  NOTE_STEPS_8(104), NOTE_STEPS_8(112), NOTE_STEPS_8(120),
+};
+
+static const uint16_t centFractions[100] = {
+  CENT_FRACTIONS_10(0),  CENT_FRACTIONS_10(10), CENT_FRACTIONS_10(20), CENT_FRACTIONS_10(30),
+  CENT_FRACTIONS_10(40), CENT_FRACTIONS_10(50), CENT_FRACTIONS_10(60), CENT_FRACTIONS_10(70),
+  CENT_FRACTIONS_10(80), CENT_FRACTIONS_10(90),
+};
+
+static_assert(notePhaseStep(69) == 118111601UL, "A4 must be 440 Hz at the sidetone sample rate");
+
+uint32_t sidetoneNoteIncrement(uint8_t note, int8_t cents) {
+  int16_t pitch = (int16_t)(note & 0x7F) * 100 + cents;
+  if (pitch < 0) pitch = 0;
+  uint8_t semitone = pitch / 100;
+  uint8_t cent = pitch % 100;
+  if (semitone > 127) return 0;
+  uint64_t step = noteSteps[semitone];
+  step += (step * centFractions[cent]) >> 16;
+  return (step > SIDETONE_MAX_INCREMENT) ? 0 : (uint32_t)step;
+}
+
+SidetoneSynth::SidetoneSynth() : clock(0), volume(SIDETONE_GAIN_ONE), ramp(0) {
+  for (uint8_t n = 0; n < SIDETONE_VOICES; n++) {
+    Voice& v = voices[n];
+    v.edgeHead = 0;
+    v.edgeTail = 0;
+    v.phase = 0;
+    v.increment = 0;
+    v.level = 0;
+    v.keyed = false;
+    v.gain = SIDETONE_GAIN_ONE;
+    v.sine = v.sineTables[1];
+    scaleSine(v);
+  }
+  setRiseTime(SIDETONE_RISE_MIN_MS);
+}
+
+void SidetoneSynth::setRiseTime(uint8_t ms) {
+  if (ms < SIDETONE_RISE_MIN_MS) ms = SIDETONE_RISE_MIN_MS;
+  if (ms > SIDETONE_RISE_MAX_MS) ms = SIDETONE_RISE_MAX_MS;
+  ramp = (uint16_t)ms * (SIDETONE_SAMPLE_RATE / 1000);
+
+  // Raised cosine (1 - cos(pi k/ramp)) / 2 = sin^2(pi/2 k/ramp), with the
+  // sine interpolated from the quarter-wave table
+  for (uint16_t k = 0; k < ramp; k++) {
+    uint32_t position = ((uint32_t)k << 14) / ramp;  // 64 table steps, 8 fraction bits
+    uint8_t index = position >> 8;
+    int32_t sine = quarterSine[index];
+    sine += ((quarterSine[index + 1] - sine) * (int32_t)(position & 0xFF)) >> 8;
+    gain[k] = (uint16_t)((sine * sine + (1 << 14)) >> 15);
+  }
+  gain[ramp] = SIDETONE_GAIN_ONE;
+  for (uint8_t n = 0; n < SIDETONE_VOICES; n++) {
+    if (voices[n].level > ramp) voices[n].level = ramp;
+  }
+}
+
+// Write the voice's sine at its level and the master volume into the table
+// render() is not reading, then hand it over
+void SidetoneSynth::scaleSine(Voice& v) {
+  uint32_t scale = ((uint32_t)volume * v.gain) >> 15;
+  int16_t* next = (v.sine == v.sineTables[0]) ? v.sineTables[1] : v.sineTables[0];
+  for (uint8_t i = 0; i < 65; i++) {
+    next[i] = (int16_t)(((int32_t)quarterSine[i] * (int32_t)scale) >> 15);
+  }
+  v.sine = next;
+}
+
+void SidetoneSynth::setVolume(uint16_t gain) {
+  if (gain > SIDETONE_GAIN_ONE) gain = SIDETONE_GAIN_ONE;
+  volume = gain;
+  for (uint8_t n = 0; n < SIDETONE_VOICES; n++) scaleSine(voices[n]);
+}
+
+void SidetoneSynth::setVoiceLevel(uint8_t voice, uint16_t gain) {
+  if (voice >= SIDETONE_VOICES) return;
+  if (gain > SIDETONE_GAIN_ONE) gain = SIDETONE_GAIN_ONE;
+  voices[voice].gain = gain;
+  scaleSine(voices[voice]);
+}
+
+bool SidetoneSynth::keyStepAt(uint8_t voice, uint32_t sample, uint32_t step) {
+  if (voice >= SIDETONE_VOICES) return false;
+  Voice& v = voices[voice];
+  uint8_t head = v.edgeHead;
+  uint8_t next = (head + 1) % SIDETONE_EDGE_QUEUE;
+  if (next == v.edgeTail) return false;
+
+  Edge& edge = v.edges[head];
+  edge.start = sample - ramp / 2;
+  if (head != v.edgeTail) {
+    // Keep the queue in order
+    uint32_t last = v.edges[(head + SIDETONE_EDGE_QUEUE - 1) % SIDETONE_EDGE_QUEUE].start;
+    if ((int32_t)(edge.start - last) < 0) edge.start = last;
+  }
+  // Above Nyquist there is nothing left to play
+  edge.increment = (step > SIDETONE_MAX_INCREMENT) ? 0 : step;
+  v.edgeHead = next;
+  return true;
+}
+
+void SidetoneSynth::setFrequency(uint8_t voice, uint16_t frequency) {
+  keyAt(voice, clock + ramp / 2, frequency);
+}
+
+bool SidetoneSynth::active() const {
+  for (uint8_t n = 0; n < SIDETONE_VOICES; n++) {
+    const Voice& v = voices[n];
+    if (v.keyed || v.level > 0 || v.edgeHead != v.edgeTail) return true;
+  }
+  return false;
+}
+
+void SidetoneSynth::applyEdge(Voice& v, const Edge& edge) {
+  if (edge.increment == 0) {
+    v.keyed = false;
+    return;
+  }
+  if (!v.keyed && v.level == 0) v.phase = 0;
+  v.increment = edge.increment;
+  v.keyed = true;
+}
+
+// Add count samples of one voice, from the current clock, into mix
+bool SidetoneSynth::renderVoice(Voice& v, int32_t* mix, uint16_t count, uint16_t* envelope) {
+  const int16_t* table = v.sine;  // One level per block
+  uint32_t now = clock;
+  bool sounding = false;
+  uint16_t i = 0;
+  while (i < count) {
+    // Apply due edges, then run up to the next one
+    uint16_t run = count - i;
+    while (v.edgeTail != v.edgeHead) {
+      const Edge& edge = v.edges[v.edgeTail];
+      int32_t until = (int32_t)(edge.start - now);
+      if (until > 0) {
+        if ((uint32_t)until < run) run = until;
+        break;
+      }
+      applyEdge(v, edge);
+      v.edgeTail = (v.edgeTail + 1) % SIDETONE_EDGE_QUEUE;
+    }
+
+    uint32_t p = v.phase;
+    if (!v.keyed && v.level == 0) {
+      // Silent: adds nothing; the next tone starts from a zero crossing
+      if (envelope) {
+        for (uint16_t j = 0; j < run; j++) envelope[i + j] = 0;
+      }
+      p = 0;
+    } else if (v.keyed && v.level == ramp) {
+      for (uint16_t j = 0; j < run; j++) {
+        mix[i + j] += sineAt(table, p);
+        p += v.increment;
+      }
+      if (envelope) {
+        for (uint16_t j = 0; j < run; j++) envelope[i + j] = SIDETONE_GAIN_ONE;
+      }
+      sounding = true;
+    } else {
+      // On a ramp: one gain step per sample
+      for (uint16_t j = 0; j < run; j++) {
+        uint16_t g = gain[v.level];
+        mix[i + j] += ((int32_t)sineAt(table, p) * g) >> 15;
+        if (envelope) envelope[i + j] = g;
+        p += v.increment;
+        if (v.keyed) {
+          if (v.level < ramp) v.level++;
+        } else if (v.level > 0) {
+          v.level--;
+        }
+      }
+      sounding = true;
+    }
+    v.phase = p;
+    now += run;
+    i += run;
+  }
+  return sounding;
+}
+
+bool SidetoneSynth::render(uint16_t* out, uint16_t count, uint16_t* envelope) {
+  int32_t mix[SIDETONE_BLOCK_SAMPLES];
+  bool sounding = false;
+  uint16_t done = 0;
+  while (done < count) {
+    uint16_t n = count - done;
+    if (n > SIDETONE_BLOCK_SAMPLES) n = SIDETONE_BLOCK_SAMPLES;
+
+    for (uint16_t j = 0; j < n; j++) mix[j] = 0;
+    bool blockSounding = false;
+    for (uint8_t v = 0; v < SIDETONE_VOICES; v++) {
+      uint16_t* voiceEnvelope = (envelope && v == 0) ? envelope + done : 0;
+      if (renderVoice(voices[v], mix, n, voiceEnvelope)) blockSounding = true;
+    }
+    clock += n;
+
+    if (blockSounding) {
+      // Sum with saturation, then down to the DAC's range
+      for (uint16_t j = 0; j < n; j++) {
+        int32_t x = mix[j];
+        if (x > 32767) x = 32767;
+        if (x < -32768) x = -32768;
+        out[done + j] = SIDETONE_DAC_MID + (x >> SIDETONE_SAMPLE_SHIFT);
+      }
+      sounding = true;
+    } else {
+      for (uint16_t j = 0; j < n; j++) out[done + j] = SIDETONE_DAC_MID;
+    }
+    done += n;
+  }
+  return sounding;
+}
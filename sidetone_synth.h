@@ -0,0 +1,134 @@
+#ifndef SIDETONE_SYNTH_H
+#define SIDETONE_SYNTH_H
+
+#include <stdint.h>
+
+// ============================================================================
+// SIDETONE SYNTHESIS
+// ============================================================================
+// Direct digital synthesis of the sidetone. A 32-bit phase accumulator steps
+// through a quarter-wave sine table once per output sample; the top eight
+// bits of the phase pick the table entry. Changing frequency only changes
+// the step, so the wave carries on from where it was with no restart and no
+// glitch. A tone always starts from a zero crossing.
+//
+// Tones are keyed with a raised-cosine rise and fall, read from a gain table
+// built once from the same sine table, so keying costs no trig. Key edges are
+// scheduled at a sample index and each ramp is centred on its edge: the tone
+// passes half amplitude exactly at the keyed time, and the area under a
+// shaped element's envelope equals its keyed length.
+//
+// SIDETONE_VOICES voices (the local sidetone, notes from the host, UI cues)
+// each have their own pitch, edges and level, and are summed with
+// saturation. A voice's level and the master volume are applied to its own
+// copy of the sine table, so a steady voice costs one table read and an add
+// per sample and no multiply; a silent voice costs nothing per sample.
+//
+// Samples are unsigned DAC codes centred on SIDETONE_DAC_MID. sidetone.cpp
+// streams them to the SAMD21 DAC by DMA; tools/sidetone_render writes them
+// to a WAV file.
+//
+// This file has no Arduino dependencies so host tools can build it as-is.
+// ============================================================================
+
+#define SIDETONE_SAMPLE_RATE 16000
+#define SIDETONE_DAC_BITS 10
+#define SIDETONE_DAC_MID (1 << (SIDETONE_DAC_BITS - 1))
+
+// Samples are rendered a block at a time: 1 ms at 16 kHz
+#define SIDETONE_BLOCK_SAMPLES 16
+
+// Rise and fall time limits, and the gain of a fully keyed tone (Q15)
+#define SIDETONE_RISE_MIN_MS 2
+#define SIDETONE_RISE_MAX_MS 8
+#define SIDETONE_MAX_RAMP_SAMPLES (SIDETONE_RISE_MAX_MS * SIDETONE_SAMPLE_RATE / 1000)
+#define SIDETONE_GAIN_ONE 32768
+
+// Key edges scheduled ahead of the renderer, per voice
+#define SIDETONE_EDGE_QUEUE 4
+
+// Voices mixed into the output
+#define SIDETONE_VOICES 4
+
+// Largest phase step below Nyquist; anything faster is played as silence
+#define SIDETONE_MAX_INCREMENT 0x7FFFFFFFUL
+
+// Phase step per sample for a tone of hz
+uint32_t sidetonePhaseIncrement(uint16_t hz);
+
+// Phase step for MIDI note 0-127 (A4 = note 69 = 440 Hz, as equal_temperament.h)
+// shifted by cents, from a table computed at compile time. Exact where the
+// whole-Hz table rounds (A0 is 27.5 Hz, not 27). 0 above Nyquist.
+uint32_t sidetoneNoteIncrement(uint8_t note, int8_t cents = 0);
+
+class SidetoneSynth {
+public:
+    SidetoneSynth();
+
+    // Rise and fall time, clamped to 2-8 ms. Rebuilds the gain table, so
+    // only call it while nothing is rendering.
+    void setRiseTime(uint8_t ms);
+    uint16_t rampSamples() const { return ramp; }
+
+    // Master level and the level of one voice, Q15 (SIDETONE_GAIN_ONE =
+    // full scale). Each rescales a spare copy of the affected sine tables
+    // and swaps it in, so both are safe to call while render() runs in an
+    // interrupt; the change is heard from the next block.
+    void setVolume(uint16_t gain);
+    void setVoiceLevel(uint8_t voice, uint16_t gain);
+
+    // Index of the next sample render() produces
+    uint32_t sampleClock() const { return clock; }
+
+    // Key edge on voice at sample: a tone with phase step increment from
+    // there on, or key up for 0. A tone that is already sounding changes
+    // pitch without a ramp. A voice's edges must be queued in time order;
+    // one whose ramp should already have started begins at the next sample.
+    // False if the voice's queue is full. Safe to call while render() runs
+    // in an interrupt.
+    bool keyStepAt(uint8_t voice, uint32_t sample, uint32_t increment);
+    bool keyAt(uint8_t voice, uint32_t sample, uint16_t hz) {
+        return keyStepAt(voice, sample, sidetonePhaseIncrement(hz));
+    }
+
+    // Key edge as soon as possible
+    void setFrequency(uint8_t voice, uint16_t hz);
+
+    // True while any voice is sounding, ramping down or has edges queued
+    bool active() const;
+
+    // Fill out with count DAC codes; false if they are all silence.
+    // envelope, if given, receives the keying gain (Q15) of voice 0.
+    bool render(uint16_t* out, uint16_t count, uint16_t* envelope = 0);
+
+private:
+    struct Edge {
+        uint32_t start;       // First sample of the ramp
+        uint32_t increment;   // 0 = key up
+    };
+
+    struct Voice {
+        Edge edges[SIDETONE_EDGE_QUEUE];
+        volatile uint8_t edgeHead;   // Written by keyStepAt
+        volatile uint8_t edgeTail;   // Written by render
+        uint32_t phase;
+        uint32_t increment;
+        uint16_t level;              // Position on the ramp, 0..ramp
+        bool keyed;
+        uint16_t gain;               // Voice level, Q15
+        int16_t sineTables[2][65];   // Quarter sine at gain x volume
+        const int16_t* volatile sine;   // The one render() reads
+    };
+
+    Voice voices[SIDETONE_VOICES];
+    volatile uint32_t clock;
+    uint16_t volume;
+    uint16_t ramp;
+    uint16_t gain[SIDETONE_MAX_RAMP_SAMPLES + 1];
+
+    void applyEdge(Voice& v, const Edge& edge);
+    void scaleSine(Voice& v);
+    bool renderVoice(Voice& v, int32_t* mix, uint16_t count, uint16_t* envelope);
+};
+
+#endif // SIDETONE_SYNTH_H
@@ -0,0 +1,304 @@
+// CW decoder accuracy bench (host build)
+//
+// Feeds straight-key traces through CwDecoder (cw_decoder.h), edge by edge
+// with tick() every millisecond in between as the adapter's loop does, and
+// reports the character error rate (edit distance to the sent text over its
+// length, runs of spaces counted as one) per trace and overall.
+//
+// With no arguments it runs the built-in corpus: synthetic traces modelled on
+// hand-sent straight-key timing, each an operator with their own speed, dah
+// weight and spacing habits plus per-element jitter, including speed drift,
+// sudden speed changes and Farnsworth spacing. The decoder always starts at
+// the adapter's default speed, so each trace also measures how fast it
+// locks on. A text memory sent by MorseElementGenerator, prosigns and all,
+// is decoded as well and has to come out exactly. The run fails if that
+// or the overall CER (above 2%) does not hold.
+//
+// Recorded traces can be given as files instead: one duration per line in
+// microseconds, positive with the key down and negative with it up, and a
+// line "# text: ..." with what was sent.
+//
+// Build and run from this directory:
+//   g++ -std=c++11 -O2 -I../.. cw_decoder_bench.cpp ../../cw_decoder.cpp ../../morse_table.cpp -o cw_decoder_bench
+//   ./cw_decoder_bench [trace ...]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cw_decoder.h"
+#include "morse_table.h"
+
+static const double MAX_CER = 0.02;
+static const uint32_t TICK_US = 1000;
+
+struct Trace {
+  std::string name;
+  std::string text;
+  std::vector<int32_t> durations;   // + key down, - key up (microseconds)
+  bool exact;                       // Any error fails the run
+
+  Trace() : exact(false) {}
+};
+
+// ============================================================================
+// Synthetic straight-key operators
+// ============================================================================
+
+struct Operator {
+  const char* name;
+  double wpmStart, wpmEnd;   // Character speed, ramped over the trace
+  double dahRatio;           // Dah length in dits
+  double elementGap;         // Gaps in dits
+  double letterGap;
+  double wordGap;
+  double jitter;             // Standard deviation, fraction of each length
+  int jumpEvery;             // Change speed every this many words (0: never)
+  double jumpWpm;            // Alternate speed for the jumps
+};
+
+static uint32_t seed = 12345;
+
+static double uniform() {
+  seed = seed * 1103515245u + 12345u;
+  return ((seed >> 8) + 0.5) / 16777216.0;
+}
+
+static double gaussian() {
+  return sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+static int32_t sample(double dits, double ditUs, double jitter) {
+  double us = dits * ditUs * (1.0 + jitter * gaussian());
+  if (us < 0.2 * ditUs) us = 0.2 * ditUs;
+  return (int32_t)us;
+}
+
+static const char* const texts[] = {
+  "CQ CQ CQ DE W1AW W1AW K",
+  "R R TNX FER CALL UR RST 599 5NN QTH NEWINGTON CT NAME IS HIRAM HW? AR",
+  "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 1234567890",
+  "WX HR IS CLOUDY ES 12 C, RIG IS A KX3 AT 5W INTO A DIPOLE/40M. BT",
+  "FB OM TNX FER QSO 73 ES GL SK",
+  "PACK MY BOX WITH FIVE DOZEN LIQUOR JUGS",
+  "QRL? QRZ? PSE QSY UP 2 KHZ = AGN PSE",
+  "HOW VEXINGLY QUICK DAFT ZEBRAS JUMP",
+};
+
+static Trace synthesize(const Operator& op, const char* text) {
+  Trace t;
+  t.name = op.name;
+  t.text = text;
+  size_t len = strlen(text);
+  int word = 0;
+  for (size_t i = 0; i < len; i++) {
+    double progress = (double)i / len;
+    double wpm = op.wpmStart + (op.wpmEnd - op.wpmStart) * progress;
+    if (op.jumpEvery && (word / op.jumpEvery) % 2) wpm = op.jumpWpm;
+    double ditUs = 1200000.0 / wpm;
+
+    if (text[i] == ' ') {
+      word++;
+      continue;
+    }
+    uint8_t code = morseCode(text[i]);
+    if (!code) continue;
+
+    if (!t.durations.empty()) {
+      bool space = text[i - 1] == ' ';
+      t.durations.push_back(-sample(space ? op.wordGap : op.letterGap, ditUs, op.jitter));
+    }
+    int top = 7;
+    while (!(code & (1 << top))) top--;
+    for (int b = top - 1; b >= 0; b--) {
+      t.durations.push_back(sample((code >> b) & 1 ? op.dahRatio : 1.0, ditUs, op.jitter));
+      if (b) t.durations.push_back(-sample(op.elementGap, ditUs, op.jitter));
+    }
+  }
+  return t;
+}
+
+// ============================================================================
+// Text memories
+// ============================================================================
+
+// Sent the way the adapter sends a text memory, with exact timing. Prosigns
+// decode to the punctuation with the same pattern (SK has none), and a
+// character straight after one has to come out on its own.
+static const char* const memoryText = "CQ DE W1AW <AR>K QRL? <BT>QRZ 73 <SK>E TNX <KN>";
+static const char* const memoryDecoded = "CQ DE W1AW +K QRL? =QRZ 73 *E TNX (";
+
+static const char* memoryCursor;
+static char readMemoryText(void*) {
+  return *memoryCursor ? *memoryCursor++ : 0;
+}
+
+static Trace textMemory(double wpm) {
+  Trace t;
+  char name[32];
+  snprintf(name, sizeof(name), "text memory %.0f wpm", wpm);
+  t.name = name;
+  t.text = memoryDecoded;
+  t.exact = true;
+  int32_t ditUs = (int32_t)(1200000.0 / wpm);
+  MorseElementGenerator generator;
+  memoryCursor = memoryText;
+  generator.begin(readMemoryText, 0);
+  uint8_t paddle, units;
+  bool down = true;
+  while (generator.next(paddle, units)) {
+    t.durations.push_back(down ? units * ditUs : -units * ditUs);
+    down = !down;
+  }
+  t.durations.pop_back();  // The closing key-up is the end of the trace
+  return t;
+}
+
+static std::vector<Trace> builtInCorpus() {
+  static const Operator operators[] = {
+    // name                      wpm      dah  elem letter word jitter jumps
+    {"clean 20 wpm",             20, 20,  3.0, 1.0, 3.0, 7.0, 0.05, 0, 0},
+    {"straight key 13 wpm",      13, 13,  3.0, 1.0, 3.0, 7.0, 0.12, 0, 0},
+    {"heavy dots 16 wpm",        16, 16,  3.2, 0.8, 3.4, 7.5, 0.12, 0, 0},
+    {"light dahs 18 wpm",        18, 18,  2.5, 1.2, 2.8, 6.5, 0.10, 0, 0},
+    {"long dahs 10 wpm",         10, 10,  4.0, 1.0, 3.5, 8.0, 0.12, 0, 0},
+    {"sloppy 15 wpm",            15, 15,  3.0, 1.0, 3.0, 7.0, 0.15, 0, 0},
+    {"Farnsworth 18/8 wpm",      18, 18,  3.0, 1.0, 7.5, 17.0, 0.08, 0, 0},
+    {"speeding up 10-25 wpm",    10, 25,  3.0, 1.0, 3.0, 7.0, 0.10, 0, 0},
+    {"slowing down 28-12 wpm",   28, 12,  3.0, 1.0, 3.0, 7.0, 0.10, 0, 0},
+    {"speed jumps 12/24 wpm",    12, 12,  3.0, 1.0, 3.0, 7.0, 0.10, 8, 24},
+    {"fast 30 wpm",              30, 30,  3.0, 1.0, 3.0, 7.0, 0.08, 0, 0},
+    {"beginner 6 wpm",            6,  6,  3.0, 1.3, 4.0, 9.0, 0.15, 0, 0},
+  };
+  std::vector<Trace> corpus;
+  for (size_t o = 0; o < sizeof(operators) / sizeof(operators[0]); o++) {
+    std::string all;
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+      if (i) all += ' ';
+      all += texts[i];
+    }
+    corpus.push_back(synthesize(operators[o], all.c_str()));
+  }
+  corpus.push_back(textMemory(20));
+  return corpus;
+}
+
+// ============================================================================
+// Trace files
+// ============================================================================
+
+static bool loadTrace(const char* path, Trace& t) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+  t.name = path;
+  char line[1024];
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "# text:", 7) == 0) {
+      const char* s = line + 7;
+      while (*s == ' ') s++;
+      t.text = s;
+      while (!t.text.empty() && (t.text.back() == '\n' || t.text.back() == '\r')) t.text.pop_back();
+    } else if (line[0] != '#') {
+      char* end;
+      long d = strtol(line, &end, 10);
+      if (end != line && d) t.durations.push_back((int32_t)d);
+    }
+  }
+  fclose(f);
+  if (t.text.empty()) {
+    fprintf(stderr, "%s: no \"# text:\" line\n", path);
+    return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// Decoding and scoring
+// ============================================================================
+
+static std::string normalize(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    char c = s[i];
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    if (c == ' ' && (out.empty() || out.back() == ' ')) continue;
+    out += c;
+  }
+  while (!out.empty() && out.back() == ' ') out.pop_back();
+  return out;
+}
+
+static size_t editDistance(const std::string& a, const std::string& b) {
+  std::vector<size_t> row(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); j++) row[j] = j;
+  for (size_t i = 1; i <= a.size(); i++) {
+    size_t diagonal = row[0];
+    row[0] = i;
+    for (size_t j = 1; j <= b.size(); j++) {
+      size_t above = row[j];
+      size_t substitute = diagonal + (a[i - 1] == b[j - 1] ? 0 : 1);
+      row[j] = substitute < row[j - 1] + 1 ? substitute : row[j - 1] + 1;
+      if (above + 1 < row[j]) row[j] = above + 1;
+      diagonal = above;
+    }
+  }
+  return row[b.size()];
+}
+
+static std::string decode(const Trace& t) {
+  CwDecoder decoder;
+  std::string out;
+  uint32_t now = 1000000;   // Not at 0, like micros() after boot
+  uint32_t nextTick = now;
+
+  // Each duration starts with a key edge, and the key is let go after the
+  // last one; ticks run until a second after that
+  for (size_t i = 0; i <= t.durations.size(); i++) {
+    bool down = i < t.durations.size() && t.durations[i] > 0;
+    decoder.key(down, now);
+    uint32_t end = now + (i < t.durations.size() ? (uint32_t)abs(t.durations[i]) : 1000000);
+    for (; (int32_t)(nextTick - end) < 0; nextTick += TICK_US) {
+      decoder.tick(nextTick);
+      for (char c; (c = decoder.read());) out += c;
+    }
+    now = end;
+  }
+  return out;
+}
+
+int main(int argc, char** argv) {
+  std::vector<Trace> corpus;
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      Trace t;
+      if (!loadTrace(argv[i], t)) return 2;
+      corpus.push_back(t);
+    }
+  } else {
+    corpus = builtInCorpus();
+  }
+
+  size_t errors = 0, characters = 0;
+  bool exactOk = true;
+  for (size_t i = 0; i < corpus.size(); i++) {
+    std::string sent = normalize(corpus[i].text);
+    std::string got = normalize(decode(corpus[i]));
+    size_t e = editDistance(sent, got);
+    errors += e;
+    characters += sent.size();
+    printf("%-28s %5zu chars, %4zu errors, CER %5.2f%%\n", corpus[i].name.c_str(), sent.size(), e,
+           100.0 * e / sent.size());
+    if (e) printf("    sent: %s\n    got:  %s\n", sent.c_str(), got.c_str());
+    if (e && corpus[i].exact) exactOk = false;
+  }
+  double cer = characters ? (double)errors / characters : 0;
+  bool ok = cer <= MAX_CER && exactOk;
+  printf("overall: %zu chars, %zu errors, CER %.2f%% %s\n", characters, errors, 100.0 * cer, ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+// CW memory codec benchmark (host build)
+//
+// Encodes recordings with both slot formats from memory_codec.h, checks that
+// MEMORY_FORMAT_UNITS round-trips within half a residual step, and reports the
+// compression ratio against MEMORY_FORMAT_RAW16.
+//
+// Build and run from this directory:
+//   g++ -std=c++11 -O2 -I../.. memory_codec_bench.cpp ../../memory_codec.cpp -o memory_codec_bench
+//   ./memory_codec_bench                  # built-in sample recordings
+//   ./memory_codec_bench capture.log ...  # recordings from adapter serial logs
+//
+// A capture is the adapter's serial output while recording a memory: every
+// "Started recording" line begins a recording and each "REC[n]: ... dur=XXms"
+// line is one transition. The unit is taken from the "unit=" field when the
+// log has one, otherwise from --unit N (ms) or estimated from the key-downs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "memory_codec.h"
+
+struct Transition {
+  uint8_t paddle;
+  uint16_t durationMs;
+};
+
+struct Recording {
+  std::string name;
+  uint16_t unitMs;  // 0 = estimate
+  std::vector<Transition> transitions;
+};
+
+// Stream buffers; reader addresses are offsets into this arena, the way they
+// are NVM offsets on the adapter
+static const uint16_t BUFFER_SIZE = 16384;
+static uint8_t arena[2 * BUFFER_SIZE];
+
+uint8_t memoryStreamReadByte(uint32_t address) {
+  return arena[address];
+}
+
+// ============================================================================
+// Sample recordings
+// ============================================================================
+
+static const char* morseFor(char c) {
+  static const char* letters[] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---",
+    "-.-", ".-..", "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-",
+    "..-", "...-", ".--", "-..-", "-.--", "--.."
+  };
+  static const char* digits[] = {
+    "-----", ".----", "..---", "...--", "....-", ".....", "-....", "--...", "---..", "----."
+  };
+  if (c >= 'A' && c <= 'Z') return letters[c - 'A'];
+  if (c >= '0' && c <= '9') return digits[c - '0'];
+  if (c == '/') return "-..-.";
+  if (c == '?') return "..--..";
+  return "";
+}
+
+static uint32_t lcgState = 12345;
+static int jitter(int spreadMs) {
+  lcgState = lcgState * 1103515245u + 12345u;
+  if (spreadMs <= 0) return 0;
+  return (int)((lcgState >> 16) % (2 * spreadMs + 1)) - spreadMs;
+}
+
+// Keyed text: jitterPct = timing spread of a hand key, straight = all DIT paddle
+static Recording makeSample(const char* name, const char* text, uint16_t unitMs,
+                            int jitterPct, bool straight) {
+  Recording rec;
+  rec.name = name;
+  rec.unitMs = unitMs;
+  int spread = unitMs * jitterPct / 100;
+  for (const char* p = text; *p; p++) {
+    if (*p == ' ') {
+      // Word gap: extend the previous character gap to about 7 units
+      if (!rec.transitions.empty()) rec.transitions.back().durationMs += 4 * unitMs + jitter(spread * 4);
+      continue;
+    }
+    const char* code = morseFor(*p);
+    for (const char* e = code; *e; e++) {
+      uint8_t paddle = (*e == '-' && !straight) ? 1 : 0;
+      uint16_t on = (*e == '-' ? 3 : 1) * unitMs + jitter(spread) + jitter(1);
+      uint16_t off = (e[1] ? 1 : 3) * unitMs + jitter(spread * (e[1] ? 1 : 2)) + jitter(1);
+      rec.transitions.push_back({paddle, on});
+      rec.transitions.push_back({paddle, off});
+    }
+  }
+  return rec;
+}
+
+// ============================================================================
+// Serial log captures
+// ============================================================================
+
+static bool loadCapture(const char* path, uint16_t unitOverride, std::vector<Recording>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  char line[256];
+  Recording* current = nullptr;
+  while (fgets(line, sizeof(line), f)) {
+    if (strstr(line, "Started recording")) {
+      Recording rec;
+      rec.name = std::string(path) + "#" + std::to_string(out.size() + 1);
+      const char* unit = strstr(line, "unit=");
+      rec.unitMs = unitOverride ? unitOverride : (unit ? (uint16_t)atoi(unit + 5) : 0);
+      out.push_back(rec);
+      current = &out.back();
+      continue;
+    }
+    const char* rec = strstr(line, "REC[");
+    const char* dur = strstr(line, "dur=");
+    if (rec && dur && strstr(rec, "]: ")) {
+      if (!current) {
+        Recording r;
+        r.name = std::string(path) + "#" + std::to_string(out.size() + 1);
+        r.unitMs = unitOverride;
+        out.push_back(r);
+        current = &out.back();
+      }
+      uint8_t paddle = strstr(line, "paddle=DAH") ? 1 : 0;
+      current->transitions.push_back({paddle, (uint16_t)atoi(dur + 4)});
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Lower quartile of the key-downs: the dits of a paddle or straight-key fist
+static uint16_t estimateUnit(const std::vector<Transition>& transitions) {
+  std::vector<uint16_t> downs;
+  for (size_t i = 0; i < transitions.size(); i += 2) downs.push_back(transitions[i].durationMs);
+  if (downs.empty()) return 60;
+  std::sort(downs.begin(), downs.end());
+  uint16_t unit = downs[downs.size() / 4];
+  return unit ? unit : 1;
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+struct Result {
+  uint16_t count;
+  uint16_t rawBytes;
+  uint16_t unitsBytes;
+  uint16_t maxErrorMs;
+  uint16_t paddleErrors;
+  bool ok;
+};
+
+static Result run(const Recording& rec) {
+  Result result = {0, 0, 0, 0, 0, true};
+  uint16_t unit = rec.unitMs ? rec.unitMs : estimateUnit(rec.transitions);
+  uint8_t* raw = arena;
+  uint8_t* units = arena + BUFFER_SIZE;
+
+  MemoryStreamWriter rawWriter, unitsWriter;
+  rawWriter.begin(MEMORY_FORMAT_RAW16, unit, raw, BUFFER_SIZE);
+  unitsWriter.begin(MEMORY_FORMAT_UNITS, unit, units, BUFFER_SIZE);
+  for (size_t i = 0; i < rec.transitions.size(); i++) {
+    if (!rawWriter.append(rec.transitions[i].paddle, rec.transitions[i].durationMs) ||
+        !unitsWriter.append(rec.transitions[i].paddle, rec.transitions[i].durationMs)) {
+      break;
+    }
+  }
+  result.count = unitsWriter.transitionCount();
+  result.rawBytes = rawWriter.finish();
+  result.unitsBytes = unitsWriter.finish();
+
+  // Both streams decode back to the input: RAW16 exactly, UNITS within half a step
+  uint16_t step = memoryResidualStepMs(unitsWriter.unitMs());
+  MemoryStreamReader rawReader, unitsReader;
+  rawReader.begin(MEMORY_FORMAT_RAW16, unit, 0, result.count);
+  unitsReader.begin(MEMORY_FORMAT_UNITS, unitsWriter.unitMs(), BUFFER_SIZE, result.count);
+  uint8_t lastDownPaddle = 0;
+  for (uint16_t i = 0; i < result.count; i++) {
+    uint8_t rawPaddle, unitsPaddle;
+    uint16_t rawDuration, unitsDuration;
+    if (!rawReader.next(rawPaddle, rawDuration) || !unitsReader.next(unitsPaddle, unitsDuration)) {
+      result.ok = false;
+      break;
+    }
+    const Transition& t = rec.transitions[i];
+    if (i % 2 == 0) lastDownPaddle = t.paddle;
+    if (rawDuration != (t.durationMs & DURATION_MASK) || rawPaddle != t.paddle) result.ok = false;
+    uint16_t error = unitsDuration > t.durationMs ? unitsDuration - t.durationMs : t.durationMs - unitsDuration;
+    result.maxErrorMs = std::max(result.maxErrorMs, error);
+    if (error * 2 > step) result.ok = false;
+    if (unitsPaddle != lastDownPaddle) result.paddleErrors++;
+  }
+  if (result.paddleErrors) result.ok = false;
+  return result;
+}
+
+int main(int argc, char** argv) {
+  std::vector<Recording> recordings;
+  uint16_t unitOverride = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--unit") == 0 && i + 1 < argc) {
+      unitOverride = (uint16_t)atoi(argv[++i]);
+    } else if (!loadCapture(argv[i], unitOverride, recordings)) {
+      return 2;
+    }
+  }
+  if (recordings.empty()) {
+    const char* text = "CQ CQ CQ DE W1AW W1AW K  TNX FER CALL UR RST 599 599 NAME IS BOB QTH NEWINGTON CT HW?";
+    recordings.push_back(makeSample("iambic 20wpm", text, 60, 0, false));
+    recordings.push_back(makeSample("iambic 30wpm", text, 40, 0, false));
+    recordings.push_back(makeSample("bug/hand 20wpm 10%", text, 60, 10, false));
+    recordings.push_back(makeSample("straight key 15wpm 20%", text, 80, 20, true));
+  }
+
+  printf("%-28s %6s %6s %6s %6s %7s %s\n", "recording", "trans", "unit", "raw16", "units", "ratio", "max err");
+  unsigned long totalRaw = 0, totalUnits = 0;
+  bool ok = true;
+  for (size_t i = 0; i < recordings.size(); i++) {
+    const Recording& rec = recordings[i];
+    if (rec.transitions.empty()) continue;
+    Result r = run(rec);
+    uint16_t unit = rec.unitMs ? rec.unitMs : estimateUnit(rec.transitions);
+    printf("%-28s %6u %4ums %6u %6u %6.2fx %4ums%s\n", rec.name.c_str(), r.count, unit,
+           r.rawBytes, r.unitsBytes, (double)r.rawBytes / (r.unitsBytes ? r.unitsBytes : 1),
+           r.maxErrorMs, r.ok ? "" : "  ROUND-TRIP FAILED");
+    totalRaw += r.rawBytes;
+    totalUnits += r.unitsBytes;
+    ok = ok && r.ok;
+  }
+  if (totalUnits) {
+    printf("%-28s %6s %6s %6lu %6lu %6.2fx\n", "total", "", "", totalRaw, totalUnits,
+           (double)totalRaw / totalUnits);
+  }
+  return ok ? 0 : 1;
+}
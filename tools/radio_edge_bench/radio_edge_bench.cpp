@@ -0,0 +1,209 @@
+// Radio edge scheduling benchmark (host build)
+//
+// Runs RadioEdgeScheduler (radio_edge_scheduler.h) against a fake TC3: a
+// tick clock at RADIO_TIMER_TICKS_PER_US, micros() read from it, and a
+// one-shot compare that calls the same service-and-rearm handler as
+// TC3_Handler when the count reaches CC. Every applied edge is timed in
+// ticks against its deadline. The checks:
+//   - a keyer edge queued a lookahead ahead, then a straight-key edge due
+//     now: the straight key goes out at once and the keyer edge still lands
+//     on its deadline (a single pending slot would have written it 3 ms early)
+//   - an edge further out than the 16-bit compare range is armed in parts
+//     and still lands on time
+//   - a full queue sends only its earliest edge early, and counts it
+//   - cancelling a pin's pending edges (a PTT release taken back) leaves the
+//     other pins' edges on time
+//   - a random keyer on one pin and straight key on another, scheduled from
+//     a loop with jittery periods below the lookahead: no edge is late by a
+//     microsecond (one micros() step) or more, and none is early by
+//     RADIO_TIMER_MIN_US or more (imminent edges are written, not armed)
+//
+// Build and run from this directory:
+//   g++ -std=c++11 -O2 -I../.. radio_edge_bench.cpp ../../radio_edge_scheduler.cpp -o radio_edge_bench
+//   ./radio_edge_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+
+#include "radio_edge_scheduler.h"
+
+static const uint32_t LOOKAHEAD_US = 3000;   // RADIO_EDGE_LOOKAHEAD_US
+static const uint8_t KEYER_PIN = 2;
+static const uint8_t STRAIGHT_PIN = 3;
+
+// ============================================================================
+// Fake TC3
+// ============================================================================
+
+static uint64_t ticks;          // Free-running tick clock
+static bool timerEnabled;
+static uint64_t compareAt;      // Tick the one-shot compare fires at
+static RadioEdgeScheduler scheduler;
+
+static uint32_t micros() {
+  return (uint32_t)(ticks / RADIO_TIMER_TICKS_PER_US);
+}
+
+// Deadlines still owed on each pin, in the order they were queued
+struct Owed {
+  uint8_t pin;
+  uint32_t due;
+};
+static std::deque<Owed> owed;
+
+// Error of each applied edge in ticks (positive = late)
+static int64_t worstEarly, worstLate;
+static uint32_t applied;
+
+static void applyEdge(uint8_t pin, bool /*level*/) {
+  for (std::deque<Owed>::iterator it = owed.begin(); it != owed.end(); ++it) {
+    if (it->pin != pin) continue;
+    int64_t error = (int64_t)ticks - (int64_t)it->due * RADIO_TIMER_TICKS_PER_US;
+    if (-error > worstEarly) worstEarly = -error;
+    if (error > worstLate) worstLate = error;
+    owed.erase(it);
+    applied++;
+    return;
+  }
+  printf("edge on pin %u was never queued\n", pin);
+  exit(1);
+}
+
+// As serviceEdges() in radio_output.cpp
+static void serviceEdges() {
+  uint16_t compare = scheduler.service(micros(), applyEdge);
+  timerEnabled = compare != 0;
+  compareAt = ticks + compare;
+}
+
+// As radioEdgeWriteAt()
+static void writeAt(uint8_t pin, bool level, uint32_t when) {
+  owed.push_back(Owed{pin, when});
+  timerEnabled = false;
+  scheduler.add(pin, level, when, applyEdge);
+  serviceEdges();
+}
+
+// Run the clock to tick, taking the compare interrupts on the way
+static void runTo(uint64_t tick) {
+  while (timerEnabled && compareAt <= tick) {
+    ticks = compareAt;
+    timerEnabled = false;
+    serviceEdges();
+  }
+  ticks = tick;
+}
+
+static void reset() {
+  runTo(ticks + (uint64_t)RADIO_TIMER_MAX_US * 10 * RADIO_TIMER_TICKS_PER_US);
+  owed.clear();
+  worstEarly = worstLate = 0;
+  applied = 0;
+}
+
+static bool report(const char* name, uint32_t expected) {
+  bool ok = applied == expected && worstLate < RADIO_TIMER_TICKS_PER_US &&
+            worstEarly < RADIO_TIMER_MIN_US * RADIO_TIMER_TICKS_PER_US;
+  printf("%-14s %6u edges, worst early %2lld ticks, worst late %2lld ticks  %s\n",
+         name, applied, (long long)worstEarly, (long long)worstLate, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+// ============================================================================
+// Checks
+// ============================================================================
+
+static bool checkStraightKeyOverKeyer() {
+  reset();
+  uint32_t now = micros();
+  writeAt(KEYER_PIN, true, now + LOOKAHEAD_US);
+  runTo(ticks + 1000 * RADIO_TIMER_TICKS_PER_US);
+  writeAt(STRAIGHT_PIN, true, micros());
+  runTo(ticks + 5000 * RADIO_TIMER_TICKS_PER_US);
+  return report("straight+keyer", 2);
+}
+
+static bool checkLongWait() {
+  reset();
+  writeAt(KEYER_PIN, true, micros() + 3 * RADIO_TIMER_MAX_US + 1234);
+  runTo(ticks + 4 * RADIO_TIMER_MAX_US * RADIO_TIMER_TICKS_PER_US);
+  return report("long wait", 1);
+}
+
+static bool checkFullQueue() {
+  reset();
+  uint32_t earlyBefore = scheduler.earlyEdges();
+  uint32_t now = micros();
+  for (uint8_t i = 0; i <= RADIO_EDGE_QUEUE; i++) {
+    writeAt(KEYER_PIN, i & 1, now + 1000 + 100 * i);
+  }
+  // The first edge went out when the last was queued, ~1 ms early
+  bool earliestOut = scheduler.pending() == RADIO_EDGE_QUEUE &&
+                     scheduler.earlyEdges() == earlyBefore + 1;
+  int64_t expectedEarly = 1000 * RADIO_TIMER_TICKS_PER_US;
+  runTo(ticks + 5000 * RADIO_TIMER_TICKS_PER_US);
+  bool ok = earliestOut && applied == RADIO_EDGE_QUEUE + 1 &&
+            worstEarly == expectedEarly && worstLate < RADIO_TIMER_TICKS_PER_US;
+  printf("%-14s %6u edges, %u sent early by %lld ticks                %s\n",
+         "full queue", applied, scheduler.earlyEdges() - earlyBefore,
+         (long long)worstEarly, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool checkCancel() {
+  reset();
+  const uint8_t pttPin = 4;
+  uint32_t now = micros();
+  writeAt(pttPin, false, now + 2000);
+  writeAt(KEYER_PIN, true, now + 2500);
+  bool dropped = scheduler.cancel(pttPin) && !scheduler.cancel(pttPin);
+  owed.pop_front();
+  runTo(ticks + 5000 * RADIO_TIMER_TICKS_PER_US);
+  return report("cancel", 1) && dropped;
+}
+
+static bool checkRandomKeying() {
+  reset();
+  srand(1);
+  uint32_t earlyBefore = scheduler.earlyEdges();
+  uint32_t expected = 0;
+  uint32_t keyerNext = micros() + 1000;
+  bool keyerLevel = false;
+  bool straightLevel = false;
+
+  for (int iteration = 0; iteration < 200000; iteration++) {
+    // Loop period: mostly short, now and then a slow pass
+    uint32_t period = (rand() % 20 == 0) ? 500 + rand() % 2000 : 50 + rand() % 400;
+    runTo(ticks + (uint64_t)period * RADIO_TIMER_TICKS_PER_US + rand() % RADIO_TIMER_TICKS_PER_US);
+    uint32_t now = micros();
+
+    // Keyer: every edge due within the lookahead, elements of 20-120 ms
+    while ((int32_t)(keyerNext - (now + LOOKAHEAD_US)) <= 0) {
+      keyerLevel = !keyerLevel;
+      writeAt(KEYER_PIN, keyerLevel, keyerNext);
+      expected++;
+      keyerNext += 20000 + rand() % 100000;
+    }
+
+    // Straight key: written as it is read
+    if (rand() % 150 == 0) {
+      straightLevel = !straightLevel;
+      writeAt(STRAIGHT_PIN, straightLevel, now);
+      expected++;
+    }
+  }
+  runTo(ticks + 2 * LOOKAHEAD_US * RADIO_TIMER_TICKS_PER_US);
+  return report("random keying", expected) && scheduler.earlyEdges() == earlyBefore;
+}
+
+int main() {
+  bool ok = true;
+  ok &= checkStraightKeyOverKeyer();
+  ok &= checkLongWait();
+  ok &= checkFullQueue();
+  ok &= checkCancel();
+  ok &= checkRandomKeying();
+  printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+// Settings record log flash model bench (host build)
+//
+// Runs SettingsLog (settings_log.h) on a model of the SAMD21 flash it lives
+// in on the adapter: 256-byte rows that erase to 0xFF, 64-byte pages that
+// only program erased bytes, and the datasheet's worst-case erase and page
+// write times. The checks:
+//   - stall: no append costs more than one row erase and one page write,
+//     including appends that skip a slot left dirty by a torn write
+//   - wear: erases land evenly on every row of the log (max - min <= 1), one
+//     per SAMD21 row's worth of records, and nothing is programmed twice
+//     without an erase in between
+//   - recovery: power is cut at a random point of an append (mid page write
+//     or mid row erase, leaving part of it done) and the log is scanned as at
+//     boot. The newest record must be the one before the append or the one it
+//     was writing, never anything else, and the log must take and find the
+//     next record as usual. A corrupted newest record falls back to the one
+//     before it.
+//
+// Build and run from this directory:
+//   g++ -std=c++11 -O2 -I../.. settings_log_bench.cpp ../../settings_log.cpp ../../crc16.cpp -o settings_log_bench
+//   ./settings_log_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings_log.h"
+
+// SAMD21 NVM geometry and timing (datasheet maximums), as nvm_storage.h
+#define ROW_SIZE 256
+#define PAGE_SIZE 64
+#define LOG_ROWS 4
+#define LOG_SIZE (LOG_ROWS * ROW_SIZE)
+#define ROW_ERASE_US 6000
+#define PAGE_WRITE_US 2500
+#define ENDURANCE_CYCLES 25000UL
+
+// As settings_eeprom.cpp for NVM_WRITE_SIZE 64: one record per page
+#define SLOT_SIZE PAGE_SIZE
+#define SLOT_COUNT (LOG_SIZE / SLOT_SIZE)
+#define SLOTS_PER_BLOCK (ROW_SIZE / SLOT_SIZE)
+
+// ============================================================================
+// Flash Model
+// ============================================================================
+
+static uint8_t flash[LOG_SIZE];
+static uint32_t rowErases[LOG_ROWS];
+static uint32_t busyUs;              // Time spent in erase/write since last cleared
+static uint32_t programmedOver;      // Page writes to bytes that were not erased
+
+// Power cut: after this many more erase/write operations, tear the next one
+static int32_t opsUntilPowerLoss = -1;
+struct PowerLoss {};
+
+static bool powerFailsNow() {
+  if (opsUntilPowerLoss < 0) return false;
+  if (opsUntilPowerLoss-- > 0) return false;
+  opsUntilPowerLoss = -1;
+  return true;
+}
+
+static void flashRead(uint32_t offset, void* dst, uint16_t len) {
+  memcpy(dst, flash + offset, len);
+}
+
+static void flashEraseBlock(uint32_t offset) {
+  uint8_t* row = flash + offset - offset % ROW_SIZE;
+  if (powerFailsNow()) {
+    // Part of the row erased, the rest as it was
+    for (int i = 0; i < ROW_SIZE; i++) {
+      if (rand() % 2) row[i] = 0xFF;
+    }
+    throw PowerLoss();
+  }
+  memset(row, 0xFF, ROW_SIZE);
+  rowErases[offset / ROW_SIZE]++;
+  busyUs += ROW_ERASE_US;
+}
+
+// NOR programming clears bits; the padding of a short write stays erased
+static void flashWrite(uint32_t offset, const void* src, uint16_t len) {
+  const uint8_t* bytes = (const uint8_t*)src;
+  if (offset % PAGE_SIZE != 0) {
+    printf("unaligned write at %u\n", offset);
+    exit(1);
+  }
+  for (uint16_t page = 0; page < len; page += PAGE_SIZE) {
+    uint16_t count = (len - page < PAGE_SIZE) ? len - page : PAGE_SIZE;
+    uint8_t* dst = flash + offset + page;
+    for (int i = 0; i < PAGE_SIZE; i++) {
+      if (dst[i] != 0xFF) {
+        programmedOver++;
+        break;
+      }
+    }
+    if (powerFailsNow()) {
+      // A prefix of the page programmed and the byte after it half done
+      int done = rand() % count;
+      for (int i = 0; i < done; i++) dst[i] &= bytes[page + i];
+      dst[done] &= bytes[page + done] | (uint8_t)rand();
+      throw PowerLoss();
+    }
+    for (int i = 0; i < count; i++) dst[i] &= bytes[page + i];
+    busyUs += PAGE_WRITE_US;
+  }
+}
+
+static bool flashIsErased(uint32_t offset, uint16_t len) {
+  for (uint16_t i = 0; i < len; i++) {
+    if (flash[offset + i] != 0xFF) return false;
+  }
+  return true;
+}
+
+static const SettingsLogStorage storage = {
+  flashRead, flashEraseBlock, flashWrite, flashIsErased,
+  0, SLOT_SIZE, SLOT_COUNT, SLOTS_PER_BLOCK, true,
+};
+
+static void blankFlash() {
+  memset(flash, 0xFF, sizeof(flash));
+  memset(rowErases, 0, sizeof(rowErases));
+  programmedOver = 0;
+}
+
+// ============================================================================
+// Payloads
+// ============================================================================
+
+// A settings snapshot standing in for SettingsCache, numbered by commit
+struct Payload {
+  uint32_t commit;
+  uint8_t filler[16];
+};
+
+static_assert(sizeof(Payload) <= SETTINGS_PAYLOAD_MAX, "Payload too large");
+
+static Payload payloadFor(uint32_t commit) {
+  Payload payload;
+  payload.commit = commit;
+  for (unsigned i = 0; i < sizeof(payload.filler); i++) payload.filler[i] = (uint8_t)(commit * 31 + i);
+  return payload;
+}
+
+// The commit the newest record holds after a fresh boot, or -1 if it is
+// missing or not a payload this bench wrote
+static int64_t bootCommit() {
+  SettingsLog log(storage);
+  SettingsRecord record;
+  if (!log.scan(record) || record.length != sizeof(Payload)) return -1;
+  Payload payload;
+  memcpy(&payload, record.payload, sizeof(payload));
+  Payload expected = payloadFor(payload.commit);
+  if (memcmp(&payload, &expected, sizeof(payload)) != 0) return -1;
+  return payload.commit;
+}
+
+static bool appendCommit(SettingsLog& log, uint32_t commit, uint32_t& worstUs) {
+  Payload payload = payloadFor(commit);
+  busyUs = 0;
+  bool ok = log.append(&payload, sizeof(payload));
+  if (busyUs > worstUs) worstUs = busyUs;
+  return ok;
+}
+
+// ============================================================================
+// Checks
+// ============================================================================
+
+static const uint32_t STALL_BUDGET_US = ROW_ERASE_US + PAGE_WRITE_US;
+
+static bool checkStallAndWear() {
+  const uint32_t commits = 100000;
+  blankFlash();
+  SettingsLog log(storage);
+  SettingsRecord record;
+  log.scan(record);
+
+  uint32_t worstUs = 0;
+  uint64_t totalUs = 0;
+  for (uint32_t commit = 1; commit <= commits; commit++) {
+    if (!appendCommit(log, commit, worstUs)) {
+      printf("stall/wear: append %u failed\n", commit);
+      return false;
+    }
+    totalUs += busyUs;
+  }
+
+  uint32_t most = 0, least = 0xFFFFFFFF, erases = 0;
+  for (int row = 0; row < LOG_ROWS; row++) {
+    if (rowErases[row] > most) most = rowErases[row];
+    if (rowErases[row] < least) least = rowErases[row];
+    erases += rowErases[row];
+  }
+  bool stallOk = worstUs <= STALL_BUDGET_US;
+  bool wearOk = most - least <= 1 && erases == (commits + SLOTS_PER_BLOCK - 1) / SLOTS_PER_BLOCK &&
+                programmedOver == 0 && bootCommit() == commits;
+  printf("stall: worst %.1f ms per commit (budget %.1f ms), mean %.2f ms  %s\n",
+         worstUs / 1000.0, STALL_BUDGET_US / 1000.0, totalUs / 1000.0 / commits,
+         stallOk ? "ok" : "FAIL");
+  printf("wear: %u commits, row erases %u-%u (%.2f per commit), rows reach %lu cycles after about %lu commits  %s\n",
+         commits, least, most, (double)erases / commits,
+         ENDURANCE_CYCLES, ENDURANCE_CYCLES * SLOT_COUNT, wearOk ? "ok" : "FAIL");
+  return stallOk && wearOk;
+}
+
+static bool checkPowerLoss() {
+  const int trials = 20000;
+  blankFlash();
+  srand(1);
+  uint32_t commit = 0;
+  uint32_t worstUs = 0;
+  int keptOld = 0, landedNew = 0, bad = 0;
+
+  {
+    SettingsLog log(storage);
+    SettingsRecord record;
+    log.scan(record);
+    for (int i = 0; i < 7; i++) appendCommit(log, ++commit, worstUs);
+  }
+
+  for (int trial = 0; trial < trials; trial++) {
+    // Boot, and lose power during the next append (an erase and/or a write)
+    {
+      SettingsLog log(storage);
+      SettingsRecord record;
+      log.scan(record);
+      opsUntilPowerLoss = rand() % 2;
+      try {
+        appendCommit(log, commit + 1, worstUs);
+      } catch (PowerLoss&) {
+      }
+      opsUntilPowerLoss = -1;
+    }
+
+    int64_t found = bootCommit();
+    if (found == commit) {
+      keptOld++;
+    } else if (found == commit + 1) {
+      landedNew++;
+      commit++;
+    } else {
+      if (bad++ < 5) printf("trial %d: boot found %lld after writing %u\n", trial, (long long)found, commit + 1);
+    }
+
+    // The log carries on as usual after the reset
+    SettingsLog log(storage);
+    SettingsRecord record;
+    log.scan(record);
+    if (!appendCommit(log, ++commit, worstUs) || bootCommit() != commit) {
+      if (bad++ < 5) printf("trial %d: append after the reset lost commit %u\n", trial, commit);
+    }
+  }
+
+  bool ok = bad == 0 && programmedOver == 0 && worstUs <= STALL_BUDGET_US;
+  printf("power loss: %d cuts, %d kept the old record, %d the new one, %d bad, "
+         "%u writes over programmed flash, worst %.1f ms  %s\n",
+         trials, keptOld, landedNew, bad, programmedOver, worstUs / 1000.0, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool checkCorruptNewest() {
+  blankFlash();
+  uint32_t worstUs = 0;
+  SettingsLog log(storage);
+  SettingsRecord record;
+  log.scan(record);
+  for (uint32_t commit = 1; commit <= 10; commit++) appendCommit(log, commit, worstUs);
+
+  // One bit of the newest record's payload flips
+  flash[log.latestSlot() * SLOT_SIZE + 12] ^= 0x10;
+  bool ok = bootCommit() == 9;
+  printf("corrupt newest: boot falls back to commit %lld  %s\n", (long long)bootCommit(), ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  bool ok = true;
+  ok &= checkStallAndWear();
+  ok &= checkPowerLoss();
+  ok &= checkCorruptNewest();
+  printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+  return ok ? 0 : 1;
+}
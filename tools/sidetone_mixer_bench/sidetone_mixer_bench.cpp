@@ -0,0 +1,185 @@
+// DAC sidetone mixer benchmark (host build)
+//
+// Checks the voice mixer in sidetone_synth.h and times it. The checks:
+//   - a mix of voices is the sum of each voice rendered alone, to within the
+//     rounding of the 10-bit output (one LSB per voice)
+//   - a voice's level scales its peak
+//   - a sum beyond full scale saturates at the DAC rails instead of wrapping
+// The timing renders one second with 0-4 voices steady, and with the same
+// voices keyed on and off once per rise time (every sample on a ramp), and
+// reports the cost per output sample. The budget is relative, since a
+// host is not an M0+: 4 voices may cost at most SIDETONE_VOICES times one
+// voice, i.e. the mix pass and the silent voices must not add to it.
+//
+// Build and run from this directory:
+//   g++ -std=c++11 -O2 -I../.. sidetone_mixer_bench.cpp ../../sidetone_synth.cpp -o sidetone_mixer_bench
+//   ./sidetone_mixer_bench
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "sidetone_synth.h"
+
+static const uint16_t VOICE_HZ[SIDETONE_VOICES] = {600, 880, 1245, 415};
+static const uint32_t SECOND = SIDETONE_SAMPLE_RATE;
+
+// Render length samples a block at a time, as the DMA interrupt does
+static std::vector<uint16_t> renderBlocks(SidetoneSynth& synth, uint32_t length) {
+  std::vector<uint16_t> out(length);
+  for (uint32_t at = 0; at < length; at += SIDETONE_BLOCK_SAMPLES) {
+    uint16_t count = (length - at < SIDETONE_BLOCK_SAMPLES) ? length - at : SIDETONE_BLOCK_SAMPLES;
+    synth.render(&out[at], count);
+  }
+  return out;
+}
+
+// A synth with the given voices (bit n = voice n) keyed on from sample 0
+static void keyVoices(SidetoneSynth& synth, uint8_t voices, uint16_t level) {
+  for (uint8_t v = 0; v < SIDETONE_VOICES; v++) {
+    synth.setVoiceLevel(v, level);
+    if (voices & (1 << v)) synth.keyAt(v, synth.rampSamples(), VOICE_HZ[v]);
+  }
+}
+
+static int deviation(uint16_t code) {
+  return (int)code - SIDETONE_DAC_MID;
+}
+
+// ============================================================================
+// Checks
+// ============================================================================
+
+static bool checkSum() {
+  const uint16_t level = SIDETONE_GAIN_ONE / SIDETONE_VOICES;  // Never saturates
+  const uint8_t all = (1 << SIDETONE_VOICES) - 1;
+  SidetoneSynth mixed;
+  keyVoices(mixed, all, level);
+  std::vector<uint16_t> mix = renderBlocks(mixed, SECOND / 4);
+
+  std::vector<int> sum(mix.size(), 0);
+  for (uint8_t v = 0; v < SIDETONE_VOICES; v++) {
+    SidetoneSynth alone;
+    keyVoices(alone, 1 << v, level);
+    std::vector<uint16_t> one = renderBlocks(alone, mix.size());
+    for (size_t i = 0; i < one.size(); i++) sum[i] += deviation(one[i]);
+  }
+
+  int worst = 0;
+  for (size_t i = 0; i < mix.size(); i++) {
+    int error = abs(deviation(mix[i]) - sum[i]);
+    worst = error > worst ? error : worst;
+  }
+  printf("sum: %d voices at 1/%d level, worst error %d LSB\n", SIDETONE_VOICES, SIDETONE_VOICES, worst);
+  return worst <= SIDETONE_VOICES;
+}
+
+static bool checkLevels() {
+  static const uint16_t levels[] = {32768, 23198, 16423, 5827, 1464};
+  bool ok = true;
+  for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+    SidetoneSynth synth;
+    keyVoices(synth, 1 << 1, levels[l]);
+    std::vector<uint16_t> out = renderBlocks(synth, SECOND / 4);
+    int peak = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+      int d = abs(deviation(out[i]));
+      peak = d > peak ? d : peak;
+    }
+    double expected = (SIDETONE_DAC_MID - 1) * (double)levels[l] / SIDETONE_GAIN_ONE;
+    printf("level: gain %5u, peak %3d LSB (expected %.1f)\n", levels[l], peak, expected);
+    if (fabs(peak - expected) > 2) ok = false;
+  }
+  return ok;
+}
+
+static bool checkSaturation() {
+  // Every voice at full level on the same pitch: SIDETONE_VOICES times full
+  // scale, which must clip to the rails where one voice times that would not
+  // fit (a wrapped sum would land on the other side instead)
+  SidetoneSynth synth;
+  for (uint8_t v = 0; v < SIDETONE_VOICES; v++) synth.keyAt(v, synth.rampSamples(), 600);
+  std::vector<uint16_t> out = renderBlocks(synth, SECOND / 4);
+
+  SidetoneSynth alone;
+  alone.keyAt(0, alone.rampSamples(), 600);
+  std::vector<uint16_t> one = renderBlocks(alone, out.size());
+
+  const int top = (1 << SIDETONE_DAC_BITS) - 1;
+  uint32_t clipped = 0;
+  int worst = 0;
+  for (size_t i = 0; i < out.size(); i++) {
+    int expected = SIDETONE_DAC_MID + SIDETONE_VOICES * deviation(one[i]);
+    if (expected > top) expected = top;
+    if (expected < 0) expected = 0;
+    int error = abs((int)out[i] - expected);
+    worst = error > worst ? error : worst;
+    if (out[i] == 0 || out[i] == top) clipped++;
+  }
+  printf("saturation: %u of %zu samples at the rails, worst error %d LSB\n",
+         clipped, out.size(), worst);
+  return clipped > 0 && worst <= SIDETONE_VOICES;
+}
+
+// ============================================================================
+// Timing
+// ============================================================================
+
+// Best of several runs, in ns per output sample
+static double timeRender(uint8_t voices, bool keying) {
+  const uint32_t length = SECOND;
+  // Toggling once per ramp keeps the voices from ever leaving their ramps
+  const uint32_t toggle = SIDETONE_RISE_MIN_MS * SIDETONE_SAMPLE_RATE / 1000;
+  std::vector<uint16_t> out(SIDETONE_BLOCK_SAMPLES);
+  double best = 1e30;
+  volatile uint32_t sink = 0;
+  for (int run = 0; run < 5; run++) {
+    SidetoneSynth synth;
+    synth.setRiseTime(SIDETONE_RISE_MIN_MS);
+    keyVoices(synth, voices, SIDETONE_GAIN_ONE / SIDETONE_VOICES);
+    uint32_t nextKey = toggle;
+    bool down = true;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t at = 0; at < length; at += SIDETONE_BLOCK_SAMPLES) {
+      if (keying && at >= nextKey) {
+        down = !down;
+        for (uint8_t v = 0; v < SIDETONE_VOICES; v++) {
+          if (voices & (1 << v)) synth.keyAt(v, synth.sampleClock(), down ? VOICE_HZ[v] : 0);
+        }
+        nextKey += toggle;
+      }
+      synth.render(&out[0], SIDETONE_BLOCK_SAMPLES);
+      sink += out[0];
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (ns / length < best) best = ns / length;
+  }
+  return best;
+}
+
+int main() {
+  bool ok = checkSum();
+  ok = checkLevels() && ok;
+  ok = checkSaturation() && ok;
+
+  printf("\n%8s %12s %12s\n", "voices", "steady ns", "keyed ns");
+  double steady[SIDETONE_VOICES + 1];
+  for (uint8_t n = 0; n <= SIDETONE_VOICES; n++) {
+    steady[n] = timeRender((1 << n) - 1, false);
+    double keyed = n ? timeRender((1 << n) - 1, true) : steady[0];
+    printf("%8u %12.2f %12.2f\n", n, steady[n], keyed);
+  }
+  double ratio = steady[SIDETONE_VOICES] / steady[1];
+  printf("%d voices cost %.2fx one voice (budget %dx); sample period %.1f us\n",
+         SIDETONE_VOICES, ratio, SIDETONE_VOICES, 1e6 / SIDETONE_SAMPLE_RATE);
+  if (ratio > SIDETONE_VOICES) {
+    printf("over budget\n");
+    ok = false;
+  }
+
+  printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+  return ok ? 0 : 1;
+}
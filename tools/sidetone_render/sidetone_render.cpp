@@ -0,0 +1,361 @@
+// DAC sidetone renderer (host build)
+//
+// Runs the sidetone synthesizer from sidetone_synth.h the way the adapter
+// does - key edges queued a fixed latency ahead, samples rendered one
+// SIDETONE_BLOCK_SAMPLES block at a time - and writes the result to a 16-bit
+// mono WAV file for listening or inspection. The render is also checked:
+//   - every steady tone is measured for pitch
+//   - a pitch change inside a tone never steps further than the wave itself
+//     can move in one sample (no phase glitch)
+//   - each rise and fall follows the raised cosine, passes half amplitude on
+//     the keyed edge, and the envelope area of each element equals its keyed
+//     length (shaping moves no energy in time)
+//   - samples stay inside the envelope, and silence sits at mid scale
+//   - rendering in odd-sized chunks gives the same samples
+//   - a lower volume (applied in the sine table) scales every sample of the
+//     full-volume render, to within the rounding of the 10-bit output
+//   - the compile-time note table (with cents offsets) is within a fiftieth
+//     of a cent of equal temperament
+//
+// Build and run from this directory:
+//   g++ -std=c++11 -O2 -I../.. sidetone_render.cpp ../../sidetone_synth.cpp ../../morse_table.cpp -o sidetone_render
+//   ./sidetone_render                          # writes sidetone.wav
+//   ./sidetone_render out.wav --wpm 25 --freq 700 --rise 8 --text "CQ TEST"
+//   ./sidetone_render quiet.wav --volume 4125   # Q15 gain, as PolyBuzzer sets
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "sidetone_synth.h"
+#include "morse_table.h"
+
+static const double PI = 3.141592653589793;
+
+struct Edge {
+  uint32_t sample;  // Keyed time
+  uint16_t hz;      // 0 = key up
+};
+
+struct Render {
+  std::vector<uint16_t> samples;
+  std::vector<uint16_t> envelope;
+};
+
+static uint32_t msToSamples(double ms) {
+  return (uint32_t)(ms * SIDETONE_SAMPLE_RATE / 1000 + 0.5);
+}
+
+// ============================================================================
+// Test program
+// ============================================================================
+
+static const char* textSource;
+static char readText(void*) {
+  return *textSource ? *textSource++ : 0;
+}
+
+static std::vector<Edge> buildProgram(const char* text, uint16_t hz, uint16_t wpm) {
+  std::vector<Edge> edges;
+  double t = 20;  // ms
+
+  // Steady tones across the sidetone range
+  static const uint16_t steady[] = {300, 440, 600, 800, 1000, 1500};
+  for (size_t i = 0; i < sizeof(steady) / sizeof(steady[0]); i++) {
+    edges.push_back({msToSamples(t), steady[i]});
+    t += 500;
+    edges.push_back({msToSamples(t), 0});
+    t += 100;
+  }
+
+  // A tone that changes pitch without stopping, like a MIDI note
+  // overlaying the keyer sidetone
+  static const uint16_t glide[] = {500, 523, 587, 659, 880, 440};
+  for (size_t i = 0; i < sizeof(glide) / sizeof(glide[0]); i++) {
+    edges.push_back({msToSamples(t), glide[i]});
+    t += 150;
+  }
+  edges.push_back({msToSamples(t), 0});
+  t += 300;
+
+  // Keyed text; the unit is not a whole number of samples at most speeds
+  double unitMs = 1200.0 / wpm;
+  MorseElementGenerator generator;
+  textSource = text;
+  generator.begin(readText, 0);
+  uint8_t paddle, units;
+  bool down = true;
+  while (generator.next(paddle, units)) {
+    edges.push_back({msToSamples(t), (uint16_t)(down ? hz : 0)});
+    t += units * unitMs;
+    down = !down;
+  }
+  edges.push_back({msToSamples(t + 200), 0});
+  return edges;
+}
+
+// Feed edges a fixed latency ahead of the renderer, as the adapter does,
+// and render in chunks of the given size
+static Render renderProgram(const std::vector<Edge>& edges, uint8_t riseMs, uint16_t chunk,
+                            uint16_t gain = SIDETONE_GAIN_ONE) {
+  SidetoneSynth synth;
+  synth.setRiseTime(riseMs);
+  synth.setVolume(gain);
+  uint32_t lookahead = 3 * SIDETONE_BLOCK_SAMPLES + synth.rampSamples() / 2;
+  uint32_t length = edges.back().sample + synth.rampSamples();
+
+  Render r;
+  r.samples.resize(length);
+  r.envelope.resize(length);
+  size_t next = 0;
+  for (uint32_t at = 0; at < length; at += chunk) {
+    while (next < edges.size() && edges[next].sample <= at + lookahead) {
+      if (!synth.keyAt(0, edges[next].sample, edges[next].hz)) break;
+      next++;
+    }
+    uint16_t count = (length - at < chunk) ? length - at : chunk;
+    synth.render(&r.samples[at], count, &r.envelope[at]);
+  }
+  return r;
+}
+
+// ============================================================================
+// Checks
+// ============================================================================
+
+// Fractional sample where the envelope crosses half gain between from and to
+static double halfCrossing(const Render& r, uint32_t from, uint32_t to) {
+  const double half = SIDETONE_GAIN_ONE / 2.0;
+  for (uint32_t i = from + 1; i < to && i < r.envelope.size(); i++) {
+    double a = r.envelope[i - 1], b = r.envelope[i];
+    if ((a < half) != (b < half)) return (i - 1) + (half - a) / (b - a);
+  }
+  return -1;
+}
+
+static bool checkRender(const Render& r, const std::vector<Edge>& edges, uint16_t ramp) {
+  bool ok = true;
+  const double amplitude = SIDETONE_DAC_MID - 1;
+
+  // Samples stay inside the envelope; silence sits at mid scale
+  for (size_t i = 0; i < r.samples.size(); i++) {
+    double bound = (amplitude + 1) * r.envelope[i] / SIDETONE_GAIN_ONE + 1;
+    if (r.samples[i] >= (1 << SIDETONE_DAC_BITS) || fabs((double)r.samples[i] - SIDETONE_DAC_MID) > bound) {
+      printf("sample %zu outside the envelope: %u (gain %u)\n", i, r.samples[i], r.envelope[i]);
+      return false;
+    }
+  }
+
+  // Rise shape against the raised cosine (the fall is the same table)
+  double shapeError = 0;
+  for (size_t e = 0; e < edges.size(); e++) {
+    bool fromSilence = edges[e].hz && (e == 0 || edges[e - 1].hz == 0);
+    if (!fromSilence) continue;
+    uint32_t start = edges[e].sample - ramp / 2;
+    for (uint16_t k = 0; k <= ramp; k++) {
+      double ideal = SIDETONE_GAIN_ONE * (1 - cos(PI * k / ramp)) / 2;
+      shapeError = fmax(shapeError, fabs(r.envelope[start + k] - ideal));
+    }
+  }
+  printf("envelope: %u sample raised cosine, max shape error %.4f%%\n", ramp,
+         100 * shapeError / SIDETONE_GAIN_ONE);
+  if (shapeError > SIDETONE_GAIN_ONE / 1000) ok = false;
+
+  // Each element: half gain on both edges and area equal to its length
+  double worstEdge = 0, worstArea = 0;
+  int elements = 0;
+  for (size_t e = 0; e + 1 < edges.size(); e++) {
+    if (!edges[e].hz || (e > 0 && edges[e - 1].hz)) continue;
+    size_t end = e + 1;
+    while (end < edges.size() && edges[end].hz) end++;
+    if (end == edges.size()) break;
+    uint32_t on = edges[e].sample, off = edges[end].sample;
+    if (off - on < ramp) continue;  // Never reaches full gain
+    double rise = halfCrossing(r, on - ramp / 2 - 1, on + ramp / 2 + 1);
+    double fall = halfCrossing(r, off - ramp / 2 - 1, off + ramp / 2 + 1);
+    double area = 0;
+    for (uint32_t i = on - ramp; i < off + ramp; i++) area += (double)r.envelope[i] / SIDETONE_GAIN_ONE;
+    worstEdge = fmax(worstEdge, fmax(fabs(rise - on), fabs(fall - off)));
+    worstArea = fmax(worstArea, fabs(area - (off - on)));
+    elements++;
+  }
+  printf("elements: %d, worst half-gain edge error %.2f samples, worst area error %.2f samples\n",
+         elements, worstEdge, worstArea);
+  if (worstEdge > 0.5 || worstArea > 1.0) ok = false;
+
+  // Pitch on each steady stretch, and no step larger than the wave's own
+  // slope wherever the tone changes pitch
+  printf("%8s %8s %10s %8s\n", "start", "hz", "measured", "max step");
+  for (size_t e = 0; e + 1 < edges.size(); e++) {
+    uint16_t hz = edges[e].hz;
+    if (!hz) continue;
+    uint16_t prevHz = (e > 0) ? edges[e - 1].hz : 0;
+    uint16_t fastest = hz > prevHz ? hz : prevHz;
+    // The wave's slope over one sample, plus one table step of phase
+    // truncation and a count of rounding
+    int limit = (int)ceil(amplitude * 2 * PI * ((double)fastest / SIDETONE_SAMPLE_RATE + 1.0 / 256)) + 1;
+    uint32_t first = edges[e].sample - ramp / 2;
+    uint32_t last = edges[e + 1].sample - ramp / 2;
+    int maxStep = 0;
+    long crossings = 0;
+    double firstCrossing = -1, lastCrossing = -1;
+    for (uint32_t i = first + 1; i < last; i++) {
+      int step = abs((int)r.samples[i] - (int)r.samples[i - 1]);
+      if (step > maxStep) maxStep = step;
+      if (r.envelope[i] != SIDETONE_GAIN_ONE || r.envelope[i - 1] != SIDETONE_GAIN_ONE) continue;
+      if (r.samples[i - 1] < SIDETONE_DAC_MID && r.samples[i] >= SIDETONE_DAC_MID) {
+        // Interpolated upward zero crossing
+        double a = (double)SIDETONE_DAC_MID - r.samples[i - 1];
+        double t = (i - 1) + a / (r.samples[i] - r.samples[i - 1]);
+        if (firstCrossing < 0) firstCrossing = t;
+        lastCrossing = t;
+        crossings++;
+      }
+    }
+    // Short keyed elements hold too few cycles to measure closely
+    bool measurable = crossings >= 20;
+    double measured = measurable
+        ? (crossings - 1) * (double)SIDETONE_SAMPLE_RATE / (lastCrossing - firstCrossing) : 0;
+    bool good = maxStep <= limit && (!measurable || fabs(measured - hz) <= 1.0);
+    if (!good || last - first >= (uint32_t)SIDETONE_SAMPLE_RATE / 8) {
+      printf("%7.3fs %8u %10.2f %8d%s\n", (double)first / SIDETONE_SAMPLE_RATE, hz, measured,
+             maxStep, good ? "" : "  FAILED");
+    }
+    ok = ok && good;
+  }
+  return ok;
+}
+
+// A quieter render is the full one scaled: the table is scaled once, then
+// each sample is rounded again on the way to the DAC
+static bool checkVolume(const Render& full, const Render& quiet, uint16_t gain) {
+  double worst = 0;
+  for (size_t i = 0; i < full.samples.size(); i++) {
+    double expected = ((double)full.samples[i] - SIDETONE_DAC_MID) * gain / SIDETONE_GAIN_ONE;
+    worst = fmax(worst, fabs((double)quiet.samples[i] - SIDETONE_DAC_MID - expected));
+  }
+  printf("volume: gain %u, worst error %.2f LSB\n", gain, worst);
+  return worst <= 2;
+}
+
+// Note table against 440 * 2^((note - 69) / 12), with and without cents
+static bool checkNoteTable() {
+  double worst = 0, worstWholeHz = 0;
+  for (int note = 0; note < 128; note++) {
+    for (int cents = (note ? -50 : 0); cents <= 50; cents += 10) {
+      double hz = 440.0 * pow(2.0, (note - 69 + cents / 100.0) / 12.0);
+      uint32_t step = sidetoneNoteIncrement(note, cents);
+      if (hz >= SIDETONE_SAMPLE_RATE / 2) {
+        if (step != 0) {
+          printf("note %d%+d cents is above Nyquist but has a step\n", note, cents);
+          return false;
+        }
+        continue;
+      }
+      double played = step * (double)SIDETONE_SAMPLE_RATE / 4294967296.0;
+      worst = fmax(worst, fabs(1200 * log2(played / hz)));
+      if (cents == 0 && hz >= 8) {
+        double wholeHz = floor(hz + 0.5);
+        worstWholeHz = fmax(worstWholeHz, fabs(1200 * log2(wholeHz / hz)));
+      }
+    }
+  }
+  printf("note table: worst error %.4f cents (whole Hz would be %.1f cents)\n", worst, worstWholeHz);
+  return worst < 0.02;
+}
+
+// ============================================================================
+// WAV output
+// ============================================================================
+
+static void put16(FILE* f, uint16_t v) {
+  fputc(v & 0xFF, f);
+  fputc(v >> 8, f);
+}
+
+static void put32(FILE* f, uint32_t v) {
+  put16(f, v & 0xFFFF);
+  put16(f, v >> 16);
+}
+
+static bool writeWav(const char* path, const std::vector<uint16_t>& samples) {
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return false;
+  }
+  uint32_t dataBytes = samples.size() * 2;
+  fwrite("RIFF", 1, 4, f);
+  put32(f, 36 + dataBytes);
+  fwrite("WAVEfmt ", 1, 8, f);
+  put32(f, 16);
+  put16(f, 1);                          // PCM
+  put16(f, 1);                          // Mono
+  put32(f, SIDETONE_SAMPLE_RATE);
+  put32(f, SIDETONE_SAMPLE_RATE * 2);
+  put16(f, 2);
+  put16(f, 16);
+  fwrite("data", 1, 4, f);
+  put32(f, dataBytes);
+  for (size_t i = 0; i < samples.size(); i++) {
+    // DAC code to signed 16-bit
+    put16(f, (uint16_t)(((int)samples[i] - SIDETONE_DAC_MID) << (16 - SIDETONE_DAC_BITS)));
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* path = "sidetone.wav";
+  const char* text = "CQ CQ DE W1AW K";
+  uint16_t hz = 600;
+  uint16_t wpm = 23;
+  uint8_t riseMs = 5;
+  uint16_t gain = SIDETONE_GAIN_ONE;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--freq") == 0 && i + 1 < argc) {
+      hz = (uint16_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--wpm") == 0 && i + 1 < argc) {
+      wpm = (uint16_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--rise") == 0 && i + 1 < argc) {
+      riseMs = (uint8_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--volume") == 0 && i + 1 < argc) {
+      gain = (uint16_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--text") == 0 && i + 1 < argc) {
+      text = argv[++i];
+    } else {
+      path = argv[i];
+    }
+  }
+  if (wpm < 5) wpm = 5;
+
+  std::vector<Edge> edges = buildProgram(text, hz, wpm);
+  Render render = renderProgram(edges, riseMs, SIDETONE_BLOCK_SAMPLES);
+  uint16_t ramp = msToSamples(riseMs < SIDETONE_RISE_MIN_MS ? SIDETONE_RISE_MIN_MS
+                              : riseMs > SIDETONE_RISE_MAX_MS ? SIDETONE_RISE_MAX_MS : riseMs);
+  bool ok = checkRender(render, edges, ramp);
+
+  // Edges land on their sample whatever the block boundaries
+  Render odd = renderProgram(edges, riseMs, 7);
+  if (odd.samples != render.samples) {
+    printf("rendering in 7-sample chunks changed the output\n");
+    ok = false;
+  }
+
+  // Volume steps 3 dB apart, from the quietest up
+  static const uint16_t volumeGains[] = {1464, 4125, 11627, 23198};
+  for (size_t v = 0; v < sizeof(volumeGains) / sizeof(volumeGains[0]); v++) {
+    Render quiet = renderProgram(edges, riseMs, SIDETONE_BLOCK_SAMPLES, volumeGains[v]);
+    ok = checkVolume(render, quiet, volumeGains[v]) && ok;
+  }
+
+  ok = checkNoteTable() && ok;
+
+  if (gain < SIDETONE_GAIN_ONE) render = renderProgram(edges, riseMs, SIDETONE_BLOCK_SAMPLES, gain);
+  if (!writeWav(path, render.samples)) return 2;
+  printf("%s: %.2fs at %u Hz%s\n", path, (double)render.samples.size() / SIDETONE_SAMPLE_RATE,
+         SIDETONE_SAMPLE_RATE, ok ? "" : "  CHECKS FAILED");
+  return ok ? 0 : 1;
+}
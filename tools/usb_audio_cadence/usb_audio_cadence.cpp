@@ -0,0 +1,204 @@
+// USB audio sidetone cadence simulator (host build)
+//
+// Runs the packet pacing from usb_audio_stream.h against a model of the
+// isochronous IN endpoint: the DMA interrupt comes every half block of the
+// adapter's clock (with interrupt latency jitter), renders a block on every
+// second one and refills the endpoint on each, and the host collects one
+// packet per USB frame. The checks:
+//   - with the adapter clock locked to the frames (crystalless boards),
+//     every frame carries one full packet and no block is dropped, at every
+//     frame phase, including frames inside 200 us of interrupt jitter
+//   - with a free-running clock off by up to 200 ppm, the stream slips one
+//     block at a time, as often as the error adds up to a block, in the
+//     direction of the error, and never leaves two frames in a row empty
+//   - each packet holds exactly the block it was queued from, in order
+//   - blocks skipped before the host starts streaming are not drops, and
+//     the stream starts with at most one stale packet
+//
+// Build and run from this directory:
+//   g++ -std=c++11 -O2 -I../.. usb_audio_cadence.cpp ../../usb_audio_stream.cpp -o usb_audio_cadence
+//   ./usb_audio_cadence
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "usb_audio_stream.h"
+
+static const int64_t FRAME_NS = 1000000;
+
+struct Scenario {
+  const char* name;
+  double ppm;            // Adapter clock error: + renders blocks faster
+  int64_t phaseNs;       // Host frame offset from the first block
+  int64_t jitterNs;      // DMA interrupt latency, 0..jitter
+  int64_t hostStartNs;   // First frame the host collects
+  uint32_t frames;
+};
+
+struct Result {
+  uint32_t packets;
+  uint32_t emptyFrames;      // After the first packet
+  uint32_t runOfEmpty;       // Longest run of empty frames
+  uint32_t dropped;
+  uint32_t skipped;          // Blocks missing between packets
+  uint32_t wrongData;
+  uint32_t outOfOrder;
+};
+
+// Deterministic jitter, so every run gives the same numbers
+static uint32_t lcg = 12345;
+static int64_t jitter(int64_t range) {
+  lcg = lcg * 1664525 + 1013904223;
+  return range ? (int64_t)(lcg >> 8) % range : 0;
+}
+
+// Block k counts up through the DAC codes from k * 16, so a packet says
+// which block it came from (modulo 64) and whether it arrived intact
+#define BLOCK_TAGS ((1 << SIDETONE_DAC_BITS) / USB_AUDIO_PACKET_SAMPLES)
+
+static void tagBlock(uint32_t k, uint16_t* codes) {
+  for (uint8_t i = 0; i < USB_AUDIO_PACKET_SAMPLES; i++) {
+    codes[i] = (k * USB_AUDIO_PACKET_SAMPLES + i) & ((1 << SIDETONE_DAC_BITS) - 1);
+  }
+}
+
+// The block's tag, or -1 if the packet is not a converted block
+static int packetTag(const int16_t* packet) {
+  uint16_t codes[USB_AUDIO_PACKET_SAMPLES];
+  int tag = ((packet[0] >> (16 - SIDETONE_DAC_BITS)) + SIDETONE_DAC_MID) / USB_AUDIO_PACKET_SAMPLES;
+  tagBlock(tag, codes);
+  for (uint8_t i = 0; i < USB_AUDIO_PACKET_SAMPLES; i++) {
+    if (packet[i] != ((int)codes[i] - SIDETONE_DAC_MID) * (1 << (16 - SIDETONE_DAC_BITS))) return -1;
+  }
+  return tag;
+}
+
+static Result run(const Scenario& s) {
+  UsbAudioStream stream;
+  Result r = {0, 0, 0, 0, 0, 0, 0};
+
+  int16_t endpoint[USB_AUDIO_PACKET_SAMPLES];   // What the host reads
+  bool busy = false;                            // BK1RDY
+  bool trfail = false;                          // An IN token found it empty
+  int lastTag = -1;
+  uint32_t emptyRun = 0;
+
+  const double halfNs = FRAME_NS / 2 / (1.0 + s.ppm * 1e-6);
+  uint32_t half = 0;
+  int64_t nextInterrupt = (int64_t)halfNs + jitter(s.jitterNs);
+  int64_t nextFrame = s.hostStartNs + s.phaseNs;
+  const int64_t end = nextFrame + (int64_t)s.frames * FRAME_NS;
+
+  while (nextFrame < end) {
+    if (nextInterrupt <= nextFrame) {
+      // DMA interrupt: a block on every second one, then the refill
+      half++;
+      if ((half & 1) == 0) {
+        uint16_t codes[USB_AUDIO_PACKET_SAMPLES];
+        tagBlock(half / 2 - 1, codes);
+        stream.block(codes);
+      }
+      const int16_t* packet = stream.pump(busy, trfail);
+      trfail = false;
+      if (packet) {
+        memcpy(endpoint, packet, sizeof(endpoint));
+        busy = true;
+      }
+      nextInterrupt = (int64_t)(halfNs * (half + 1)) + jitter(s.jitterNs);
+    } else {
+      // IN token
+      if (busy) {
+        int tag = packetTag(endpoint);
+        if (tag < 0) {
+          r.wrongData++;
+        } else if (r.packets >= 2) {
+          // The first packet may have waited since before the host started
+          int gap = (tag - lastTag + BLOCK_TAGS) % BLOCK_TAGS;
+          if (gap == 0 || gap > BLOCK_TAGS / 2) r.outOfOrder++;
+          else r.skipped += gap - 1;
+        }
+        lastTag = tag;
+        busy = false;
+        r.packets++;
+        emptyRun = 0;
+      } else {
+        trfail = true;
+        if (r.packets) {
+          r.emptyFrames++;
+          emptyRun++;
+          if (emptyRun > r.runOfEmpty) r.runOfEmpty = emptyRun;
+        }
+      }
+      nextFrame += FRAME_NS;
+    }
+  }
+  r.dropped = stream.blocksDropped();
+  return r;
+}
+
+static bool report(const Scenario& s, const Result& r, bool ok) {
+  printf("%-24s %5.0f ppm, phase %3lld us: %5u packets, %3u empty (run %u), %3u dropped, %3u skipped%s%s %s\n",
+         s.name, s.ppm, (long long)(s.phaseNs / 1000), r.packets, r.emptyFrames, r.runOfEmpty, r.dropped,
+         r.skipped, r.wrongData ? ", BAD DATA" : "", r.outOfOrder ? ", OUT OF ORDER" : "",
+         ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool intact(const Result& r) {
+  return r.packets > 0 && r.wrongData == 0 && r.outOfOrder == 0;
+}
+
+// ============================================================================
+// Checks
+// ============================================================================
+
+static bool checkLocked() {
+  // Phases under 200 us put the frame inside the interrupt jitter
+  bool ok = true;
+  for (int64_t phase = 0; phase < FRAME_NS; phase += 50000) {
+    Scenario s = {"locked", 0, phase, 200000, 0, 10000};
+    Result r = run(s);
+    bool pass = intact(r) && r.emptyFrames == 0 && r.dropped == 0 && r.skipped == 0;
+    ok = report(s, r, pass) && ok;
+  }
+  return ok;
+}
+
+static bool checkDrift() {
+  static const double ppms[] = {50, -50, 200, -200};
+  const uint32_t frames = 60000;   // One minute
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(ppms) / sizeof(ppms[0]); i++) {
+    for (int64_t phase = 0; phase < FRAME_NS; phase += 500000) {
+      Scenario s = {"free-running", ppms[i], phase, 200000, 0, frames};
+      Result r = run(s);
+      uint32_t expected = (uint32_t)(fabs(ppms[i]) * 1e-6 * frames + 0.5);
+      // A fast adapter drops blocks, a slow one leaves frames empty
+      uint32_t slips = ppms[i] > 0 ? r.dropped : r.emptyFrames;
+      uint32_t wrongWay = ppms[i] > 0 ? r.emptyFrames : r.dropped;
+      bool pass = intact(r) && slips <= expected + 1 && slips + 1 >= expected && wrongWay == 0 &&
+                  r.runOfEmpty <= 1 && r.skipped == r.dropped;
+      ok = report(s, r, pass) && ok;
+    }
+  }
+  return ok;
+}
+
+static bool checkHostStart() {
+  // The adapter renders for half a second before the host selects the
+  // streaming interface: the endpoint and the queue wait, nothing is a drop
+  Scenario s = {"host starts late", 0, 500000, 200000, 500 * FRAME_NS, 10000};
+  Result r = run(s);
+  bool pass = intact(r) && r.dropped == 0 && r.emptyFrames == 0 && r.skipped == 0;
+  return report(s, r, pass);
+}
+
+int main() {
+  bool ok = checkLocked();
+  ok = checkDrift() && ok;
+  ok = checkHostStart() && ok;
+  printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include "usb_audio.h"
+
+#ifdef SIDETONE_USB_AUDIO
+
+#include "USB/PluggableUSB.h"
+#include "usb_audio_stream.h"
+
+// Audio class codes (USB Audio 1.0)
+#define AUDIO_CLASS 0x01
+#define AUDIO_SUBCLASS_CONTROL 0x01
+#define AUDIO_SUBCLASS_STREAMING 0x02
+#define AUDIO_CS_INTERFACE 0x24
+#define AUDIO_CS_ENDPOINT 0x25
+#define AUDIO_TERMINAL_MICROPHONE 0x0201
+#define AUDIO_TERMINAL_STREAMING 0x0101
+#define AUDIO_INPUT_TERMINAL_ID 1
+#define AUDIO_OUTPUT_TERMINAL_ID 2
+
+// Endpoint register values (SAMD21 datasheet, USB device)
+#define EPTYPE_ISOCHRONOUS 2
+#define PCKSIZE_32_BYTES 2
+
+static_assert(USB_AUDIO_PACKET_BYTES == 32, "PCKSIZE_32_BYTES no longer matches the packet");
+
+#ifndef LSB
+#define LSB(v) ((v) & 0xFF)
+#endif
+#ifndef MSB
+#define MSB(v) (((v) >> 8) & 0xFF)
+#endif
+
+// ============================================================================
+// Pluggable USB Module
+// ============================================================================
+
+class UsbAudio_ : public PluggableUSBModule {
+public:
+    UsbAudio_() : PluggableUSBModule(1, 2, endpointTypes) {
+        endpointTypes[0] = USB_ENDPOINT_TYPE_ISOCHRONOUS | USB_ENDPOINT_IN(0);
+        PluggableUSB().plug(this);
+    }
+
+    uint8_t endpoint() const { return pluggedEndpoint; }
+
+protected:
+    int getInterface(uint8_t* interfaceCount);
+    int getDescriptor(USBSetup& setup) { return 0; }
+    // No class requests: the single sample rate needs no control
+    bool setup(USBSetup& setup) { return false; }
+
+private:
+    uint32_t endpointTypes[1];
+};
+
+int UsbAudio_::getInterface(uint8_t* interfaceCount) {
+    *interfaceCount += 2;
+    const uint8_t control = pluggedInterface;
+    const uint8_t streaming = pluggedInterface + 1;
+    const uint16_t controlLength = 9 + 12 + 9;   // Header + terminals
+
+    const uint8_t descriptor[] = {
+        // Interface association: both interfaces are one function
+        8, 0x0B, control, 2, AUDIO_CLASS, AUDIO_SUBCLASS_CONTROL, 0, 0,
+
+        // Audio Control interface, header and the terminals
+        9, 0x04, control, 0, 0, AUDIO_CLASS, AUDIO_SUBCLASS_CONTROL, 0, 0,
+        9, AUDIO_CS_INTERFACE, 0x01, LSB(0x0100), MSB(0x0100),
+        LSB(controlLength), MSB(controlLength), 1, streaming,
+        12, AUDIO_CS_INTERFACE, 0x02, AUDIO_INPUT_TERMINAL_ID,
+        LSB(AUDIO_TERMINAL_MICROPHONE), MSB(AUDIO_TERMINAL_MICROPHONE), 0,
+        1, 0, 0, 0, 0,   // Mono, no spatial position
+        9, AUDIO_CS_INTERFACE, 0x03, AUDIO_OUTPUT_TERMINAL_ID,
+        LSB(AUDIO_TERMINAL_STREAMING), MSB(AUDIO_TERMINAL_STREAMING), 0,
+        AUDIO_INPUT_TERMINAL_ID, 0,
+
+        // Audio Streaming interface: alternate 0 has no bandwidth
+        9, 0x04, streaming, 0, 0, AUDIO_CLASS, AUDIO_SUBCLASS_STREAMING, 0, 0,
+        9, 0x04, streaming, 1, 1, AUDIO_CLASS, AUDIO_SUBCLASS_STREAMING, 0, 0,
+        7, AUDIO_CS_INTERFACE, 0x01, AUDIO_OUTPUT_TERMINAL_ID, 1, LSB(0x0001), MSB(0x0001),   // PCM
+        11, AUDIO_CS_INTERFACE, 0x02, 0x01, 1, 2, 16, 1,   // Type I, mono, 16 bits, one rate
+        LSB(SIDETONE_SAMPLE_RATE), MSB(SIDETONE_SAMPLE_RATE), (SIDETONE_SAMPLE_RATE >> 16) & 0xFF,
+
+        // Isochronous asynchronous IN, one packet per frame
+        9, 0x05, (uint8_t)(0x80 | pluggedEndpoint), 0x05,
+        LSB(USB_AUDIO_PACKET_BYTES), MSB(USB_AUDIO_PACKET_BYTES), 1, 0, 0,
+        7, AUDIO_CS_ENDPOINT, 0x01, 0, 0, 0, 0,
+    };
+    return USBDevice.sendControl(descriptor, sizeof(descriptor));
+}
+
+// Plugged in during static construction, before the core enumerates
+static UsbAudio_ usbAudio;
+static UsbAudioStream stream;
+
+// ============================================================================
+// Endpoint
+// ============================================================================
+
+static UsbDeviceDescBank& inBank(uint8_t ep) {
+  UsbDeviceDescriptor* table = (UsbDeviceDescriptor*)USB->DEVICE.DESCADD.reg;
+  return table[ep].DeviceDescBank[1];
+}
+
+// The core leaves isochronous endpoints disabled, and a bus reset disables
+// them again, so this runs whenever the endpoint is found unconfigured
+static void configureEndpoint(uint8_t ep) {
+  UsbDeviceEndpoint& regs = USB->DEVICE.DeviceEndpoint[ep];
+  inBank(ep).PCKSIZE.bit.SIZE = PCKSIZE_32_BYTES;
+  regs.EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_BK1RDY;
+  regs.EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRCPT1 | USB_DEVICE_EPINTFLAG_TRFAIL1;
+  regs.EPCFG.bit.EPTYPE1 = EPTYPE_ISOCHRONOUS;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void usbAudioBlock(const uint16_t* codes) {
+  stream.block(codes);
+  usbAudioPump();
+}
+
+void usbAudioPump() {
+  if (!USBDevice.configured()) return;
+
+  uint8_t ep = usbAudio.endpoint();
+  UsbDeviceEndpoint& regs = USB->DEVICE.DeviceEndpoint[ep];
+  if (regs.EPCFG.bit.EPTYPE1 != EPTYPE_ISOCHRONOUS) configureEndpoint(ep);
+
+  // Set when an IN token found the endpoint empty
+  bool missed = regs.EPINTFLAG.bit.TRFAIL1;
+  if (missed) regs.EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRFAIL1;
+
+  const int16_t* packet = stream.pump(regs.EPSTATUS.bit.BK1RDY, missed);
+  if (!packet) return;
+
+  UsbDeviceDescBank& bank = inBank(ep);
+  bank.ADDR.reg = (uint32_t)packet;
+  bank.PCKSIZE.bit.MULTI_PACKET_SIZE = 0;
+  bank.PCKSIZE.bit.BYTE_COUNT = USB_AUDIO_PACKET_BYTES;
+  regs.EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRCPT1;
+  regs.EPSTATUSSET.reg = USB_DEVICE_EPSTATUSSET_BK1RDY;
+}
+
+uint32_t usbAudioPacketsQueued() {
+  return stream.packetsQueued();
+}
+
+uint32_t usbAudioBlocksDropped() {
+  return stream.blocksDropped();
+}
+
+uint32_t usbAudioEmptyFrames() {
+  return stream.emptyFrames();
+}
+
+#endif // SIDETONE_USB_AUDIO
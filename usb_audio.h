@@ -0,0 +1,37 @@
+#ifndef USB_AUDIO_H
+#define USB_AUDIO_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifdef SIDETONE_USB_AUDIO
+
+// ============================================================================
+// USB Audio Sidetone Stream
+// ============================================================================
+// A USB Audio Class 1.0 input (16 kHz, 16-bit mono) carrying the DAC
+// sidetone, plugged in next to the keyboard and MIDI interfaces. Host
+// software can monitor the adapter's own tone, keyed with no USB latency,
+// instead of generating one after the MIDI notes arrive.
+//
+// The interface is an Audio Control interface with one input terminal and
+// an Audio Streaming interface whose alternate setting 1 has a single
+// asynchronous isochronous IN endpoint. The Arduino core does not set up
+// isochronous endpoints, so this module programs the endpoint registers
+// itself once the host has configured the device, and feeds it straight
+// from the DMA interrupt (usb_audio_stream.h).
+
+// Queue a rendered block of DAC codes for the endpoint (DMA interrupt only)
+void usbAudioBlock(const uint16_t* codes);
+
+// Refill the endpoint; call every half block (DMA interrupt only)
+void usbAudioPump();
+
+// Statistics
+uint32_t usbAudioPacketsQueued();
+uint32_t usbAudioBlocksDropped();
+uint32_t usbAudioEmptyFrames();
+
+#endif // SIDETONE_USB_AUDIO
+
+#endif // USB_AUDIO_H
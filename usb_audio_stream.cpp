@@ -0,0 +1,58 @@
+#include <string.h>
+#include "usb_audio_stream.h"
+
+// DAC codes up to the full 16-bit signed range
+#define USB_AUDIO_SAMPLE_SHIFT (16 - SIDETONE_DAC_BITS)
+
+// Blocks rendered with no packet collected, after which the host is taken
+// to have stopped streaming
+#define USB_AUDIO_IDLE_BLOCKS 8
+
+UsbAudioStream::UsbAudioStream()
+    : head(0), count(0), priming(true), onEndpoint(false), idleBlocks(USB_AUDIO_IDLE_BLOCKS),
+      queued(0), dropped(0), framesMissed(0) {
+  memset(packet, 0, sizeof(packet));
+}
+
+void UsbAudioStream::dropOldest() {
+  head = (head + 1) % USB_AUDIO_QUEUE;
+  count--;
+}
+
+void UsbAudioStream::block(const uint16_t* codes) {
+  if (count == USB_AUDIO_QUEUE) {
+    // Keep the newest audio. Only a drop if the host is reading, rather than
+    // not streaming at all.
+    if (idleBlocks < USB_AUDIO_IDLE_BLOCKS) dropped++;
+    dropOldest();
+  }
+  int16_t* out = waiting[(head + count) % USB_AUDIO_QUEUE];
+  for (uint8_t i = 0; i < USB_AUDIO_PACKET_SAMPLES; i++) {
+    out[i] = (int16_t)(((int32_t)codes[i] - SIDETONE_DAC_MID) * (1 << USB_AUDIO_SAMPLE_SHIFT));
+  }
+  count++;
+  if (idleBlocks < USB_AUDIO_IDLE_BLOCKS) idleBlocks++;
+}
+
+const int16_t* UsbAudioStream::pump(bool endpointBusy, bool missed) {
+  if (missed) framesMissed++;
+  if (endpointBusy) return 0;
+  if (onEndpoint) {
+    // Collected. If the host has just started streaming the queue is full
+    // of blocks kept while it was not, and is cut back to the reserve.
+    if (idleBlocks >= USB_AUDIO_IDLE_BLOCKS && count == USB_AUDIO_QUEUE) dropOldest();
+    idleBlocks = 0;
+    onEndpoint = false;
+  }
+
+  if (count == 0 || (priming && count < USB_AUDIO_QUEUE)) return 0;
+  priming = false;
+  onEndpoint = true;
+
+  // The endpoint has finished with the packet, so it can be overwritten
+  memcpy(packet, waiting[head], sizeof(packet));
+  head = (head + 1) % USB_AUDIO_QUEUE;
+  count--;
+  queued++;
+  return packet;
+}
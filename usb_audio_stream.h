@@ -0,0 +1,72 @@
+#ifndef USB_AUDIO_STREAM_H
+#define USB_AUDIO_STREAM_H
+
+#include <stdint.h>
+#include "sidetone_synth.h"
+
+// ============================================================================
+// USB AUDIO SIDETONE PACKETS
+// ============================================================================
+// Pacing of the USB Audio Class sidetone stream (usb_audio.h). The DAC
+// engine renders one block of SIDETONE_BLOCK_SAMPLES every millisecond,
+// which at 16 kHz is exactly one USB full-speed frame, so each block becomes
+// one isochronous packet of 16-bit mono samples.
+//
+// The endpoint holds one packet at a time. Rendered blocks wait in a short
+// queue and are moved to the endpoint by pump(), which the DMA interrupt
+// calls every half block, and the stream starts with one block in reserve
+// (1 ms of latency): so a packet is ready in every frame whatever the phase
+// between the frames and the interrupt. With the CPU clock locked to the
+// USB frames (crystalless SAMD21 boards) nothing is lost once the stream
+// runs. A free-running clock slips one block at a time, as often as its
+// error adds up to a millisecond: a fast one drops the oldest block, a slow
+// one leaves a frame empty.
+//
+// While the host is not streaming the endpoint stays full and the queue
+// keeps the newest blocks, which are not counted as drops; when it starts
+// again the queue is cut back to the reserve.
+//
+// This file has no Arduino dependencies so host tools can build it as-is.
+// ============================================================================
+
+#define USB_AUDIO_PACKET_SAMPLES SIDETONE_BLOCK_SAMPLES
+#define USB_AUDIO_PACKET_BYTES (USB_AUDIO_PACKET_SAMPLES * 2)
+
+// Blocks waiting for the endpoint: the reserve plus one for clock drift
+#define USB_AUDIO_QUEUE 2
+
+class UsbAudioStream {
+public:
+    UsbAudioStream();
+
+    // A block of DAC codes has been rendered
+    void block(const uint16_t* codes);
+
+    // Move the next block to the endpoint (at least twice per frame).
+    // endpointBusy: the last packet is still waiting for the host; missed:
+    // a frame has found the endpoint empty since the last call. Returns the
+    // packet to queue on the endpoint, or 0.
+    const int16_t* pump(bool endpointBusy, bool missed);
+
+    // Statistics
+    uint32_t packetsQueued() const { return queued; }
+    uint32_t blocksDropped() const { return dropped; }
+    uint32_t emptyFrames() const { return framesMissed; }
+
+private:
+    int16_t waiting[USB_AUDIO_QUEUE][USB_AUDIO_PACKET_SAMPLES];
+    // The one on the endpoint, read by its DMA, so word aligned
+    int16_t packet[USB_AUDIO_PACKET_SAMPLES] __attribute__((aligned(4)));
+    uint8_t head;        // Oldest waiting block
+    uint8_t count;       // Blocks waiting
+    bool priming;        // Building the reserve before the first packet
+    bool onEndpoint;     // The endpoint holds a packet from this stream
+    uint8_t idleBlocks;  // Blocks since the host last took a packet
+    uint32_t queued;
+    uint32_t dropped;
+    uint32_t framesMissed;
+
+    void dropOldest();
+};
+
+#endif // USB_AUDIO_STREAM_H
@@ -14,6 +14,8 @@
 #include "settings_eeprom.h"
 #include "menu_handler.h"
 #include "equal_temperament.h"
+#include "radio_output.h"
+#include "sidetone.h"
 
 bool trs = false;
 unsigned long dahGroundedStartTime = 0;  // Track how long DAH has been grounded
@@ -36,8 +38,7 @@ VailAdapter adapter = VailAdapter(PIEZO_PIN);
 #ifdef BUTTON_PIN
 ButtonDebouncer buttonDebouncer;
 
-// CW Memory system
-CWMemory memorySlots[MAX_MEMORY_SLOTS];  // 3 memory slots
+// CW Memory system (saved slots are read in place from NVM)
 RecordingState recordingState;           // Current recording state
 PlaybackState playbackState;             // Current playback state
 #endif
@@ -96,10 +97,20 @@ void setup() {
   digitalWrite(RADIO_DAH_PIN, RADIO_INACTIVE_LEVEL); // Use configured inactive level
   Serial.print("Radio Output Pins Initialized. Inactive Level: ");
   Serial.println(RADIO_INACTIVE_LEVEL == LOW ? "LOW" : "HIGH");
+#ifdef RADIO_EDGE_TIMER
+  initRadioEdgeTimer();
+#endif
+#ifdef RADIO_PTT_PIN
+  initPttSequencer();
+#endif
+#endif
+
+#ifdef SIDETONE_DAC
+  initSidetone();
 #endif
 
   // Initialize audio module
-  initMorseAudio(&adapter, PIEZO_PIN);
+  initMorseAudio(&adapter);
 
   uint8_t startupTone = loadToneFromEEPROM();
   Serial.println("Playing VAIL in Morse code at 20 WPM");
@@ -109,11 +120,11 @@ void setup() {
   loadRadioKeyerModeFromEEPROM(adapter);
 
 #ifdef BUTTON_PIN
-  loadMemoriesFromEEPROM(memorySlots);
+  logStoredMemories();
   // Connect recording state to adapter for key capture
   adapter.setRecordingState(&recordingState);
   // Initialize menu handler with flush callback
-  initMenuHandler(&adapter, memorySlots, &recordingState, &playbackState, flushBounceState);
+  initMenuHandler(&adapter, &recordingState, &playbackState, flushBounceState);
 #endif
 
   Serial.print("Adapter settings loaded - Keyer: "); Serial.print(adapter.getCurrentKeyerType());
@@ -166,12 +177,79 @@ void setLED() {
 #endif
 }
 
+#ifdef BUTTON_PIN
+// Send playback key changes to the outputs
+void servicePlaybackOutput() {
+  MenuHandlerState& menuState = getMenuState();
+  static bool lastPlaybackKeyState = false;
+  static bool wasPlaying = false;
+
+  if (playbackState.isPlaying) {
+    wasPlaying = true;
+    if (playbackState.keyCurrentlyDown != lastPlaybackKeyState) {
+      if (playbackState.keyCurrentlyDown) {
+        // Key down
+        if (menuState.currentMode == MODE_PLAYING_MEMORY) {
+          // Normal mode playback: use BeginTx(relay) to pass paddle info for radio mode
+          // Convert paddle flag (0=DIT, 1=DAH) to PADDLE enum (PADDLE_DIT=0, PADDLE_DAH=1)
+          int relay = (playbackState.currentPaddle == 0) ? PADDLE_DIT : PADDLE_DAH;
+          adapter.BeginTx(relay);
+        } else {
+          // Memory management mode: local preview only (bypass buzzer enable check)
+          adapter.CueNote(adapter.getTxNote());
+        }
+      } else {
+        // Key up
+        if (menuState.currentMode == MODE_PLAYING_MEMORY) {
+          // Normal mode playback: use EndTx(relay) to pass paddle info for radio mode
+          // Convert paddle flag (0=DIT, 1=DAH) to PADDLE enum (PADDLE_DIT=0, PADDLE_DAH=1)
+          int relay = (playbackState.currentPaddle == 0) ? PADDLE_DIT : PADDLE_DAH;
+          adapter.EndTx(relay);
+        } else {
+          // Memory management mode: local preview only
+          adapter.CueOff();
+        }
+      }
+      lastPlaybackKeyState = playbackState.keyCurrentlyDown;
+    }
+  } else if (wasPlaying) {
+    // Playback just finished
+    // The playback state machine ensures key is already released before stopping,
+    // so we don't need to call EndTx here (it would be a duplicate)
+    if (menuState.currentMode != MODE_PLAYING_MEMORY) {
+      // Memory management mode: ensure the preview is off
+      adapter.CueOff();
+    }
+    lastPlaybackKeyState = false;
+    wasPlaying = false;
+
+    // Return to appropriate mode
+    if (menuState.currentMode == MODE_PLAYING_MEMORY) {
+      menuState.currentMode = MODE_NORMAL;
+      Serial.println("Playback finished - returned to normal mode");
+    }
+  }
+}
+#endif
+
+// A paddle or key edge stops memory playback (including a repeat) before the
+// live element is processed, so the memory's key-up goes out first
+void stopPlaybackForLiveKeying() {
+#ifdef BUTTON_PIN
+  if (!playbackState.isPlaying) return;
+  abortPlayback(playbackState);
+  updatePlayback(playbackState);  // Releases the key if it was down
+  servicePlaybackOutput();
+#endif
+}
+
 void loop() {
   unsigned long currentTime = millis();
   midiEventPacket_t event = MidiUSB.read();
 
   setLED();
   adapter.Tick(currentTime);
+  serviceSettingsStore(currentTime);
 
   // Check for TRS cable hot-plug detection (every 500ms)
   // ONLY active when already in Straight Key mode (keyer type 1)
@@ -234,65 +312,15 @@ void loop() {
   updatePlayback(playbackState);
 
   // Control output during playback
-  static bool lastPlaybackKeyState = false;
-  static bool wasPlaying = false;
-
-  if (playbackState.isPlaying) {
-    wasPlaying = true;
-    if (playbackState.keyCurrentlyDown != lastPlaybackKeyState) {
-      if (playbackState.keyCurrentlyDown) {
-        // Key down
-        if (menuState.currentMode == MODE_PLAYING_MEMORY) {
-          // Normal mode playback: use BeginTx(relay) to pass paddle info for radio mode
-          // Convert paddle flag (0=DIT, 1=DAH) to PADDLE enum (PADDLE_DIT=0, PADDLE_DAH=1)
-          int relay = (playbackState.currentPaddle == 0) ? PADDLE_DIT : PADDLE_DAH;
-          adapter.BeginTx(relay);
-        } else {
-          // Memory management mode: piezo only (bypass buzzer enable check)
-          // Convert MIDI note to frequency
-          uint8_t midiNote = adapter.getTxNote();
-          int frequency = GET_EQUAL_TEMPERAMENT_NOTE(midiNote);
-          tone(PIEZO_PIN, frequency);
-        }
-      } else {
-        // Key up
-        if (menuState.currentMode == MODE_PLAYING_MEMORY) {
-          // Normal mode playback: use EndTx(relay) to pass paddle info for radio mode
-          // Convert paddle flag (0=DIT, 1=DAH) to PADDLE enum (PADDLE_DIT=0, PADDLE_DAH=1)
-          int relay = (playbackState.currentPaddle == 0) ? PADDLE_DIT : PADDLE_DAH;
-          adapter.EndTx(relay);
-        } else {
-          // Memory management mode: piezo only
-          noTone(PIEZO_PIN);
-        }
-      }
-      lastPlaybackKeyState = playbackState.keyCurrentlyDown;
-    }
-  } else if (wasPlaying) {
-    // Playback just finished
-    // The playback state machine ensures key is already released before stopping,
-    // so we don't need to call EndTx here (it would be a duplicate)
-    if (menuState.currentMode != MODE_PLAYING_MEMORY) {
-      // Memory management mode: ensure piezo is off
-      noTone(PIEZO_PIN);
-    }
-    lastPlaybackKeyState = false;
-    wasPlaying = false;
-
-    // Return to appropriate mode
-    if (menuState.currentMode == MODE_PLAYING_MEMORY) {
-      menuState.currentMode = MODE_NORMAL;
-      Serial.println("Playback finished - returned to normal mode");
-    }
-  }
+  servicePlaybackOutput();
 
-  // Check for recording timeout (25 seconds) or max transitions
+  // Check for recording timeout or a full slot buffer
   if (recordingState.isRecording) {
     if (recordingState.hasReachedMaxDuration() || recordingState.hasReachedMaxTransitions()) {
       uint8_t activeSlot = recordingState.slotNumber;
       Serial.println("Recording auto-stopped (timeout or max transitions reached)");
-      stopRecording(recordingState, memorySlots[activeSlot]);
-      saveMemoryToEEPROM(activeSlot, memorySlots[activeSlot]);
+      stopRecording(recordingState);
+      saveMemoryToEEPROM(activeSlot, recordingState.stream);
 
       // Play completion tone
       playAdjustmentBeep(false);
@@ -317,6 +345,7 @@ void loop() {
 #ifndef TRRS_TRINKEY
   // Trinkey doesn't process separate straight key input
   if (key.update()) {
+    stopPlaybackForLiveKeying();
     adapter.ProcessPaddleInput(PADDLE_STRAIGHT, !key.read(), false);
 #ifdef BUTTON_PIN
     // Reset activity timer on CW key activity in setting modes
@@ -332,6 +361,7 @@ void loop() {
     // DIT pin (tip) is the actual straight key input
     // Only process DIT as straight key, ignore DAH completely
     if (dit.update()) {
+      stopPlaybackForLiveKeying();
       adapter.ProcessPaddleInput(PADDLE_STRAIGHT, !dit.read(), false);
 #ifdef BUTTON_PIN
       // Reset activity timer on CW key activity in setting modes
@@ -345,6 +375,7 @@ void loop() {
   } else {
     // Normal paddle mode: process both DIT and DAH separately
     if (dit.update()) {
+      stopPlaybackForLiveKeying();
       adapter.ProcessPaddleInput(PADDLE_DIT, !dit.read(), false);
 #ifdef BUTTON_PIN
       // Reset activity timer on CW key activity in setting modes
@@ -354,6 +385,7 @@ void loop() {
 #endif
     }
     if (dah.update()) {
+      stopPlaybackForLiveKeying();
       adapter.ProcessPaddleInput(PADDLE_DAH, !dah.read(), false);
 #ifdef BUTTON_PIN
       // Reset activity timer on CW key activity in setting modes
@@ -367,6 +399,7 @@ void loop() {
 #ifndef NO_CAPACITIVE_TOUCH
 #ifdef QT_KEY_PIN
   if (qt_key.update()) {
+    stopPlaybackForLiveKeying();
     adapter.ProcessPaddleInput(PADDLE_STRAIGHT, qt_key.read(), true);
 #ifdef BUTTON_PIN
     if (menuState.currentMode != MODE_NORMAL) {
@@ -376,6 +409,7 @@ void loop() {
   }
 #endif
   if (qt_dit.update()) {
+    stopPlaybackForLiveKeying();
     adapter.ProcessPaddleInput(PADDLE_DIT, qt_dit.read(), true);
 #ifdef BUTTON_PIN
     if (menuState.currentMode != MODE_NORMAL) {
@@ -384,6 +418,7 @@ void loop() {
 #endif
   }
   if (qt_dah.update()) {
+    stopPlaybackForLiveKeying();
     adapter.ProcessPaddleInput(PADDLE_DAH, qt_dah.read(), true);
 #ifdef BUTTON_PIN
     if (menuState.currentMode != MODE_NORMAL) {